@@ -7,20 +7,25 @@
 #undef SetPort
 
 #include "Async/AsyncWork.h"
+#include "Async/ParallelFor.h"
 #include "Async/TaskGraphInterfaces.h"
 #include "Containers/Map.h"
 #include "Containers/Set.h"
 #include "GenericPlatform/GenericPlatformMath.h"
 #include "HAL/PlatformProcess.h"
+#include "HAL/Runnable.h"
 #include "HAL/RunnableThread.h"
 #include "InterpolationProcessor/LiveLinkBasicFrameInterpolateProcessor.h"
 #include "LiveLinkAnimationVirtualSubject.h"
 #include "LiveLinkVirtualSubject.h"
 #include "Misc/EngineVersionComparison.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 #include "Roles/LiveLinkAnimationRole.h"
 #include "Roles/LiveLinkAnimationTypes.h"
 #include "Roles/LiveLinkTransformRole.h"
 #include "Roles/LiveLinkTransformTypes.h"
+#include <atomic>
 #include <cmath>
 
 #define DEG2RADf 0.0174532925199432958f
@@ -29,52 +34,156 @@
 
 #define scaleToUnreal 0.1f // unreal works in cm
 
+// rotate Y-is-up to Z-is-up
+static const FQuat yUpToZUp(FVector(1, 0, 0), 90 * DEG2RADf);
+
 int CapturyLiveLinkSource::sourceCount = 0;
 TMap<FString, TSet<int>> CapturyLiveLinkSource::ipAddressCounts;
 
 DECLARE_LOG_CATEGORY_EXTERN(LogCaptury, Log, All);
 DEFINE_LOG_CATEGORY(LogCaptury);
 
-static void actorChanged(RemoteCaptury* rc, int actorId, int mode, void* userArg)
+DECLARE_STATS_GROUP(TEXT("CapturyLiveLink"), STATGROUP_CapturyLiveLink, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frames pushed"), STAT_CapturyFramesPushed, STATGROUP_CapturyLiveLink);
+// heap memory owned by the converted frames. divided by Frames pushed it is what a single frame allocates.
+DECLARE_DWORD_COUNTER_STAT(TEXT("Frame data bytes allocated"), STAT_CapturyFrameDataBytes, STATGROUP_CapturyLiveLink);
+DECLARE_CYCLE_STAT(TEXT("Convert and push pose"), STAT_CapturyNewPose, STATGROUP_CapturyLiveLink);
+DECLARE_CYCLE_STAT(TEXT("Convert and push batch"), STAT_CapturyIngestBatch, STATGROUP_CapturyLiveLink);
+// the stages inside RemoteCaptury, refreshed from Captury_getStats() in Update()
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Receive to parse p99 (us)"), STAT_CapturyReceiveToParseP99, STATGROUP_CapturyLiveLink);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Parse to callback p99 (us)"), STAT_CapturyParseToCallbackP99, STATGROUP_CapturyLiveLink);
+// including the wait in the ingest queue. recorded by Captury_poseConsumed() once the frame was pushed.
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Callback to push p99 (us)"), STAT_CapturyCallbackToPushP99, STATGROUP_CapturyLiveLink);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Dropped poses"), STAT_CapturyDroppedPoses, STATGROUP_CapturyLiveLink);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Reassembly failures"), STAT_CapturyReassemblyFailures, STATGROUP_CapturyLiveLink);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ingest queue depth"), STAT_CapturyIngestQueueDepth, STATGROUP_CapturyLiveLink);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ingest queue overflows"), STAT_CapturyIngestQueueOverflows, STATGROUP_CapturyLiveLink);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Time sync error bound (us)"), STAT_CapturyTimeSyncErrorBound, STATGROUP_CapturyLiveLink);
+
+// metadata keys are interned once
+static const FName timestampInSecondsName(TEXT("TimestampInSeconds"));
+static const FName frameRateName(TEXT("FrameRate"));
+static const FName frameNumberName(TEXT("FrameNumber"));
+
+// the stream thread only enqueues poses, this thread converts and pushes them to LiveLink.
+// poses are RemoteCaptury pose views so nothing is copied on the way.
+class CapturyLiveLinkSource::IngestWorker : public FRunnable
 {
-	((CapturyLiveLinkSource*)userArg)->actorChanged(actorId, mode);
-}
+public:
+	// a few frames worth of poses for a large number of actors
+	static constexpr uint32 queueSize = 1024;
 
-void CapturyLiveLinkSource::actorChanged(int actorId, int mode)
-{
-	const CapturyActor* actor = Captury_getActor(remoteCaptury, actorId);
-	UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink:%s actor %x changed to mode %s"), (actor == nullptr) ? TEXT(" unknown") : TEXT(""), actorId, ANSI_TO_TCHAR(CapturyActorStatusString[mode]));
-	Captury_freeActor(remoteCaptury, actor);
+	IngestWorker(CapturyLiveLinkSource* source) : source(source), queue(queueSize)
 	{
-		FScopeLock guard(&mutx); lockedAt = __LINE__; unlockedAt = -1;
-		if (haveActors.Contains(actorId)) {
-			if (mode == ACTOR_STOPPED || mode == ACTOR_DELETED) {
-				// The lock used in RemoveSubject_AnyThread is called on
-				// LiveLinkClient::Tick which calls CapturyLiveLinkSource::Update function causing deadlock when an actor is changed at the same time a tick is
-				Captury_log(remoteCaptury, CAPTURY_LOG_INFO, "Unreal: actor %x now has mode %s. deleting.", actorId, CapturyActorStatusString[mode]);
-				queuedActorIdsToRemove.Enqueue(actorId);
-				unlockedAt = __LINE__;
-				return;
+		wakeUp = FPlatformProcess::GetSynchEventFromPool();
+		thread = FRunnableThread::Create(this, TEXT("CapturyLiveLinkIngest"), 0, TPri_AboveNormal);
+	}
+
+	virtual ~IngestWorker()
+	{
+		Stop();
+		thread->WaitForCompletion();
+		delete thread;
+		FPlatformProcess::ReturnSynchEventToPool(wakeUp);
+
+		// the source makes sure that no more poses arrive
+		QueuedPose queued;
+		while (queue.Dequeue(queued))
+			Captury_releasePoseView(source->remoteCaptury, queued.pose);
+	}
+
+	// called by the thread delivering poses which is the only producer.
+	// returns false if the worker has fallen too far behind.
+	bool enqueue(int actorId, const CapturyPose* pose)
+	{
+		if (!queue.Enqueue(QueuedPose{actorId, pose}))
+			return false;
+		wakeUp->Trigger();
+		return true;
+	}
+
+	uint32 depth() const
+	{
+		return queue.Count();
+	}
+
+	virtual uint32 Run() override
+	{
+		while (!stopping) {
+			// poses of all actors of one frame arrive back to back.
+			// collect them until the frame changes or the queue runs dry and convert them together.
+			while (!stopping && queue.Peek() != nullptr) {
+				batch.Reset();
+				while (const QueuedPose* next = queue.Peek()) {
+					if (batch.Num() != 0 && (next->pose->timestamp != batch[0].pose->timestamp || containsActor(next->actorId)))
+						break;
+					batch.AddDefaulted_GetRef().queued = *next;
+					queue.Dequeue();
+				}
+				convertAndPushBatch();
 			}
-			Captury_log(remoteCaptury, CAPTURY_LOG_WARNING, "Unreal: actor %x now has mode %s. already have actor.", actorId, CapturyActorStatusString[mode]);
-			UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: already have actor %x"), actorId);
-			unlockedAt = __LINE__;
-			return;
+			wakeUp->Wait();
 		}
-	} unlockedAt = __LINE__;
+		return 0;
+	}
 
-	if (mode == ACTOR_STOPPED || mode == ACTOR_DELETED) {
-		Captury_log(remoteCaptury, CAPTURY_LOG_WARNING, "Unreal: actor %x now has mode %s. already gone.", actorId, CapturyActorStatusString[mode]);
-		UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: cannot stop actor %x. already gone."), actorId);
-		return;
+	virtual void Stop() override
+	{
+		stopping = true;
+		wakeUp->Trigger();
 	}
 
-	Captury_log(remoteCaptury, CAPTURY_LOG_INFO, "Unreal: actor %x now has mode %s. adding.", actorId, CapturyActorStatusString[mode]);
-	UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: pushing new actor %x"), actorId);
-	mutx.Lock(); lockedAt = __LINE__; unlockedAt = -1;
-	queuedActorIds.Enqueue(actorId);
-	mutx.Unlock(); unlockedAt = __LINE__;
-}
+private:
+	struct QueuedPose {
+		int actorId;
+		const CapturyPose* pose;
+	};
+
+	struct ConvertedPose {
+		QueuedPose queued;
+		ILiveLinkClient* client = nullptr; // set if the pose was converted
+		FLiveLinkSubjectKey subjectKey;
+		FLiveLinkFrameDataStruct frameData;
+	};
+
+	// with fewer actors per frame fanning out costs more than it saves
+	static constexpr int32 minParallelBatch = 4;
+
+	bool containsActor(int actorId) const
+	{
+		for (const ConvertedPose& p : batch)
+			if (p.queued.actorId == actorId)
+				return true;
+		return false;
+	}
+
+	void convertAndPushBatch()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CapturyIngestBatch);
+		// every actor has its own retarget plan and scratch space so actors can be converted in parallel
+		ParallelFor(batch.Num(), [this](int32 i) {
+			ConvertedPose& p = batch[i];
+			p.client = source->convertPose(p.queued.actorId, nullptr, p.queued.pose, p.subjectKey, p.frameData);
+		}, (batch.Num() < minParallelBatch) ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+
+		for (ConvertedPose& p : batch) {
+			if (p.client != nullptr) {
+				INC_DWORD_STAT(STAT_CapturyFramesPushed);
+				p.client->PushSubjectFrameData_AnyThread(p.subjectKey, MoveTemp(p.frameData));
+				Captury_poseConsumed(source->remoteCaptury, p.queued.pose);
+			}
+			Captury_releasePoseView(source->remoteCaptury, p.queued.pose);
+		}
+		batch.Reset();
+	}
+
+	CapturyLiveLinkSource* source;
+	TCircularQueue<QueuedPose> queue;
+	TArray<ConvertedPose> batch; // only touched by the worker thread
+	FEvent* wakeUp;
+	FRunnableThread* thread;
+	std::atomic<bool> stopping {false};
+};
 
 static void newPose(RemoteCaptury* rc, CapturyActor* actor, CapturyPose* pose, int trackingQuality, void* userArg)
 {
@@ -83,6 +192,53 @@ static void newPose(RemoteCaptury* rc, CapturyActor* actor, CapturyPose* pose, i
 
 void CapturyLiveLinkSource::newPose(CapturyActor* actor, CapturyPose* pose, int trackingQuality)
 {
+	if (ingestWorker.IsValid()) {
+		// keep the pose alive until the worker is done with it
+		Captury_retainPoseView(remoteCaptury, pose);
+		if (!ingestWorker->enqueue(actor->id, pose)) {
+			Captury_releasePoseView(remoteCaptury, pose);
+			INC_DWORD_STAT(STAT_CapturyIngestQueueOverflows);
+		}
+		return;
+	}
+
+	convertAndPushPose(actor->id, actor, pose);
+}
+
+void CapturyLiveLinkSource::convertAndPushPose(int actorId, const CapturyActor* actor, const CapturyPose* pose)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CapturyNewPose);
+	FLiveLinkSubjectKey subjectKey;
+	FLiveLinkFrameDataStruct frameData;
+	ILiveLinkClient* client = convertPose(actorId, actor, pose, subjectKey, frameData);
+	if (client == nullptr)
+		return;
+
+	INC_DWORD_STAT(STAT_CapturyFramesPushed);
+	client->PushSubjectFrameData_AnyThread(subjectKey, MoveTemp(frameData));
+	Captury_poseConsumed(remoteCaptury, pose);
+}
+
+static void framerateChanged(RemoteCaptury* rc, int numerator, int denominator, void* userArg)
+{
+	((CapturyLiveLinkSource*)userArg)->framerateChanged(numerator, denominator);
+}
+
+// called once during the handshake and again if the framerate changes. never from the pose path.
+void CapturyLiveLinkSource::framerateChanged(int numerator, int denominator)
+{
+	TSharedPtr<const FString> rateString = MakeShared<FString>(FString::Printf(TEXT("%f"), numerator / (double)denominator));
+
+	mutx.Lock(); lockedAt = __LINE__; unlockedAt = -1;
+	framerate = FFrameRate(numerator, denominator);
+	framerateString = MoveTemp(rateString);
+	mutx.Unlock(); unlockedAt = __LINE__;
+}
+
+ILiveLinkClient* CapturyLiveLinkSource::convertPose(int actorId, const CapturyActor* actor, const CapturyPose* pose, FLiveLinkSubjectKey& subjectKey, FLiveLinkFrameDataStruct& frameData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(CapturyLiveLinkSource::convertPose);
+
 	// static uint64_t lastT = 0;
 	// if (pose->timestamp / 1000000 != lastT) {
 	// 	lastT = pose->timestamp / 1000000;
@@ -95,164 +251,143 @@ void CapturyLiveLinkSource::newPose(CapturyActor* actor, CapturyPose* pose, int
 	// }
 
 	mutx.Lock(); lockedAt = __LINE__; unlockedAt = -1;
-	if (liveLinkClient == nullptr) {
+	// RequestSourceShutdown() and disable() clear the client from the game thread
+	ILiveLinkClient* client = liveLinkClient;
+	if (client == nullptr) {
 		mutx.Unlock(); unlockedAt = __LINE__;
-		return;
+		return nullptr;
 	}
-	const FLiveLinkSubjectKey* subjectKey = haveActors.Find(actor->id);
-	if (subjectKey == nullptr) {
-		queuedActorIds.Enqueue(actor->id); // lock enqueue access because it is only thread safe for single producer - single consumer workflows and we have two producers here
-		UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: pushing new actor %x %s"), actor->id, ANSI_TO_TCHAR(actor->name));
+	const FLiveLinkSubjectKey* haveSubjectKey = haveActors.Find(actorId);
+	if (haveSubjectKey == nullptr) { // Update() adds the subject once the actor shows up in the change feed
 		mutx.Unlock(); unlockedAt = __LINE__;
-		return;
+		return nullptr;
 	}
+	subjectKey = *haveSubjectKey;
 
+	TSharedPtr<const RetargetPlan> plan = retargetPlans.FindRef(actorId);
+	const FFrameRate rate = framerate;
+	TSharedPtr<const FString> rateString = framerateString;
 	mutx.Unlock(); unlockedAt = __LINE__;
 
-	//
-
-	FLiveLinkFrameDataStruct animFrameData(FLiveLinkAnimationFrameData::StaticStruct());
-	FLiveLinkAnimationFrameData& animData = *animFrameData.Cast<FLiveLinkAnimationFrameData>();
-	FLiveLinkFrameDataStruct trafoFrameData(FLiveLinkTransformFrameData::StaticStruct());
-	FLiveLinkTransformFrameData& trafoData = *trafoFrameData.Cast<FLiveLinkTransformFrameData>();
-	if (!framerate.IsValid()) {
-		int num, denom;
-		Captury_getFramerate(remoteCaptury, &num, &denom);
-		framerate = FFrameRate(num, denom);
+	if (!plan.IsValid()) { // the actor changed since the plan was built
+		const CapturyActor* lookedUp = (actor == nullptr) ? Captury_getActor(remoteCaptury, actorId) : nullptr;
+		if (actor == nullptr && lookedUp == nullptr)
+			return nullptr;
+		TSharedPtr<const RetargetPlan> newPlan = setupRetargetPlan((actor != nullptr) ? actor : lookedUp);
+		Captury_freeActor(remoteCaptury, lookedUp);
+		mutx.Lock(); lockedAt = __LINE__; unlockedAt = -1;
+		retargetPlans.Add(actorId, newPlan);
+		mutx.Unlock(); unlockedAt = __LINE__;
+		plan = newPlan;
 	}
-
-	// we could transform Captury's time into local time here but that's complicated and the question is what anyone would need it for
-	if (actor->numJoints > 1) {
-		animData.WorldTime = FPlatformTime::Seconds();
-		animData.MetaData.SceneTime = FQualifiedFrameTime(framerate.AsFrameTime(pose->timestamp * 1e-6), framerate);
-
-		// raw timestamp as reported by CapturyLive (converted to seconds)
-		animData.MetaData.StringMetaData.Add(FName(TEXT("TimestampInSeconds")), FString::Printf(TEXT("%f"), pose->timestamp * 1e-6));
-		// tracking / streaming frame rate
-		animData.MetaData.StringMetaData.Add(FName(TEXT("FrameRate")), FString::Printf(TEXT("%f"), framerate.Numerator / (double)framerate.Denominator));
-		animData.MetaData.StringMetaData.Add(FName(TEXT("FrameNumber")), FString::Printf(TEXT("%d"), animData.MetaData.SceneTime.Time.FrameNumber.Value));
-
-		for (int i = 0; i < actor->numMetaData; ++i)
-			animData.MetaData.StringMetaData.Add(FName(actor->metaDataKeys[i]), actor->metaDataValues[i]);
-	} else {
-		trafoData.WorldTime = FPlatformTime::Seconds();
-		trafoData.MetaData.SceneTime = FQualifiedFrameTime(framerate.AsFrameTime(pose->timestamp * 1e-6), framerate);
-
-		// raw timestamp as reported by CapturyLive (converted to seconds)
-		trafoData.MetaData.StringMetaData.Add(FName(TEXT("TimestampInSeconds")), FString::Printf(TEXT("%f"), pose->timestamp * 1e-6));
-		// tracking / streaming frame rate
-		trafoData.MetaData.StringMetaData.Add(FName(TEXT("FrameRate")), FString::Printf(TEXT("%f"), framerate.Numerator / (double)framerate.Denominator));
-		trafoData.MetaData.StringMetaData.Add(FName(TEXT("FrameNumber")), FString::Printf(TEXT("%d"), trafoData.MetaData.SceneTime.Time.FrameNumber.Value));
-
-		for (int i = 0; i < actor->numMetaData; ++i)
-			trafoData.MetaData.StringMetaData.Add(FName(actor->metaDataKeys[i]), actor->metaDataValues[i]);
+	if (!plan->isValid)
+		return nullptr;
+
+	const bool isSkeleton = plan->isSkeleton;
+	frameData.InitializeWith(isSkeleton ? FLiveLinkAnimationFrameData::StaticStruct() : FLiveLinkTransformFrameData::StaticStruct(), nullptr);
+	FLiveLinkBaseFrameData& baseData = *frameData.GetBaseData();
+	FLiveLinkAnimationFrameData* animData = isSkeleton ? frameData.Cast<FLiveLinkAnimationFrameData>() : nullptr;
+	FLiveLinkTransformFrameData* trafoData = isSkeleton ? nullptr : frameData.Cast<FLiveLinkTransformFrameData>();
+
+	baseData.WorldTime = FPlatformTime::Seconds();
+	if (captureTimeSynchronized) {
+		// how long ago the pose was captured according to the synchronized clock. this takes the network
+		// jitter out of WorldTime so that LiveLink's buffering and interpolation follow the capture times.
+		const int64 age = (int64)Captury_getTime(remoteCaptury) - (int64)pose->timestamp;
+		if (age < 1000000) // anything older is not live, e.g. Captury Live was restarted
+			baseData.WorldTime -= FMath::Max<int64>(age, 0) * 1e-6;
 	}
-
-	TArray<FQuat> globalOrientations;
-	TArray<FQuat> globalPoseRotations;
-	TArray<float> globalScale;
-
-	static int once = 0;
+	baseData.MetaData.SceneTime = FQualifiedFrameTime(rate.AsFrameTime(pose->timestamp * 1e-6), rate);
+
+	// the frame data is moved into LiveLink so it needs its own copies of the meta data strings and its own
+	// transforms. these are allocated for every frame (see STAT_CapturyFrameDataBytes), everything else is
+	// prepared by setupRetargetPlan().
+	baseData.MetaData.StringMetaData.Reserve(3 + plan->metaData.Num());
+	// raw timestamp as reported by CapturyLive (converted to seconds)
+	baseData.MetaData.StringMetaData.Add(timestampInSecondsName, FString::Printf(TEXT("%f"), pose->timestamp * 1e-6));
+	// tracking / streaming frame rate
+	baseData.MetaData.StringMetaData.Add(frameRateName, rateString.IsValid() ? *rateString : FString());
+	baseData.MetaData.StringMetaData.Add(frameNumberName, FString::Printf(TEXT("%d"), baseData.MetaData.SceneTime.Time.FrameNumber.Value));
+
+	for (const TPair<FName, FString>& metaData : plan->metaData)
+		baseData.MetaData.StringMetaData.Add(metaData.Key, metaData.Value);
+
+	// scratch space is sized for all joints by setupRetargetPlan() and reused from frame to frame
+	const int numTransforms = FMath::Min<int>(pose->numTransforms, plan->bindPoses.Num());
+	TArray<FQuat>& globalPoseRotations = plan->globalPoseRotations;
+	globalPoseRotations.Reset(numTransforms);
+	TArray<float>& quats = plan->quats;
+	quats.Reset(numTransforms * 4);
+	quats.AddUninitialized(numTransforms * 4);
+
+	if (isSkeleton)
+		animData->Transforms.Reserve(numTransforms + (plan->addRootJoint ? 1 : 0));
 
 	// add Root joint
-	if (actor->numJoints > 1 && strcmp(actor->joints[0].name, "Hips") == 0)
-		animData.Transforms.Add(FTransform(FQuat(0.0f, 0.0f, 0.0f, 1.0f), FVector::ZeroVector, FVector::OneVector));
-
-	FQuat rot;
-	FVector trans;
-	for (int i = 0; i < pose->numTransforms; ++i) {
-		float rx = pose->transforms[i].rotation[0] * DEG2RADf;
-		float ry = pose->transforms[i].rotation[1] * DEG2RADf;
-		float rz = pose->transforms[i].rotation[2] * DEG2RADf;
-		FQuat poseRot = FQuat(FVector(0, 0, 1), rz) * FQuat(FVector(0, 1, 0), ry) * FQuat(FVector(1, 0, 0), rx);
-		//poseRot.X = pose->transforms[i].rotation[0];
-		//poseRot.Y = pose->transforms[i].rotation[1];
-		//poseRot.Z = pose->transforms[i].rotation[2];
-		//poseRot.W = 1.0f - poseRot.X * poseRot.X - poseRot.Y * poseRot.Y - poseRot.Z * poseRot.Z;
-		//poseRot.W = (poseRot.W <= 0.0f) ? 0.0f : std::sqrt(poseRot.W);
+	if (plan->addRootJoint)
+		animData->Transforms.Add(FTransform(FQuat(0.0f, 0.0f, 0.0f, 1.0f), FVector::ZeroVector, FVector::OneVector));
+
+	// convert all Euler angles to quaternions in one go
+	float* qx = quats.GetData();
+	float* qy = qx + numTransforms;
+	float* qz = qy + numTransforms;
+	float* qw = qz + numTransforms;
+	Captury_eulerToQuaternions(pose->transforms, numTransforms, qx, qy, qz, qw);
+
+	for (int i = 0; i < numTransforms; ++i) {
+		FQuat poseRot(qx[i], qy[i], qz[i], qw[i]);
 		globalPoseRotations.Add(poseRot);
 
-		if (actor->joints[i].parent >= 0) { // make local rotation
-			if (actor->joints[i].parent >= globalPoseRotations.Num()) {
-				UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: actor %s: parent of joint %d is invalid (%d)"), ANSI_TO_TCHAR(actor->name), i, actor->joints[i].parent);
-				return;
-			}
-			poseRot = globalPoseRotations[actor->joints[i].parent].Inverse() * poseRot;
-		}
-
-		FQuat bindPose;
-		bindPose.X = actor->joints[i].orientation[0];
-		bindPose.Y = actor->joints[i].orientation[1];
-		bindPose.Z = actor->joints[i].orientation[2];
-		bindPose.W = 1.0f - bindPose.X * bindPose.X - bindPose.Y * bindPose.Y - bindPose.Z * bindPose.Z;
-		bindPose.W = (bindPose.W <= 0.0f) ? 0.0f : std::sqrt(bindPose.W);
-		globalOrientations.Add(bindPose);
-
-		if (once < 3) {
-			if (i != 0) {
-				FQuat q(globalOrientations[actor->joints[i].parent].Inverse() * bindPose);
-				q.Y = -q.Y;
-				q.W = -q.W;
-				FRotator r(q);
-				UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: actor %s joint %s rel: %g %g %g (%g, %g, %g, %g)"), ANSI_TO_TCHAR(actor->name), ANSI_TO_TCHAR(actor->joints[i].name), r.Roll, r.Pitch, r.Yaw, bindPose.W, bindPose.X, bindPose.Y, bindPose.Z);
-			} else {
-				FRotator r(bindPose);
-				UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: actor %s joint %s: %g %g %g (%g, %g, %g, %g)"), ANSI_TO_TCHAR(actor->name), ANSI_TO_TCHAR(actor->joints[i].name), r.Roll, r.Pitch, r.Yaw, bindPose.W, bindPose.X, bindPose.Y, bindPose.Z);
-			}
-		}
+		const int32 parent = plan->parents[i];
+		if (parent >= 0) // make local rotation
+			poseRot = globalPoseRotations[parent].Inverse() * poseRot;
 
-		float parentScale;
+		FQuat rot;
+		FVector trans;
 		if (i == 0) {
-			parentScale = 1.0f;
 			trans = FVector(pose->transforms[i].translation[0] * scaleToUnreal,
 					pose->transforms[i].translation[1] * scaleToUnreal,
 					pose->transforms[i].translation[2] * scaleToUnreal);
 
 			// rotate Y-is-up to Z-is-up
-			rot = FQuat(FVector(1, 0, 0), 90 * DEG2RADf) * poseRot * bindPose;
-			trans = FQuat(FVector(1, 0, 0), 90 * DEG2RADf) * trans;
+			rot = yUpToZUp * poseRot * plan->bindPoses[i];
+			trans = yUpToZUp * trans;
+
+			// switch from right-handed to left-handed coordinate system
+			trans.Y = -trans.Y;
 		} else {
-			parentScale = globalScale[actor->joints[i].parent];
-			trans = FVector(actor->joints[i].offset[0] * scaleToUnreal / parentScale,
-					actor->joints[i].offset[1] * scaleToUnreal / parentScale,
-					actor->joints[i].offset[2] * scaleToUnreal / parentScale);
-
-			// relative to parent
-			FQuat relBindPose = globalOrientations[actor->joints[i].parent].Inverse() * bindPose;
-			trans = globalOrientations[actor->joints[i].parent].Inverse() * trans;
-			rot = relBindPose * globalOrientations[i].Inverse() * poseRot * globalOrientations[i];
+			rot = plan->relativeBindPoses[i] * plan->bindPoseInverses[i] * poseRot * plan->bindPoses[i];
+			trans = plan->offsets[i];
 		}
-		float scale = actor->joints[i].scale[0];
-		globalScale.Add(parentScale * scale);
 
 		// unreal does this during FBX loading for some reason
 		rot.Y = -rot.Y;
 		rot.W = -rot.W;
 
-		// switch from right-handed to left-handed coordinate system
-		trans.Y = -trans.Y;
-
-		FTransform trafo(rot, trans, FVector(scale));
-		if (actor->numJoints > 1)
-			animData.Transforms.Add(trafo);
+		if (isSkeleton)
+			animData->Transforms.Emplace(rot, trans, plan->scales[i]);
 		else
-			trafoData.Transform = trafo;
+			trafoData->Transform = FTransform(rot, trans, plan->scales[i]);
 	}
 
 	// add blend shapes as properties
-	if (pose->numBlendShapes != 0) {
-		TArray<float>& propVals = animFrameData.GetBaseData()->PropertyValues;
+	if (isSkeleton && pose->numBlendShapes != 0) {
+		TArray<float>& propVals = baseData.PropertyValues;
 		propVals.SetNumZeroed(pose->numBlendShapes);
 		for (int i = 0; i < pose->numBlendShapes; ++i)
 			propVals[i] = pose->blendShapeActivations[i];
 	}
 
-	once++;
+#if STATS
+	SIZE_T frameBytes = baseData.MetaData.StringMetaData.GetAllocatedSize() + baseData.PropertyValues.GetAllocatedSize();
+	for (const TPair<FName, FString>& metaData : baseData.MetaData.StringMetaData)
+		frameBytes += metaData.Value.GetAllocatedSize();
+	if (isSkeleton)
+		frameBytes += animData->Transforms.GetAllocatedSize();
+	INC_DWORD_STAT_BY(STAT_CapturyFrameDataBytes, (uint32)frameBytes);
+#endif
 
-	if (actor->numJoints > 1)
-		liveLinkClient->PushSubjectFrameData_AnyThread(*subjectKey, MoveTemp(animFrameData));
-	else
-		liveLinkClient->PushSubjectFrameData_AnyThread(*subjectKey, MoveTemp(trafoFrameData));
+	return client;
 }
 
 static void arTagDetected(RemoteCaptury* remoteCaptury, int num, CapturyARTag* tags, void* userArg)
@@ -262,17 +397,20 @@ static void arTagDetected(RemoteCaptury* remoteCaptury, int num, CapturyARTag* t
 
 void CapturyLiveLinkSource::arTagDetected(int num, CapturyARTag* tags)
 {
-	if (liveLinkClient == nullptr)
-		return;
-
 	for (int i = 0; i < num; ++i) {
 		mutx.Lock(); lockedAt = __LINE__; unlockedAt = -1;
-		const FLiveLinkSubjectKey* subjectKey = haveActors.Find(tags[i].id);
-		if (subjectKey == nullptr) {
+		ILiveLinkClient* client = liveLinkClient;
+		if (client == nullptr) {
+			mutx.Unlock(); unlockedAt = __LINE__;
+			return;
+		}
+		const FLiveLinkSubjectKey* haveSubjectKey = haveActors.Find(tags[i].id);
+		if (haveSubjectKey == nullptr) {
 			mutx.Unlock(); unlockedAt = __LINE__;
 			queuedARTags.Enqueue(tags[i].id);
 			continue;
 		}
+		const FLiveLinkSubjectKey subjectKey = *haveSubjectKey;
 
 		mutx.Unlock(); unlockedAt = __LINE__;
 
@@ -286,8 +424,8 @@ void CapturyLiveLinkSource::arTagDetected(int num, CapturyARTag* tags)
 					tags[i].transform.translation[2] * scaleToUnreal);
 
 		// rotate Y-is-up to Z-is-up
-		FQuat rot = FQuat(FVector(1, 0, 0), 90 * DEG2RADf) * poseRot;
-		trans = FQuat(FVector(1, 0, 0), 90 * DEG2RADf) * trans;
+		FQuat rot = yUpToZUp * poseRot;
+		trans = yUpToZUp * trans;
 
 		// unreal does this during FBX loading for some reason
 		rot.Y = -rot.Y;
@@ -304,11 +442,11 @@ void CapturyLiveLinkSource::arTagDetected(int num, CapturyARTag* tags)
 
 		data.Transform = trafo;
 
-		liveLinkClient->PushSubjectFrameData_AnyThread(*subjectKey, MoveTemp(frameData));
+		client->PushSubjectFrameData_AnyThread(subjectKey, MoveTemp(frameData));
 	}
 }
 
-CapturyLiveLinkSource::CapturyLiveLinkSource(const FText& ip, bool useTCP, bool streamARTags, bool streamCompressed) : ipAddress(ip), enabled(true), status(LOCTEXT("statusConnecting", "connecting")), connected(false), queuedActorIds(10), queuedActorIdsToRemove(10), queuedARTags(10)
+CapturyLiveLinkSource::CapturyLiveLinkSource(const FText& ip, bool useTCP, bool streamARTags, bool streamCompressed, bool convertOnWorkerThread, bool sharedIOThread, bool useCaptureTime) : ipAddress(ip), enabled(true), status(LOCTEXT("statusConnecting", "connecting")), connected(false), useCaptureTime(useCaptureTime), queuedARTags(10)
 {
 	++sourceCount;
 	sourceIndex = 1;
@@ -327,18 +465,33 @@ CapturyLiveLinkSource::CapturyLiveLinkSource(const FText& ip, bool useTCP, bool
 			prefix = FString::Printf(TEXT("%s{%d}:"), *ip.ToString(), sourceIndex);
 	}
 
-	UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: connecting to %s, tcp: %d, artags: %d, compressed: %d, idx: %d, prefix %s"), *ip.ToString(), useTCP, streamARTags, streamCompressed, sourceIndex, *prefix);
+	UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: connecting to %s, tcp: %d, artags: %d, compressed: %d, worker: %d, shared io: %d, capture time: %d, idx: %d, prefix %s"), *ip.ToString(), useTCP, streamARTags, streamCompressed, convertOnWorkerThread, sharedIOThread, useCaptureTime, sourceIndex, *prefix);
 
 	remoteCaptury = Captury_create();
 	if (remoteCaptury) {
 		Captury_enablePrintf(remoteCaptury, 0);
+		// Captury Live sends the framerate during the handshake (a capture contains it as well)
+		Captury_registerFramerateChangedCallback(remoteCaptury, ::framerateChanged, this);
+
+		if (convertOnWorkerThread)
+			ingestWorker = MakeUnique<IngestWorker>(this);
+
+		// all sources that enable this share one thread for their sockets instead of running their own
+		if (sharedIOThread)
+			Captury_useSharedReactor(remoteCaptury, 1);
+
+		// instead of an IP address this can be the path to a packet capture which is replayed in real time
+		if (FPaths::FileExists(ip.ToString())) {
+			Captury_registerNewPoseCallback(remoteCaptury, ::newPose, this);
+			Captury_registerARTagCallback(remoteCaptury, ::arTagDetected, this);
+			if (!Captury_replayPacketCapture(remoteCaptury, TCHAR_TO_ANSI(*ip.ToString()), 1.0))
+				UE_LOG(LogCaptury, Warning, TEXT("CapturyLiveLink: cannot replay %s"), *ip.ToString());
+			return;
+		}
+
 		Captury_connect2(remoteCaptury, TCHAR_TO_ANSI(*ip.ToString()), 2101, 0, 0, 1);
-		int numerator, denominator;
-		Captury_getFramerate(remoteCaptury, &numerator, &denominator);
-		framerate = FFrameRate(numerator, denominator);
 
 		Captury_registerNewPoseCallback(remoteCaptury, ::newPose, this);
-		Captury_registerActorChangedCallback(remoteCaptury, ::actorChanged, this);
 		Captury_registerARTagCallback(remoteCaptury, ::arTagDetected, this);
 
 		int what = CAPTURY_STREAM_GLOBAL_POSES | CAPTURY_STREAM_BLENDSHAPES | CAPTURY_STREAM_ONLY_ROOT_TRANSLATION;
@@ -349,6 +502,9 @@ CapturyLiveLinkSource::CapturyLiveLinkSource(const FText& ip, bool useTCP, bool
 		if (streamCompressed)
 			what |= CAPTURY_STREAM_COMPRESSED;
 		Captury_startStreaming(remoteCaptury, what);
+
+		if (useCaptureTime)
+			Captury_startTimeSynchronizationLoop(remoteCaptury);
 	}
 }
 
@@ -401,6 +557,82 @@ FLiveLinkStaticDataStruct CapturyLiveLinkSource::setupSkeletonDefinition(const C
 	return staticData;
 }
 
+TSharedPtr<const CapturyLiveLinkSource::RetargetPlan> CapturyLiveLinkSource::setupRetargetPlan(const CapturyActor* actor)
+{
+	TSharedPtr<RetargetPlan> plan = MakeShared<RetargetPlan>();
+	plan->isSkeleton = (actor->numJoints > 1);
+	plan->addRootJoint = (actor->numJoints > 1 && strcmp(actor->joints[0].name, "Hips") == 0);
+	plan->parents.SetNumUninitialized(actor->numJoints);
+	plan->bindPoses.SetNumUninitialized(actor->numJoints);
+	plan->bindPoseInverses.SetNumUninitialized(actor->numJoints);
+	plan->relativeBindPoses.SetNumUninitialized(actor->numJoints);
+	plan->offsets.SetNumUninitialized(actor->numJoints);
+	plan->scales.SetNumUninitialized(actor->numJoints);
+
+	TArray<float> globalScale;
+	globalScale.SetNumUninitialized(actor->numJoints);
+
+	plan->metaData.Reserve(actor->numMetaData);
+	for (int i = 0; i < actor->numMetaData; ++i)
+		plan->metaData.Emplace(FName(actor->metaDataKeys[i]), FString(actor->metaDataValues[i]));
+
+	plan->globalPoseRotations.Reserve(actor->numJoints);
+	plan->quats.Reserve(actor->numJoints * 4);
+
+	for (int i = 0; i < actor->numJoints; ++i) {
+		const int32 parent = actor->joints[i].parent;
+		if (parent >= i) {
+			UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: actor %s: parent of joint %d is invalid (%d)"), ANSI_TO_TCHAR(actor->name), i, parent);
+			plan->isValid = false;
+			return plan;
+		}
+		plan->parents[i] = parent;
+
+		FQuat bindPose;
+		bindPose.X = actor->joints[i].orientation[0];
+		bindPose.Y = actor->joints[i].orientation[1];
+		bindPose.Z = actor->joints[i].orientation[2];
+		bindPose.W = 1.0f - bindPose.X * bindPose.X - bindPose.Y * bindPose.Y - bindPose.Z * bindPose.Z;
+		bindPose.W = (bindPose.W <= 0.0f) ? 0.0f : std::sqrt(bindPose.W);
+		plan->bindPoses[i] = bindPose;
+		plan->bindPoseInverses[i] = bindPose.Inverse();
+
+		const float scale = actor->joints[i].scale[0];
+		plan->scales[i] = FVector(scale);
+
+		if (i == 0 || parent < 0) {
+			plan->relativeBindPoses[i] = bindPose;
+			plan->offsets[i] = FVector::ZeroVector; // the root translation comes from the pose
+			globalScale[i] = scale;
+
+			FRotator r(bindPose);
+			UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: actor %s joint %s: %g %g %g (%g, %g, %g, %g)"), ANSI_TO_TCHAR(actor->name), ANSI_TO_TCHAR(actor->joints[i].name), r.Roll, r.Pitch, r.Yaw, bindPose.W, bindPose.X, bindPose.Y, bindPose.Z);
+			continue;
+		}
+
+		const FQuat parentInverse = plan->bindPoses[parent].Inverse();
+		const float parentScale = globalScale[parent];
+		globalScale[i] = parentScale * scale;
+
+		// relative to parent
+		plan->relativeBindPoses[i] = parentInverse * bindPose;
+		FVector trans = parentInverse * FVector(actor->joints[i].offset[0] * scaleToUnreal / parentScale,
+							actor->joints[i].offset[1] * scaleToUnreal / parentScale,
+							actor->joints[i].offset[2] * scaleToUnreal / parentScale);
+		// switch from right-handed to left-handed coordinate system
+		trans.Y = -trans.Y;
+		plan->offsets[i] = trans;
+
+		FQuat q(plan->relativeBindPoses[i]);
+		q.Y = -q.Y;
+		q.W = -q.W;
+		FRotator r(q);
+		UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: actor %s joint %s rel: %g %g %g (%g, %g, %g, %g)"), ANSI_TO_TCHAR(actor->name), ANSI_TO_TCHAR(actor->joints[i].name), r.Roll, r.Pitch, r.Yaw, bindPose.W, bindPose.X, bindPose.Y, bindPose.Z);
+	}
+
+	return plan;
+}
+
 void CapturyLiveLinkSource::addSubject(const CapturyActor* actor) // mutx is held here
 {
 	if (haveActors.Find(actor->id) != 0) {
@@ -425,61 +657,122 @@ void CapturyLiveLinkSource::addSubject(const CapturyActor* actor) // mutx is hel
 	}
 
 	haveActors.FindOrAdd(actor->id, subjectKey);
+	retargetPlans.Add(actor->id, setupRetargetPlan(actor));
 }
 
+void CapturyLiveLinkSource::removeSubject(int actorId)
+{
+	FScopeLock guard(&mutx); lockedAt = __LINE__; unlockedAt = -1;
+	const FLiveLinkSubjectKey* subjectKey = haveActors.Find(actorId);
+	if (subjectKey == nullptr) {
+		unlockedAt = __LINE__;
+		return;
+	}
+
+	liveLinkClient->RemoveSubject_AnyThread(*subjectKey);
+
+	haveActors.Remove(actorId);
+	haveActors.Compact();
+	retargetPlans.Remove(actorId);
+	UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: removing stopped actor %x"), actorId);
+	unlockedAt = __LINE__;
+}
+
+// brings the subjects in line with the full list of actors and continues the change feed from there
 void CapturyLiveLinkSource::addSubjects()
 {
 	check(IsInGameThread());
 
+	// changes that happen while the actors are being added are replayed by the next Update()
+	lastActorChange = Captury_getActorChangeSequence(remoteCaptury);
+
 	const CapturyActor* actors = nullptr;
 	int numActors = Captury_getActors(remoteCaptury, &actors);
 	UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: got %d actors"), numActors);
 
+	TArray<const CapturyActor*> activeActors;
+	for (int i = 0; i < numActors; ++i) {
+		int mode = Captury_getActorStatus(remoteCaptury, actors[i].id);
+		if (mode == ACTOR_SCALING || mode == ACTOR_TRACKING)
+			activeActors.Add(&actors[i]);
+	}
+
+	TArray<int> goneActorIds;
 	mutx.Lock(); lockedAt = __LINE__; unlockedAt = -1;
-	for (int i = 0; i < numActors; ++i)
-		addSubject(&actors[i]);
+	for (const CapturyActor* actor : activeActors)
+		addSubject(actor);
+	for (const TPair<int, TSharedPtr<const RetargetPlan>>& plan : retargetPlans) { // every actor subject has an entry, AR tags do not
+		if (!activeActors.ContainsByPredicate([&](const CapturyActor* actor) { return actor->id == plan.Key; }))
+			goneActorIds.Add(plan.Key);
+	}
 	mutx.Unlock(); unlockedAt = __LINE__;
 
 	Captury_freeActors(remoteCaptury);
+
+	for (int actorId : goneActorIds)
+		removeSubject(actorId);
 }
 
-void CapturyLiveLinkSource::Update()
+void CapturyLiveLinkSource::applyActorChange(const CapturyActorChange& change)
 {
-	int actorId;
+	if (change.type == CAPTURY_ACTOR_REMOVED) {
+		Captury_log(remoteCaptury, CAPTURY_LOG_INFO, "Unreal: actor %x now has mode %s. deleting.", change.actorId, CapturyActorStatusString[change.status]);
+		removeSubject(change.actorId);
+		return;
+	}
+
+	const CapturyActor* actor = Captury_getActor(remoteCaptury, change.actorId);
+	if (actor == nullptr) { // another change follows once the definition has arrived
+		UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: actor %x is %s but not defined yet"), change.actorId, ANSI_TO_TCHAR(CapturyActorStatusString[change.status]));
+		return;
+	}
+
+	Captury_log(remoteCaptury, CAPTURY_LOG_INFO, "Unreal: actor %x now has mode %s. %s.", change.actorId, CapturyActorStatusString[change.status], (change.type == CAPTURY_ACTOR_CHANGED) ? "updating" : "adding");
 	mutx.Lock(); lockedAt = __LINE__; unlockedAt = -1;
-	TArray<int> requeue;
+	if (change.type == CAPTURY_ACTOR_CHANGED) // push the new skeleton under the same subject
+		haveActors.Remove(change.actorId);
+	addSubject(actor);
+	mutx.Unlock(); unlockedAt = __LINE__;
 
+	Captury_freeActor(remoteCaptury, actor);
+}
+
+void CapturyLiveLinkSource::Update()
+{
 	if (liveLinkClient == nullptr)
 		return;
 
-	while (queuedActorIdsToRemove.Dequeue(actorId)) {
-		FScopeLock guard(&mutx); lockedAt = __LINE__; unlockedAt = -1;
-		const FLiveLinkSubjectKey* subjectKey = haveActors.Find(actorId);
-		if (subjectKey == nullptr)
+	// only the actors that changed since the last tick are looked at. nothing is locked if none did.
+	CapturyActorChange changes[64];
+	int numChanges;
+	while ((numChanges = Captury_getActorChanges(remoteCaptury, lastActorChange, changes, UE_ARRAY_COUNT(changes))) != 0) {
+		if (numChanges < 0) { // fell too far behind
+			UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: missed actor changes, getting all actors"));
+			addSubjects();
 			continue;
+		}
 
-		liveLinkClient->RemoveSubject_AnyThread(*subjectKey); // The lock used on AnyThread is used on LiveLinkClient::Tick which calls this function causing deadlock if called by another thread
-
-		haveActors.Remove(actorId);
-		haveActors.Compact();
-		UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: removing stopped actor %x"), actorId);
-		unlockedAt = __LINE__;
-	}
-
-	while (queuedActorIds.Dequeue(actorId)) {
-		const CapturyActor* actor = Captury_getActor(remoteCaptury, actorId);
-		if (actor != nullptr) {
-			addSubject(actor);
-			Captury_freeActor(remoteCaptury, actor);
-		} else
-			requeue.Push(actorId);
+		for (int i = 0; i < numChanges; ++i)
+			applyActorChange(changes[i]);
+		lastActorChange = changes[numChanges - 1].sequence;
 	}
 
-	for (int id : requeue) {
-		UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink update: requeue %x"), id);
-		queuedActorIds.Enqueue(id);
+#if STATS
+	CapturyStats stats;
+	Captury_getStats(remoteCaptury, &stats);
+	SET_FLOAT_STAT(STAT_CapturyReceiveToParseP99, stats.receiveToParse.p99Ns * 0.001f);
+	SET_FLOAT_STAT(STAT_CapturyParseToCallbackP99, stats.parseToCallback.p99Ns * 0.001f);
+	SET_FLOAT_STAT(STAT_CapturyCallbackToPushP99, stats.callbackToConsumed.p99Ns * 0.001f);
+	SET_DWORD_STAT(STAT_CapturyDroppedPoses, (uint32)stats.numDroppedPoses);
+	SET_DWORD_STAT(STAT_CapturyReassemblyFailures, (uint32)stats.numReassemblyFailures);
+	SET_DWORD_STAT(STAT_CapturyIngestQueueDepth, ingestWorker.IsValid() ? ingestWorker->depth() : 0);
+#endif
+
+	if (useCaptureTime) {
+		CapturyTimeSyncStats syncStats;
+		captureTimeSynchronized = (Captury_getTimeSyncStats(remoteCaptury, &syncStats) != 0);
+		SET_DWORD_STAT(STAT_CapturyTimeSyncErrorBound, syncStats.errorBound);
 	}
-	mutx.Unlock(); unlockedAt = __LINE__;
 
 	int id;
 	while (queuedARTags.Dequeue(id)) {
@@ -507,6 +800,11 @@ bool CapturyLiveLinkSource::IsSourceStillValid() const
 
 CapturyLiveLinkSource::~CapturyLiveLinkSource()
 {
+	if (ingestWorker.IsValid()) {
+		// stop the threads delivering poses before the worker releases what is left in its queue
+		Captury_disconnect(remoteCaptury);
+		ingestWorker.Reset();
+	}
 	Captury_destroy(remoteCaptury);
 
 	--sourceCount;
@@ -536,6 +834,7 @@ void CapturyLiveLinkSource::disable()
 
 	mutx.Lock(); lockedAt = __LINE__; unlockedAt = -1;
 	haveActors.Reset();
+	retargetPlans.Reset();
 
 	liveLinkClient = nullptr;
 	mutx.Unlock(); unlockedAt = __LINE__;
@@ -573,15 +872,8 @@ FText CapturyLiveLinkSource::GetSourceStatus() const
 		return LOCTEXT("statusConnecting", "connecting...");
 	case CAPTURY_CONNECTED:
 		if (!connected) {
-			const CapturyActor* actors = nullptr;
-			int numActors = Captury_getActors(remoteCaptury, &actors);
-
-			mutx.Lock(); lockedAt = __LINE__; unlockedAt = -1;
-			for (int i = 0; i < numActors; ++i)
-				queuedActorIds.Enqueue(actors[i].id);
-			mutx.Unlock(); unlockedAt = __LINE__;
-			UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: status: connected with %d actors"), numActors);
-
+			// the actors of the new connection arrive through the change feed
+			UE_LOG(LogCaptury, Display, TEXT("CapturyLiveLink: status: connected"));
 			connected = true;
 		}
 		return LOCTEXT("statusConnected", "connected");
@@ -4,12 +4,16 @@
 #include <atomic>
 #include <mutex>
 #include <thread>
+#include <new>
 #include <algorithm>
 #include <string>
 #include <vector>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
+#include <functional>
+#include <future>
 #include <list>
 #include <ctime>
 #include <time.h>
@@ -56,14 +60,34 @@
 #else
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <pthread.h>
 #include <errno.h>
+#if defined(__linux__) && (defined(_GNU_SOURCE) || defined(__ANDROID__))
+#define CAPTURY_HAVE_RECVMMSG // drain multiple datagrams per system call
+#endif
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define CAPTURY_HAVE_EPOLL // edge-triggered readiness for the shared reactor
+#else
+#include <poll.h>
+#endif
 #endif
 
 #include <stdarg.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CAPTURY_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CAPTURY_SIMD_WIDTH 4
+#endif
+
 typedef uint32_t uint;
 
 #if defined(__clang__) && (!defined(SWIG))
@@ -83,6 +107,7 @@ typedef uint32_t uint;
 #ifdef WIN32
 
 #define socklen_t int
+#define SHUT_RDWR SD_BOTH
 #define sleepMicroSeconds(us) Sleep(us / 1000)
 
 static inline int sockerror()		{ return WSAGetLastError(); }
@@ -95,6 +120,17 @@ static inline int setSocketTimeout(SOCKET sock, int timeout_ms)
 	return setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
 }
 
+static inline int setSocketNonBlocking(SOCKET sock)
+{
+	u_long nonBlocking = 1;
+	return ioctlsocket(sock, FIONBIO, &nonBlocking);
+}
+
+static inline bool isConnectInProgress(int err)	{ return (err == WSAEWOULDBLOCK); }
+
+#define poll WSAPoll
+typedef WSAPOLLFD pollfd;
+
 static bool wsaInited = false;
 
 #else
@@ -123,24 +159,464 @@ static inline int setSocketTimeout(SOCKET sock, int timeout_ms)
 	return setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char*)&tv, sizeof(tv));
 }
 
+static inline int setSocketNonBlocking(SOCKET sock)
+{
+	return fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+}
+
+static inline bool isConnectInProgress(int err)	{ return (err == EINPROGRESS); }
+
 #endif
 
 typedef std::shared_ptr<CapturyActor> CapturyActor_p;
 
+// a decoded pose that is shared between the stream thread, the new pose callback and pose views without copying.
+// pose has to be the first member so that a CapturyPose handed out to the user can be mapped back to its buffer.
+struct PoseBuffer {
+	CapturyPose		pose;
+	std::atomic<int>	references; // one held by the pool, one while published or written, one per view
+	int			trackingQuality;
+	uint64_t		callbackNs; // when the new pose callback was called with this pose
+
+	// transforms and blend shape activations live in the same allocation right behind the buffer
+	static PoseBuffer* create(int actorId, int numTransforms, int numBlendShapes)
+	{
+		void* memory = calloc(1, sizeof(PoseBuffer) + numTransforms * sizeof(CapturyTransform) + numBlendShapes * sizeof(float));
+		PoseBuffer* buffer = new (memory) PoseBuffer;
+		buffer->pose.actor = actorId;
+		buffer->pose.numTransforms = numTransforms;
+		buffer->pose.transforms = (CapturyTransform*)&buffer[1];
+		buffer->pose.numBlendShapes = numBlendShapes;
+		buffer->pose.blendShapeActivations = (float*)(buffer->pose.transforms + numTransforms);
+		buffer->references = 1;
+		buffer->trackingQuality = 0;
+		buffer->callbackNs = 0;
+		return buffer;
+	}
+
+	static PoseBuffer* fromPose(const CapturyPose* pose)
+	{
+		return (PoseBuffer*)pose;
+	}
+
+	void retain()
+	{
+		references.fetch_add(1);
+	}
+
+	void release()
+	{
+		if (references.fetch_sub(1) == 1) {
+			this->~PoseBuffer();
+			free(this);
+		}
+	}
+};
+
+// takes a reference on the buffer that is currently published in latest
+template <class Buffer>
+static Buffer* acquirePublished(const std::atomic<Buffer*>& latest)
+{
+	while (true) {
+		Buffer* buffer = latest.load();
+		if (buffer == nullptr)
+			return nullptr;
+
+		// the pool keeps the buffer alive. if it was replaced in the mean time
+		// the writer may be about to reuse it so try again with the new one.
+		buffer->retain();
+		if (latest.load() == buffer)
+			return buffer;
+		buffer->release();
+	}
+}
+
+// most recent pose of an actor. written by the stream thread with mainMutex held, read by any thread without locking.
+// the writer decodes into a buffer that nobody else references and publishes it by swapping a pointer.
+// readers take a reference on the published buffer which keeps it unchanged until they release it.
+struct PoseMailbox {
+	const int			actorId;
+	const int			numTransforms;
+	const int			numBlendShapes;
+	std::vector<PoseBuffer*>	pool; // guarded by mainMutex
+	std::atomic<PoseBuffer*>	latest {nullptr};
+
+	PoseMailbox(int actorId, int numTransforms, int numBlendShapes) : actorId(actorId), numTransforms(numTransforms), numBlendShapes(numBlendShapes)
+	{
+	}
+
+	~PoseMailbox()
+	{
+		PoseBuffer* buffer = latest.exchange(nullptr);
+		if (buffer != nullptr)
+			buffer->release();
+		// buffers still held by views are freed when the last view is released
+		for (PoseBuffer* b : pool)
+			b->release();
+	}
+
+	// returns a buffer to decode the next pose into. has to be passed to publish() or released.
+	PoseBuffer* claim()
+	{
+		for (PoseBuffer* buffer : pool) {
+			int onlyPool = 1;
+			if (buffer->references.compare_exchange_strong(onlyPool, 2))
+				return buffer;
+		}
+
+		// all buffers are published or held by views
+		PoseBuffer* buffer = PoseBuffer::create(actorId, numTransforms, numBlendShapes);
+		buffer->retain();
+		pool.push_back(buffer);
+		return buffer;
+	}
+
+	// takes over the reference from claim()
+	void publish(PoseBuffer* buffer)
+	{
+		PoseBuffer* previous = latest.exchange(buffer);
+		if (previous != nullptr)
+			previous->release();
+	}
+
+	// returns the most recent pose with a reference taken or NULL if nothing was published yet
+	PoseBuffer* acquire() const
+	{
+		return acquirePublished(latest);
+	}
+};
+
+// all poses of one frame in a single allocation. snapshot has to be the first member, see PoseBuffer.
+struct FrameSnapshotBuffer {
+	CapturyFrameSnapshot	snapshot;
+	std::atomic<int>	references; // same scheme as PoseBuffer
+	size_t			capacity; // bytes available behind the buffer
+
+	static FrameSnapshotBuffer* create(size_t capacity)
+	{
+		void* memory = malloc(sizeof(FrameSnapshotBuffer) + capacity);
+		FrameSnapshotBuffer* buffer = new (memory) FrameSnapshotBuffer;
+		buffer->references = 1;
+		buffer->capacity = capacity;
+		return buffer;
+	}
+
+	static FrameSnapshotBuffer* fromSnapshot(const CapturyFrameSnapshot* snapshot)
+	{
+		return (FrameSnapshotBuffer*)snapshot;
+	}
+
+	void retain()
+	{
+		references.fetch_add(1);
+	}
+
+	void release()
+	{
+		if (references.fetch_sub(1) == 1) {
+			this->~FrameSnapshotBuffer();
+			free(this);
+		}
+	}
+
+	// copies the poses into the buffer which must be large enough (see size())
+	void fill(const std::vector<PoseBuffer*>& poses, uint64_t version)
+	{
+		const int numPoses = (int)poses.size();
+		snapshot.version = version;
+		snapshot.timestamp = poses[0]->pose.timestamp;
+		snapshot.numPoses = numPoses;
+		snapshot.poses = (CapturyPose*)&this[1];
+		snapshot.trackingQualities = (int32_t*)(snapshot.poses + numPoses);
+
+		char* at = (char*)(snapshot.trackingQualities + numPoses);
+		for (int i = 0; i < numPoses; ++i) {
+			const CapturyPose& from = poses[i]->pose;
+			CapturyPose& to = snapshot.poses[i];
+			to = from;
+			to.transforms = (CapturyTransform*)at;
+			memcpy(to.transforms, from.transforms, from.numTransforms * sizeof(CapturyTransform));
+			at += from.numTransforms * sizeof(CapturyTransform);
+			to.blendShapeActivations = (float*)at;
+			memcpy(to.blendShapeActivations, from.blendShapeActivations, from.numBlendShapes * sizeof(float));
+			at += from.numBlendShapes * sizeof(float);
+			snapshot.trackingQualities[i] = poses[i]->trackingQuality;
+		}
+	}
+
+	static size_t size(const std::vector<PoseBuffer*>& poses)
+	{
+		size_t size = poses.size() * (sizeof(CapturyPose) + sizeof(int32_t));
+		for (const PoseBuffer* buffer : poses)
+			size += buffer->pose.numTransforms * sizeof(CapturyTransform) + buffer->pose.numBlendShapes * sizeof(float);
+		return size;
+	}
+};
+
+// the poses of one frame as structure of arrays in a single allocation. arrays has to be the first member.
+struct FrameArraysBuffer {
+	CapturyFrameArrays	arrays;
+	std::atomic<int>	references; // same scheme as PoseBuffer
+	size_t			capacity; // bytes available behind the buffer
+
+	static FrameArraysBuffer* create(size_t capacity)
+	{
+		void* memory = malloc(sizeof(FrameArraysBuffer) + capacity);
+		FrameArraysBuffer* buffer = new (memory) FrameArraysBuffer;
+		buffer->references = 1;
+		buffer->capacity = capacity;
+		return buffer;
+	}
+
+	static FrameArraysBuffer* fromArrays(const CapturyFrameArrays* arrays)
+	{
+		return (FrameArraysBuffer*)arrays;
+	}
+
+	void retain()
+	{
+		references.fetch_add(1);
+	}
+
+	void release()
+	{
+		if (references.fetch_sub(1) == 1) {
+			this->~FrameArraysBuffer();
+			free(this);
+		}
+	}
+
+	// number of floats reserved for an array of n entries so that the next array stays aligned
+	static size_t padded(int n)
+	{
+		return ((size_t)n + 15) & ~(size_t)15;
+	}
+
+	// copies the poses into the buffer which must be large enough (see size())
+	void fill(const std::vector<PoseBuffer*>& poses, uint64_t version)
+	{
+		const int numActors = (int)poses.size();
+		int numJoints = 0;
+		int numBlendShapes = 0;
+		for (const PoseBuffer* buffer : poses) {
+			numJoints += buffer->pose.numTransforms;
+			numBlendShapes += buffer->pose.numBlendShapes;
+		}
+
+		arrays.version = version;
+		arrays.timestamp = poses[0]->pose.timestamp;
+		arrays.numActors = numActors;
+		arrays.numJoints = numJoints;
+		arrays.numBlendShapes = numBlendShapes;
+
+		// float arrays first, each starting on a 64 byte boundary
+		float* at = (float*)(((uintptr_t)&this[1] + 63) & ~(uintptr_t)63);
+		for (int x = 0; x < 3; ++x) {
+			arrays.translation[x] = at;
+			at += padded(numJoints);
+		}
+		for (int x = 0; x < 3; ++x) {
+			arrays.rotation[x] = at;
+			at += padded(numJoints);
+		}
+		arrays.blendShapeActivations = at;
+		at += padded(numBlendShapes);
+
+		int32_t* ints = (int32_t*)at;
+		arrays.actorIds = ints;
+		arrays.trackingQualities = ints + numActors;
+		arrays.firstJoint = ints + 2 * numActors;
+		arrays.firstBlendShape = ints + 3 * numActors + 1;
+
+		int joint = 0;
+		int blendShape = 0;
+		for (int i = 0; i < numActors; ++i) {
+			const CapturyPose& pose = poses[i]->pose;
+			arrays.actorIds[i] = pose.actor;
+			arrays.trackingQualities[i] = poses[i]->trackingQuality;
+			arrays.firstJoint[i] = joint;
+			arrays.firstBlendShape[i] = blendShape;
+			for (int j = 0; j < pose.numTransforms; ++j, ++joint) {
+				for (int x = 0; x < 3; ++x) {
+					arrays.translation[x][joint] = pose.transforms[j].translation[x];
+					arrays.rotation[x][joint] = pose.transforms[j].rotation[x];
+				}
+			}
+			memcpy(arrays.blendShapeActivations + blendShape, pose.blendShapeActivations, pose.numBlendShapes * sizeof(float));
+			blendShape += pose.numBlendShapes;
+		}
+		arrays.firstJoint[numActors] = joint;
+		arrays.firstBlendShape[numActors] = blendShape;
+
+		// zero the padding so that vector loops can run over it
+		const size_t jointPadding = padded(numJoints) - numJoints;
+		for (int x = 0; x < 3; ++x) {
+			memset(arrays.translation[x] + numJoints, 0, jointPadding * sizeof(float));
+			memset(arrays.rotation[x] + numJoints, 0, jointPadding * sizeof(float));
+		}
+		memset(arrays.blendShapeActivations + numBlendShapes, 0, (padded(numBlendShapes) - numBlendShapes) * sizeof(float));
+	}
+
+	static size_t size(const std::vector<PoseBuffer*>& poses)
+	{
+		int numJoints = 0;
+		int numBlendShapes = 0;
+		for (const PoseBuffer* buffer : poses) {
+			numJoints += buffer->pose.numTransforms;
+			numBlendShapes += buffer->pose.numBlendShapes;
+		}
+		return 63 + (6 * padded(numJoints) + padded(numBlendShapes)) * sizeof(float) + (4 * poses.size() + 2) * sizeof(int32_t);
+	}
+};
+
+// most recent complete frame of all actors. reused buffers are double buffering in the common case where
+// readers release a frame before the next but one frame is published.
+template <class Buffer>
+struct FrameMailbox {
+	std::vector<Buffer*>	pool;
+	std::atomic<Buffer*>	latest {nullptr};
+	uint64_t		version = 0;
+
+	~FrameMailbox()
+	{
+		publish(nullptr);
+		for (Buffer* b : pool)
+			b->release();
+	}
+
+	Buffer* claim(size_t size)
+	{
+		for (Buffer* buffer : pool) {
+			// buffers that are too small for the current number of actors stay in the pool until the mailbox
+			// is destroyed. a reader may have loaded one from latest and be just about to retain it.
+			if (buffer->capacity < size)
+				continue;
+			int onlyPool = 1;
+			if (buffer->references.compare_exchange_strong(onlyPool, 2))
+				return buffer;
+		}
+
+		// twice the size so that actors joining one by one leave only a few outgrown buffers behind
+		Buffer* buffer = Buffer::create(2 * size);
+		buffer->retain();
+		pool.push_back(buffer);
+		return buffer;
+	}
+
+	// takes over the reference from claim()
+	void publish(Buffer* buffer)
+	{
+		Buffer* previous = latest.exchange(buffer);
+		if (previous != nullptr)
+			previous->release();
+	}
+
+	Buffer* acquire() const
+	{
+		return acquirePublished(latest);
+	}
+};
+
+// how the values of a pose are laid out in the packets
+struct PoseLayout {
+	int			numBytes; // of the complete pose
+	int			numTransforms;
+	int			numTransformValues;
+	int			numBlendShapes;
+	bool			onlyRootTranslation;
+	bool			compressed;
+};
+
+// puts poses back together that were split into a capturyPose2 packet and capturyPoseCont packets.
+// continuation packets carry no offset so the parts of a pose are appended in the order they arrive.
+// any number of poses can be in flight at the same time and their packets can be interleaved.
+// parts that arrive before the first packet of their pose are kept until the first packet arrives.
+struct PoseReassembly {
+	struct Pose {
+		uint64_t		timestamp = 0; // 0 if unused
+		uint64_t		firstSeen; // local time the first part arrived
+		bool			haveFirstPacket;
+		PoseLayout		layout; // valid once the first packet arrived
+		int			numParts;
+		std::vector<uint8_t>	data; // keeps its memory when the pose is reused
+	};
+	std::vector<Pose>	poses;
+
+	Pose* find(uint64_t timestamp)
+	{
+		for (Pose& p : poses)
+			if (p.timestamp == timestamp)
+				return &p;
+		return nullptr;
+	}
+
+	int numInFlight() const
+	{
+		int n = 0;
+		for (const Pose& p : poses)
+			n += (p.timestamp != 0);
+		return n;
+	}
+
+	Pose& add(uint64_t timestamp, uint64_t now)
+	{
+		Pose* pose = find(0);
+		if (pose == nullptr) {
+			poses.emplace_back();
+			pose = &poses.back();
+		}
+		pose->timestamp = timestamp;
+		pose->firstSeen = now;
+		pose->haveFirstPacket = false;
+		pose->numParts = 0;
+		pose->data.clear();
+		return *pose;
+	}
+
+	void remove(Pose& pose)
+	{
+		pose.timestamp = 0;
+	}
+
+	// removes poses that are not newer than timestamp or older than firstSeenBefore.
+	// returns the number of poses removed and adds the number of their parts to numParts.
+	int expire(uint64_t timestamp, uint64_t firstSeenBefore, uint64_t& numParts)
+	{
+		int numPoses = 0;
+		for (Pose& p : poses) {
+			if (p.timestamp == 0 || (p.timestamp > timestamp && p.firstSeen >= firstSeenBefore))
+				continue;
+			numParts += p.numParts;
+			++numPoses;
+			remove(p);
+		}
+		return numPoses;
+	}
+
+	// removes the pose that has been in flight the longest
+	int expireOldest(uint64_t& numParts)
+	{
+		Pose* oldest = nullptr;
+		for (Pose& p : poses)
+			if (p.timestamp != 0 && (oldest == nullptr || p.firstSeen < oldest->firstSeen))
+				oldest = &p;
+		if (oldest == nullptr)
+			return 0;
+		numParts += oldest->numParts;
+		remove(*oldest);
+		return 1;
+	}
+};
+
 struct ActorData {
 	// actor id -> scaling progress (0 to 100)
 	int			scalingProgress;
 	// actor id -> tracking quality (0 to 100)
 	int			trackingQuality;
 	// actor id -> pose
-	CapturyPose		currentPose;
-	struct InProgress {
-		float*			pose;
-		uint64_t		timestamp;
-		int			bytesDone;
-		bool			onlyRootTranslation;
-	};
-	InProgress		inProgress[4];
+	std::shared_ptr<PoseMailbox> poseMailbox;
+	uint64_t		currentPoseTimestamp; // remote timestamp of the most recent pose
+	PoseReassembly		reassembly;
 	// actor id -> timestamp
 	uint64_t		lastPoseTimestamp;
 
@@ -152,20 +628,250 @@ struct ActorData {
 
 	int			flags;
 
-	ActorData() : scalingProgress(0), trackingQuality(100), lastPoseTimestamp(0), status(ACTOR_STOPPED), flags(0)
+	// statistics
+	uint64_t		numPoses = 0;
+	uint64_t		numDroppedPoses = 0;
+	uint64_t		numReassemblyFailures = 0;
+
+	bool			livenessScheduled = false; // the actor is in the liveness wheel
+
+	ActorData() : scalingProgress(0), trackingQuality(100), currentPoseTimestamp(0), lastPoseTimestamp(0), status(ACTOR_STOPPED), flags(0)
 	{
-		currentPose.timestamp = 0;
-		currentPose.numTransforms = 0;
-		currentPose.numBlendShapes = 0;
-		currentPose.flags = 0;
 		currentTextures.width = 0;
 		currentTextures.height = 0;
 		currentTextures.data = NULL;
-		for (int i = 0; i < 4; ++i) {
-			inProgress[i].pose = NULL;
-			inProgress[i].timestamp = 0;
+	}
+};
+
+// everything known about one actor
+struct ActorSlot {
+	int			id;
+	CapturyActor_p		actor; // null until the actor definition has been received
+	ActorData		data;
+	std::vector<CapturyAngleData> currentAngles;
+};
+
+//
+// all actors in one dense array. ids are mapped to slots with an open addressing table
+// so that looking up an actor by id is a hash and usually a single probe.
+// actors are only ever removed all at once so slots never have to be reused.
+//
+class ActorTable {
+public:
+	ActorSlot* find(int id)
+	{
+		if (index.empty())
+			return nullptr;
+		for (size_t i = hash(id); ; i = (i + 1) & (index.size() - 1)) {
+			const IndexEntry& entry = index[i];
+			if (entry.slot == -1)
+				return nullptr;
+			if (entry.id == id)
+				return &slots[entry.slot];
+		}
+	}
+
+	// returns the slot for id, adding an empty one if necessary
+	// slots may move when a new slot is added so do not hold on to pointers across calls
+	ActorSlot& findOrAdd(int id)
+	{
+		ActorSlot* slot = find(id);
+		if (slot != nullptr)
+			return *slot;
+
+		// keep the load factor at or below 1/2
+		if ((slots.size() + 1) * 2 > index.size())
+			rehash(std::max<size_t>(16, index.size() * 2));
+
+		slots.emplace_back();
+		slots.back().id = id;
+		insert(id, (int)slots.size() - 1);
+		return slots.back();
+	}
+
+	void clear()
+	{
+		slots.clear();
+		std::fill(index.begin(), index.end(), IndexEntry());
+	}
+
+	size_t size() const				{ return slots.size(); }
+	std::vector<ActorSlot>::iterator begin()	{ return slots.begin(); }
+	std::vector<ActorSlot>::iterator end()		{ return slots.end(); }
+
+private:
+	struct IndexEntry {
+		int	id = 0;
+		int	slot = -1; // -1 if empty
+	};
+
+	size_t hash(int id) const
+	{
+		// Fibonacci hashing spreads sequential ids over the whole table
+		return (size_t)(((uint32_t)id * 2654435769u) >> shift);
+	}
+
+	void insert(int id, int slot)
+	{
+		size_t i = hash(id);
+		while (index[i].slot != -1)
+			i = (i + 1) & (index.size() - 1);
+		index[i].id = id;
+		index[i].slot = slot;
+	}
+
+	void rehash(size_t size)
+	{
+		index.assign(size, IndexEntry());
+		shift = 32;
+		for (size_t s = size; s > 1; s >>= 1)
+			--shift;
+		for (size_t i = 0; i < slots.size(); ++i)
+			insert(slots[i].id, (int)i);
+	}
+
+	std::vector<ActorSlot>	slots;
+	std::vector<IndexEntry>	index; // size is a power of two
+	int			shift = 32;
+};
+
+//
+// decides when to check whether actors are still receiving poses. every actor that receives poses is
+// scheduled once, a pose only updates its timestamp. when the check is due the actor is either stopped
+// or scheduled again for when its most recent pose is timeout old. checking an actor early is harmless
+// so ticks that were missed are simply processed late.
+//
+class LivenessWheel {
+public:
+	static constexpr int numBuckets = 32;
+	static constexpr int ticksPerTimeout = 16;
+
+	LivenessWheel() : buckets(numBuckets) {}
+
+	uint64_t timeout() const	{ return timeoutUs; }
+
+	// forgets everything that was scheduled
+	void setTimeout(uint64_t timeout)
+	{
+		timeoutUs = timeout;
+		tickLength = std::max<uint64_t>(timeout / ticksPerTimeout, 1);
+		clear();
+	}
+
+	void schedule(int actorId, uint64_t deadline)
+	{
+		uint64_t tick = std::max((deadline + tickLength - 1) / tickLength, currentTick);
+		buckets[tick % numBuckets].push_back(actorId);
+	}
+
+	bool isDue(uint64_t now) const	{ return now >= nextTickTime; }
+
+	// returns the actors of all ticks up to now in due
+	void advance(uint64_t now, std::vector<int>& due)
+	{
+		due.clear();
+		const uint64_t lastTick = now / tickLength;
+		for (int i = 0; i < numBuckets && currentTick <= lastTick; ++i, ++currentTick) {
+			std::vector<int>& bucket = buckets[currentTick % numBuckets];
+			due.insert(due.end(), bucket.begin(), bucket.end());
+			bucket.clear();
 		}
+		currentTick = std::max(currentTick, lastTick + 1);
+		nextTickTime = currentTick * tickLength;
 	}
+
+	void clear()
+	{
+		for (std::vector<int>& bucket : buckets)
+			bucket.clear();
+		currentTick = 0;
+		nextTickTime = 0;
+	}
+
+private:
+	uint64_t			timeoutUs = 500000;
+	uint64_t			tickLength = 500000 / ticksPerTimeout;
+	uint64_t			currentTick = 0; // next tick to process
+	uint64_t			nextTickTime = 0;
+	std::vector<std::vector<int>>	buckets; // actors to check in tick t are in bucket t % numBuckets
+};
+
+//
+// versioned feed of actors appearing, changing and disappearing so that consumers only have to look at
+// what changed since they last asked. the most recent changes are kept in a ring, a consumer that falls
+// further behind has to start over from the full list of actors.
+// actors are present while they are scaling or tracking.
+//
+class ActorChangeFeed {
+public:
+	static constexpr int capacity = 4096;
+
+	ActorChangeFeed() : changes(capacity) {}
+
+	// the actor's status changed
+	void recordStatus(int actorId, int status)
+	{
+		const bool active = (status == ACTOR_SCALING || status == ACTOR_TRACKING);
+		std::lock_guard<std::mutex> changeLock(changeMutex);
+		if (active && present.insert(actorId).second)
+			append(actorId, CAPTURY_ACTOR_ADDED, status);
+		else if (!active && present.erase(actorId) != 0)
+			append(actorId, CAPTURY_ACTOR_REMOVED, status);
+	}
+
+	// the actor's definition changed. only reported for actors that are present.
+	void recordDefinition(int actorId, int status)
+	{
+		std::lock_guard<std::mutex> changeLock(changeMutex);
+		if (present.count(actorId) != 0)
+			append(actorId, CAPTURY_ACTOR_CHANGED, status);
+	}
+
+	// all actors are gone
+	void recordAllDeleted()
+	{
+		std::lock_guard<std::mutex> changeLock(changeMutex);
+		for (int actorId : present)
+			append(actorId, CAPTURY_ACTOR_REMOVED, ACTOR_DELETED);
+		present.clear();
+	}
+
+	uint64_t currentSequence() const	{ return sequence.load(std::memory_order_acquire); }
+
+	// returns the number of changes after since or -1 if some of them have already been dropped
+	int get(uint64_t since, CapturyActorChange* out, int maxChanges)
+	{
+		if (since >= currentSequence()) // nothing new. does not need the lock.
+			return 0;
+
+		std::lock_guard<std::mutex> changeLock(changeMutex);
+		const uint64_t last = sequence.load(std::memory_order_relaxed);
+		if (last - since > (uint64_t)capacity)
+			return -1;
+
+		int num = (int)std::min<uint64_t>(last - since, (uint64_t)std::max(maxChanges, 0));
+		for (int i = 0; i < num; ++i)
+			out[i] = changes[(since + i) % capacity];
+		return num;
+	}
+
+private:
+	// changeMutex must be locked
+	void append(int actorId, int type, int status)
+	{
+		const uint64_t seq = sequence.load(std::memory_order_relaxed) + 1;
+		CapturyActorChange& change = changes[(seq - 1) % capacity];
+		change.sequence = seq;
+		change.actorId = actorId;
+		change.type = type;
+		change.status = status;
+		sequence.store(seq, std::memory_order_release);
+	}
+
+	std::mutex			changeMutex;
+	std::atomic<uint64_t>		sequence {0}; // of the most recent change
+	std::vector<CapturyActorChange>	changes; // change with sequence s is at (s-1) % capacity
+	std::unordered_set<int>		present;
 };
 
 const char* CapturyActorStatusString[] = {"scaling", "tracking", "stopped", "deleted", "unknown"};
@@ -198,7 +904,67 @@ struct Sync {
 
 	Sync(double o, double f) : offset(o), factor(f) {}
 
-	uint64_t getRemoteTime(uint64_t localT)	{ return uint64_t((localT) * factor + offset); }
+	uint64_t getRemoteTime(uint64_t localT) const	{ return uint64_t((localT) * factor + offset); }
+};
+
+//
+// the mapping from local to remote time including the transition from the previous to the current sync.
+// published by updateSync() and read without a lock by every thread that needs the remote time.
+// this is a seqlock: readers retry if a new mapping was published while they were reading it.
+//
+class ClockMapping {
+public:
+	// only called with syncMutex locked so there is never more than one writer
+	void publish(const Sync& oldSync, const Sync& currentSync, uint64_t transitionStartLocalT, uint64_t transitionEndLocalT)
+	{
+		const uint32_t seq = sequence.load(std::memory_order_relaxed);
+		sequence.store(seq + 1, std::memory_order_relaxed); // odd while writing
+		std::atomic_thread_fence(std::memory_order_release);
+		oldOffset.store(oldSync.offset, std::memory_order_relaxed);
+		oldFactor.store(oldSync.factor, std::memory_order_relaxed);
+		offset.store(currentSync.offset, std::memory_order_relaxed);
+		factor.store(currentSync.factor, std::memory_order_relaxed);
+		transitionStart.store(transitionStartLocalT, std::memory_order_relaxed);
+		transitionEnd.store(transitionEndLocalT, std::memory_order_relaxed);
+		sequence.store(seq + 2, std::memory_order_release);
+	}
+
+	uint64_t getRemoteTime(uint64_t localT) const
+	{
+		Sync oldSync(0.0, 1.0);
+		Sync currentSync(0.0, 1.0);
+		uint64_t start, end;
+		uint32_t seq;
+		do {
+			seq = sequence.load(std::memory_order_acquire);
+			oldSync.offset = oldOffset.load(std::memory_order_relaxed);
+			oldSync.factor = oldFactor.load(std::memory_order_relaxed);
+			currentSync.offset = offset.load(std::memory_order_relaxed);
+			currentSync.factor = factor.load(std::memory_order_relaxed);
+			start = transitionStart.load(std::memory_order_relaxed);
+			end = transitionEnd.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+		} while ((seq & 1) != 0 || sequence.load(std::memory_order_relaxed) != seq);
+
+		if (localT >= end)
+			return currentSync.getRemoteTime(localT);
+
+		// blend from the old to the new estimate so that the remote time does not jump
+		uint64_t oldEstimate = oldSync.getRemoteTime(localT);
+		uint64_t newEstimate = currentSync.getRemoteTime(localT);
+		double at = double(localT - start) / (end - start);
+		// log("sync: local %" PRIu64 " old %" PRIu64 " new %" PRIu64 " -> %" PRIu64 "\n", localT, oldEstimate, newEstimate, (uint64_t)(oldEstimate * (1.0 - at) + newEstimate * at));
+		return (uint64_t)(oldEstimate * (1.0 - at) + newEstimate * at);
+	}
+
+private:
+	std::atomic<uint32_t>	sequence {0};
+	std::atomic<double>	oldOffset {0.0};
+	std::atomic<double>	oldFactor {1.0};
+	std::atomic<double>	offset {0.0};
+	std::atomic<double>	factor {1.0};
+	std::atomic<uint64_t>	transitionStart {0};
+	std::atomic<uint64_t>	transitionEnd {0};
 };
 
 struct SyncSample {
@@ -206,9 +972,406 @@ struct SyncSample {
 	int64_t		remoteT;
 	uint32_t	pingPongT;
 
+	SyncSample() : localT(0), remoteT(0), pingPongT(0) {}
 	SyncSample(uint64_t l, uint64_t r, uint32_t pp) : localT(l), remoteT(r), pingPongT(pp) {}
 };
 
+//
+// estimates offset and drift of the remote clock from the replies to time requests.
+//
+// the remote timestamp of a reply is assumed to be taken half way through the round trip. if the
+// request or the reply was held up on the way that assumption is off by up to half the round trip.
+// so samples whose round trip is much longer than the shortest one in the window are not used at all
+// and the remaining ones are weighted by how close they are to the shortest round trip. a weighted
+// line through (local time, remote - local time) then gives the offset and the drift.
+//
+class ClockSync {
+public:
+	static constexpr int maxSamples = 64;		// one per second when the synchronization loop is running
+	static constexpr int minSamplesForDrift = 4;
+	static constexpr int64_t minDriftBaseline = 5000000; // 5 seconds
+	static constexpr double maxDrift = 0.0005;	// 500ppm. no real clock drifts faster than this.
+
+	// returns false if the round trip was too long to use the sample
+	bool addSample(const SyncSample& sample)
+	{
+		samples[(first + numSamples) % maxSamples] = sample;
+		if (numSamples < maxSamples)
+			++numSamples;
+		else
+			first = (first + 1) % maxSamples;
+
+		minRoundTrip = UINT32_MAX;
+		for (int i = 0; i < numSamples; ++i)
+			minRoundTrip = std::min(minRoundTrip, at(i).pingPongT);
+
+		if (isUsable(sample))
+			return true;
+		++numRejected;
+		return false;
+	}
+
+	// returns false if there is no usable sample yet
+	bool estimate(Sync& s)
+	{
+		// weighted means relative to the newest sample to keep the numbers small
+		const int64_t refLocalT = at(numSamples - 1).localT;
+		double sumW = 0.0, sumX = 0.0, sumY = 0.0;
+		numUsed = 0;
+		for (int i = 0; i < numSamples; ++i) {
+			const SyncSample& ss = at(i);
+			if (!isUsable(ss))
+				continue;
+			const double w = weight(ss);
+			sumW += w;
+			sumX += w * (double)(ss.localT - refLocalT);
+			sumY += w * (double)(ss.remoteT - ss.localT);
+			++numUsed;
+		}
+		if (numUsed == 0)
+			return false;
+
+		const double meanX = sumX / sumW;
+		const double meanY = sumY / sumW;
+		double sumXX = 0.0, sumXY = 0.0;
+		int64_t firstLocalT = refLocalT;
+		for (int i = 0; i < numSamples; ++i) {
+			const SyncSample& ss = at(i);
+			if (!isUsable(ss))
+				continue;
+			const double w = weight(ss);
+			const double x = (double)(ss.localT - refLocalT) - meanX;
+			sumXX += w * x * x;
+			sumXY += w * x * ((double)(ss.remoteT - ss.localT) - meanY);
+			firstLocalT = std::min(firstLocalT, ss.localT);
+		}
+
+		// with only a few samples close together the slope is mostly noise
+		drift = 0.0;
+		if (numUsed >= minSamplesForDrift && refLocalT - firstLocalT >= minDriftBaseline && sumXX > 0.0)
+			drift = std::max(-maxDrift, std::min(maxDrift, sumXY / sumXX));
+
+		// remote = local + meanY + drift * (local - refLocalT - meanX)
+		s.factor = 1.0 + drift;
+		s.offset = meanY - drift * (meanX + (double)refLocalT);
+		offset = meanY - drift * meanX; // at the newest sample
+
+		// every remote timestamp was taken somewhere between ping and pong so each sample is off by no more
+		// than half its round trip. a residual larger than that means the remote clock is noisier than the
+		// round trip and then the residual is the better measure. the weighted means are off by no more than
+		// the weighted mean of these and the slope by no more than sum(w * |x| * e) / sum(w * x * x)
+		double sumWE = 0.0, sumWXE = 0.0;
+		for (int i = 0; i < numSamples; ++i) {
+			const SyncSample& ss = at(i);
+			if (!isUsable(ss))
+				continue;
+			const double x = (double)(ss.localT - refLocalT) - meanX;
+			const double r = (double)(ss.remoteT - ss.localT) - meanY - drift * x;
+			const double e = std::max(ss.pingPongT * 0.5, std::abs(r));
+			sumWE += weight(ss) * e;
+			sumWXE += weight(ss) * std::abs(x) * e;
+		}
+		meanLocalT = refLocalT + (int64_t)meanX;
+		offsetError = sumWE / sumW;
+		// until the drift is known it can be anything up to maxDrift
+		driftError = (drift == 0.0) ? maxDrift : std::min(sumWXE / sumXX, maxDrift);
+		return true;
+	}
+
+	// the error bound grows with the distance from the samples
+	void getStats(CapturyTimeSyncStats* stats, int64_t localT) const
+	{
+		const double bound = (numUsed == 0) ? 0.0 : offsetError + driftError * std::abs((double)(localT - meanLocalT));
+		stats->offset = (int64_t)offset;
+		stats->drift = drift * 1e6;
+		stats->errorBound = (uint32_t)std::min(std::ceil(bound), (double)UINT32_MAX);
+		stats->minRoundTrip = (numSamples == 0) ? 0 : minRoundTrip;
+		stats->numSamples = numUsed;
+		stats->numRejectedSamples = numRejected;
+	}
+
+private:
+	const SyncSample& at(int i) const	{ return samples[(first + i) % maxSamples]; }
+
+	bool isUsable(const SyncSample& ss) const
+	{
+		// 200us of slack so that the scheduling noise of a quiet local network does not reject everything
+		return ss.pingPongT <= 2 * (uint64_t)minRoundTrip + 200;
+	}
+
+	double weight(const SyncSample& ss) const
+	{
+		const double excess = (ss.pingPongT - minRoundTrip) / (0.5 * minRoundTrip + 50.0);
+		return 1.0 / (1.0 + excess * excess);
+	}
+
+	SyncSample	samples[maxSamples];
+	int		first = 0;
+	int		numSamples = 0;
+	uint32_t	minRoundTrip = UINT32_MAX;
+
+	// result of the last estimate()
+	double		offset = 0.0;
+	double		drift = 0.0;
+	int64_t		meanLocalT = 0;	// where the estimate is most accurate
+	double		offsetError = 0.0;
+	double		driftError = maxDrift;
+	int32_t		numUsed = 0;
+	int32_t		numRejected = 0;
+};
+
+static inline uint64_t getMonotonicNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// when the packet that is currently being handled was received. set by whichever thread reads the socket.
+static thread_local uint64_t packetReceivedNs = 0;
+static thread_local uint64_t packetReceivedTime = 0; // local time in microseconds, read once per batch of packets
+
+//
+// log-linear histogram of durations in ns in the spirit of HdrHistogram:
+// values below 8 have their own bucket, above that every power of two is split into 8 buckets
+// so that every value is known to within 12.5%. recording is wait-free and can happen on any thread.
+//
+struct StageHistogram {
+	static constexpr int subBucketBits = 3;
+	static constexpr int subBuckets = 1 << subBucketBits;
+	static constexpr int maxExponent = 40; // ~18 minutes
+	static constexpr int numBuckets = subBuckets + (maxExponent - subBucketBits + 1) * subBuckets;
+
+	std::atomic<uint64_t> buckets[numBuckets];
+	std::atomic<uint64_t> count {0};
+	std::atomic<uint64_t> sum {0};
+	std::atomic<uint64_t> max {0};
+
+	StageHistogram()	{ reset(); }
+
+	static int bucketIndex(uint64_t ns)
+	{
+		if (ns < subBuckets)
+			return (int)ns;
+		int exponent = 63;
+		while ((ns >> exponent) == 0)
+			--exponent;
+		if (exponent > maxExponent)
+			return numBuckets - 1;
+		const int subBucket = (int)(ns >> (exponent - subBucketBits)) & (subBuckets - 1);
+		return subBuckets + (exponent - subBucketBits) * subBuckets + subBucket;
+	}
+
+	// the largest value that falls into bucket index
+	static uint64_t bucketValue(int index)
+	{
+		if (index < subBuckets)
+			return (uint64_t)index;
+		const int exponent = (index - subBuckets) / subBuckets + subBucketBits;
+		const uint64_t subBucket = (uint64_t)((index - subBuckets) % subBuckets);
+		return ((subBuckets + subBucket + 1) << (exponent - subBucketBits)) - 1;
+	}
+
+	void record(uint64_t ns)
+	{
+		buckets[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+		count.fetch_add(1, std::memory_order_relaxed);
+		sum.fetch_add(ns, std::memory_order_relaxed);
+		uint64_t m = max.load(std::memory_order_relaxed);
+		while (ns > m && !max.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+			;
+	}
+
+	void reset()
+	{
+		for (int i = 0; i < numBuckets; ++i)
+			buckets[i].store(0, std::memory_order_relaxed);
+		count = 0;
+		sum = 0;
+		max = 0;
+	}
+
+	// concurrent recording may make the snapshot slightly inconsistent which is fine for statistics
+	void get(CapturyStageStats* stats) const
+	{
+		uint64_t snapshot[numBuckets];
+		uint64_t total = 0;
+		for (int i = 0; i < numBuckets; ++i) {
+			snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+			total += snapshot[i];
+		}
+
+		stats->count = total;
+		stats->meanNs = (total != 0) ? sum.load(std::memory_order_relaxed) / total : 0;
+		stats->maxNs = max.load(std::memory_order_relaxed);
+
+		const double fractions[3] = {0.5, 0.99, 0.999};
+		uint64_t* results[3] = {&stats->p50Ns, &stats->p99Ns, &stats->p999Ns};
+		uint64_t seen = 0;
+		int i = 0;
+		for (int f = 0; f < 3; ++f) {
+			const uint64_t target = (uint64_t)ceil(fractions[f] * total);
+			while (i < numBuckets - 1 && seen + snapshot[i] < target)
+				seen += snapshot[i++];
+			*results[f] = (total != 0) ? std::min(bucketValue(i), stats->maxNs) : 0;
+		}
+	}
+};
+
+// splits the byte stream of the TCP socket into packets.
+// every recv reads as much as fits into the buffer and all complete packets are handled in place.
+// the buffer only grows if a single packet does not fit.
+struct TcpReader {
+	static constexpr int initialSize = 65536;
+	std::vector<char>	buffer = std::vector<char>(initialSize);
+	int			begin = 0; // first byte that has not been handled yet
+	int			end = 0; // one past the last byte received
+
+	void reset()
+	{
+		begin = 0;
+		end = 0;
+	}
+
+	// makes sure that there is room for at least numBytes starting at begin and returns the free space after end
+	int makeRoom(int numBytes)
+	{
+		if (begin == end)
+			reset();
+		else if (begin != 0 && (int)buffer.size() - begin < std::max(numBytes, (int)buffer.size() / 2)) {
+			memmove(buffer.data(), buffer.data() + begin, end - begin);
+			end -= begin;
+			begin = 0;
+		}
+		if ((int)buffer.size() - begin < numBytes)
+			buffer.resize(begin + numBytes);
+		return (int)buffer.size() - end;
+	}
+};
+
+// datagrams are drained in batches into a preallocated ring of packet slots
+// so that there is neither a syscall nor an allocation per datagram
+struct StreamReceiver {
+	static constexpr int batchSize = 32;
+	static constexpr int ringSlots = 64;
+	static constexpr int slotSize = 10000;
+
+	std::vector<char>	ring = std::vector<char>(ringSlots * slotSize);
+	int			ringHead = 0;
+	int			sizes[batchSize];
+#ifdef CAPTURY_HAVE_RECVMMSG
+	mmsghdr			msgs[batchSize];
+	iovec			iovecs[batchSize];
+#endif
+
+	StreamReceiver()
+	{
+#ifdef CAPTURY_HAVE_RECVMMSG
+		memset(msgs, 0, sizeof(msgs));
+		for (int i = 0; i < batchSize; ++i) {
+			iovecs[i].iov_len = slotSize;
+			msgs[i].msg_hdr.msg_iov = &iovecs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+#endif
+	}
+	StreamReceiver(const StreamReceiver&) = delete;
+
+	// returns the number of datagrams received or -1 on error.
+	// blocks until the first datagram arrives unless the socket is non-blocking, then takes whatever else is queued.
+	int receive(SOCKET streamSock)
+	{
+#ifdef CAPTURY_HAVE_RECVMMSG
+		for (int i = 0; i < batchSize; ++i)
+			iovecs[i].iov_base = slot(i);
+
+		int numReceived = recvmmsg(streamSock, msgs, batchSize, MSG_WAITFORONE, nullptr);
+		for (int i = 0; i < numReceived; ++i)
+			sizes[i] = (int)msgs[i].msg_len;
+		return numReceived;
+#else
+		sizes[0] = recv(streamSock, slot(0), slotSize, 0);
+		return (sizes[0] == -1) ? -1 : 1;
+#endif
+	}
+
+	// i-th datagram of the current batch
+	char* slot(int i)
+	{
+		return &ring[((ringHead + i) % ringSlots) * slotSize];
+	}
+};
+
+// event loop that multiplexes the sockets and timers of any number of RemoteCaptury instances
+// on one thread (see Captury_useSharedReactor()). sockets and timers are only added and removed
+// on the loop thread, other threads get there through run().
+struct IoLoop {
+	typedef std::function<void()> Handler;
+
+	IoLoop();
+	~IoLoop();
+
+	// runs task on the loop thread and waits until it is done
+	void run(const Handler& task);
+
+	// handler is called when sock becomes readable, or writable if wantWrite is set.
+	// readiness is edge-triggered where supported so the handler has to read until the socket would block.
+	void addSocket(SOCKET sock, bool wantWrite, const Handler& handler);
+	void setWantWrite(SOCKET sock, bool wantWrite);
+	void removeSocket(SOCKET sock);
+
+	// calls handler every interval microseconds. returns an id for removeTimer().
+	int addTimer(uint64_t interval, const Handler& handler);
+	void removeTimer(int id);
+
+private:
+	struct Watch {
+		SOCKET		sock;
+		bool		wantWrite;
+		Handler		handler;
+	};
+	struct Timer {
+		int		id;
+		uint64_t	due; // in microseconds
+		uint64_t	interval;
+		Handler		handler;
+	};
+
+	void loop();
+	void wake();
+	void runTasks();
+	void dispatch(SOCKET sock);
+	int runTimers(); // returns the number of milliseconds until the next timer is due or -1
+
+	std::thread		thread;
+	std::atomic<bool>	stopping {false};
+	SOCKET			wakeSock = (SOCKET)-1; // loopback datagram socket connected to itself
+#ifdef CAPTURY_HAVE_EPOLL
+	int			epollFd = -1;
+#endif
+	std::mutex		taskMutex;
+	std::vector<Handler>	tasks;
+
+	// only touched by the loop thread
+	std::vector<Watch>	watches;
+	std::vector<Timer>	timers;
+	int			nextTimerId = 1;
+};
+
+// the event loops shared by all RemoteCaptury instances that use a reactor.
+// it lives as long as one of them holds on to it.
+struct IoReactor {
+	std::vector<std::unique_ptr<IoLoop>> loops;
+	std::atomic<uint32_t> nextLoop {0};
+
+	// instances are distributed over the loops round robin
+	IoLoop* assignLoop()
+	{
+		return loops[nextLoop++ % loops.size()].get();
+	}
+
+	// numThreads is only used if the reactor does not exist yet
+	static std::shared_ptr<IoReactor> acquire(int numThreads);
+};
+
 struct RemoteCaptury {
 	std::thread streamThread;
 	std::thread receiveThread;
@@ -219,6 +1382,7 @@ struct RemoteCaptury {
 	std::mutex logMutex;
 
 	bool syncLoopIsRunning = false;
+	std::atomic<bool> stopSyncThread {false};
 
 	int streamWhat = CAPTURY_STREAM_NOTHING;
 	int32_t streamCamera;
@@ -228,15 +1392,13 @@ struct RemoteCaptury {
 	std::string currentSession;
 	std::string currentShot;
 
-	// actor id -> pointer to actor
-	std::unordered_map<int, CapturyActor_p> actorsById GUARDED_BY(mainMutex);
+	// actor id -> actor and all data received for it
+	ActorTable actors GUARDED_BY(mainMutex);
 	std::unordered_map<const CapturyActor*, CapturyActor_p> returnedActors GUARDED_BY(mainMutex);
 	std::unordered_map<int, CapturyActor_p> partialActors GUARDED_BY(partialActorMutex); // actors that have been received in part
 	std::vector<CapturyActor> actorPointers GUARDED_BY(mainMutex); // used by Captury_getActors()
 	std::vector<CapturyActor_p> actorSharedPointers GUARDED_BY(mainMutex); // used by Captury_getActors()
 
-	std::unordered_map<int, std::vector<CapturyAngleData>> currentAngles;
-
 	int numCameras = -1;
 	std::vector<CapturyCamera> cameras;
 
@@ -248,10 +1410,60 @@ struct RemoteCaptury {
 	uint64_t mostRecentPoseReceivedTime; // time pose was received
 	uint64_t mostRecentPoseReceivedTimestamp; // timestamp of that pose
 
-	int framerateNumerator = -1;
-	int framerateDenominator = -1;
+	// the stream socket is drained in batches of up to StreamReceiver::batchSize datagrams
+	std::atomic<uint64_t> numStreamWakeups {0}; // number of times recv returned data
+	std::atomic<uint64_t> numStreamDatagrams {0}; // number of datagrams received in total
+	std::atomic<int> lastStreamBatchSize {0};
+	std::atomic<int> maxStreamBatchSize {0};
+
+	// client side pipeline statistics (see Captury_getStats())
+	StageHistogram receiveToParse;
+	StageHistogram parseToCallback;
+	StageHistogram callbackToConsumed;
+	std::atomic<uint64_t> numPosesReceived {0};
+	std::atomic<uint64_t> numDroppedPoses {0};
+	std::atomic<uint64_t> numReassemblyFailures {0};
+	std::atomic<uint64_t> numReassembledPoses {0};
+	std::atomic<uint64_t> numExpiredFragments {0};
+	std::atomic<uint64_t> numDuplicateFragments {0};
+
+	// limits for putting poses back together that were split over several packets (see Captury_setReassemblyLimits())
+	std::atomic<int> maxPosesInFlight {8};
+	std::atomic<uint64_t> reassemblyTimeout {100000}; // in microseconds
+
+	// poses of the frame that is currently arriving (see Captury_getFrameSnapshot() and Captury_getFrameArrays())
+	std::atomic<bool> assembleFrames {false};
+	std::atomic<bool> assembleFrameArrays {false};
+	uint64_t pendingFrameTimestamp GUARDED_BY(mainMutex) = 0;
+	int pendingFrameExpectedPoses GUARDED_BY(mainMutex) = 0;
+	bool pendingFramePublished GUARDED_BY(mainMutex) = false;
+	std::vector<PoseBuffer*> pendingFramePoses GUARDED_BY(mainMutex);
+	std::mutex frameMutex; // serializes publishing frames
+	FrameMailbox<FrameSnapshotBuffer> frameMailbox; // pool and version guarded by frameMutex
+	FrameMailbox<FrameArraysBuffer> frameArraysMailbox; // pool and version guarded by frameMutex
+
+	// packet capture (see capturePacket())
+	std::mutex captureMutex;
+	std::atomic<bool> capturing {false};
+	FILE* captureFile GUARDED_BY(captureMutex) = nullptr;
+	FILE* captureIndexFile GUARDED_BY(captureMutex) = nullptr;
+	uint64_t captureOffset GUARDED_BY(captureMutex) = 0;
+	std::atomic<bool> replaying {false};
+
+	// numerator in the upper and denominator in the lower 32 bits so that both are always read together.
+	// pushed by Captury Live during the handshake and whenever it changes.
+	std::atomic<uint64_t> framerate {unknownFramerate};
+	static constexpr uint64_t unknownFramerate = ~(uint64_t)0; // -1/-1
+	CapturyFramerateChangedCallback framerateChangedCallback = NULL;
+	void* framerateChangedArg = NULL;
+
+	void getFramerate(int* numerator, int* denominator) const
+	{
+		const uint64_t rate = framerate.load(std::memory_order_relaxed);
+		*numerator = (int32_t)(rate >> 32);
+		*denominator = (int32_t)(uint32_t)rate;
+	}
 
-	std::unordered_map<int, ActorData> actorData GUARDED_BY(mainMutex);
 
 	std::map<int32_t, CapturyImage> currentImages;
 	std::map<int32_t, std::vector<int>> currentImagesReceivedPackets;
@@ -275,6 +1487,9 @@ struct RemoteCaptury {
 	void* newAnglesArg = NULL;
 	CapturyActorChangedCallback actorChangedCallback = NULL;
 	void* actorChangedArg = NULL;
+	ActorChangeFeed actorChanges; // recorded while mainMutex is locked so that it agrees with the actors' status
+	LivenessWheel liveness GUARDED_BY(mainMutex); // actors are stopped when they do not receive poses for liveness.timeout()
+	std::vector<int> dueActorIds GUARDED_BY(mainMutex); // scratch space for checkActors()
 	CapturyARTagCallback arTagCallback = NULL;
 	void* arTagArg = NULL;
 	CapturyImageCallback imageCallback = NULL;
@@ -282,6 +1497,19 @@ struct RemoteCaptury {
 
 	std::atomic<bool> handshakeFinished {false};
 	SOCKET		sock = (SOCKET)-1;
+	TcpReader	tcpReader; // only used by the receive thread (or the reactor's loop thread)
+
+	// instead of the receive, stream and sync threads the sockets of this instance can be served by a shared
+	// event loop (see Captury_useSharedReactor()). everything below is only touched on that loop's thread.
+	std::shared_ptr<IoReactor> reactor;
+	IoLoop*		ioLoop = nullptr;
+	bool		tcpConnecting = false; // non-blocking connect in progress
+	int		reconnectTimer = 0;
+	SOCKET		streamSock = (SOCKET)-1;
+	std::unique_ptr<StreamReceiver> streamReceiver; // kept when streaming stops because a batch may still be dispatched
+	int		keepAliveTimer = 0;
+	int		livenessTimer = 0;
+	int		syncTimer = 0;
 
 	std::atomic<int> stopStreamThread {0}; // stop streaming thread
 	std::atomic<int> stopReceiving {0}; // stop receiving thread
@@ -291,8 +1519,8 @@ struct RemoteCaptury {
 	sockaddr_in	remoteAddress; // address of server
 	uint16_t	streamSocketPort = 0;
 
-	uint64_t	pingTime;
-	int32_t		nextTimeId = 213;
+	std::atomic<uint64_t>	pingTime {0};	// written by whoever requests the time, read when the reply arrives
+	std::atomic<int32_t>	nextTimeId {213};
 
 	int					backgroundQuality = -1;
 	CapturyBackgroundFinishedCallback	backgroundFinishedCallback = NULL;
@@ -304,13 +1532,13 @@ struct RemoteCaptury {
 	bool				doRemoteLogging = false;
 	std::list<std::string>		logs;
 
-	std::vector<SyncSample> syncSamples;
-
-
+	ClockSync clockSync GUARDED_BY(syncMutex);
+	bool isSynchronized GUARDED_BY(syncMutex) = false;
 	Sync oldSync GUARDED_BY(syncMutex) = Sync(0.0, 1.0);
 	Sync currentSync GUARDED_BY(syncMutex) = Sync(0.0, 1.0);
 	uint64_t transitionStartLocalT GUARDED_BY(syncMutex) = 0;
 	uint64_t transitionEndLocalT GUARDED_BY(syncMutex) = 0;
+	ClockMapping clockMapping; // copy of the above that can be read without syncMutex
 
 	bool sendPacket(CapturyRequestPacket* packet, CapturyPacketTypes expectedReplyType);
 
@@ -321,17 +1549,43 @@ struct RemoteCaptury {
 	void log(const char *format, ...) __attribute__((format(printf,2,3)));
 	#endif
 
-	void computeSync(Sync& s);
-	void updateSync(uint64_t localT);
+	void addSyncSample(const SyncSample& sample);
 	uint64_t getRemoteTime(uint64_t localT);
 
 	void receiveLoop();
+	void receivedTcpPacket(char* data, int size);
+	void capturePacket(int channel, const char* data, int size);
+	bool startPacketCapture(const char* filename);
+	void stopPacketCapture();
+	bool replay(const char* filename, double speed);
+	void replayLoop(std::shared_ptr<struct PacketCaptureFile> capture, double speed);
 	void streamLoop(CapturyStreamPacketTcp* packet);
-	void receivedPose(CapturyPose* pose, int actorId, ActorData* aData, uint64_t timestamp);
+	SOCKET openStreamSocket(CapturyStreamPacketTcp* packet);
+	void receivedStreamBatch(StreamReceiver& receiver, int numReceived);
+	void receivedStreamPacket(char* buffer, int size);
+	void collectFramePose(PoseBuffer* buffer, std::vector<PoseBuffer*>& completedFrame);
+	void publishFrame(std::vector<PoseBuffer*>& poses);
+	void clearPendingFrame();
+	void receivedPose(PoseBuffer* buffer, ActorSlot* slot, uint64_t timestamp, std::unique_lock<std::mutex>& mainLock);
+	void receivedPoseFragment(ActorSlot* slot, uint64_t timestamp, const void* data, int size, const PoseLayout* layout, std::unique_lock<std::mutex>& mainLock);
 	void receivedPosePacket(CapturyPosePacket* cpp);
 	SOCKET openTcpSocket();
-	bool receive(SOCKET& sok);
+	int receive(SOCKET& sok);
 	void deleteActors();
+	void actorModeChanged(int actorId, int mode);
+	void checkActors(uint64_t now, std::vector<int>& stoppedActorIds);
+	void checkActorsAndNotify();
+	void requestTime();
+
+	// shared reactor, called on the loop thread
+	void startConnectingOnLoop();
+	void scheduleReconnectOnLoop();
+	void tcpReadyOnLoop();
+	void closeTcpOnLoop();
+	void startStreamingOnLoop(CapturyStreamPacketTcp* packet);
+	void stopStreamingOnLoop();
+	void streamReadyOnLoop();
+	void leaveReactor();
 
 	bool connect(const char* ip, unsigned short port, unsigned short localPort, unsigned short localStreamPort, int async);
 	bool disconnect();
@@ -621,239 +1875,512 @@ static uint64_t getTime()
 }
 
 //
-// the approach this function takes may not be obvious.
-//
-// generally the goal is to estimate remote time r as a function of the local time l.
-// we assume that r = l * f + o
-// i.e. there is an offset between the clocks and a linear drift
-//
-// given some measurement samples the goal is to compute the two parameters f and o
-//
-// the naive approach of estimating the parameters directly with a linear system fails
-// because of numerical instability. that's why we first subtract mean/median and then
-// solve the following:
-// note that the median(r-l) is necessary because the remote time measurement is noisy
-// local time measurement is relatively smooth. so using the mean is sufficient.
+// the mapping from local to remote time must not jump or run backwards while poses are timestamped with it.
+// so a new estimate is not applied right away. the mapping is bent from where it is now towards the new
+// estimate over a transition that is long enough that the remote time never runs more than maxSlew faster
+// or slower than the local clock. only the first estimate and corrections so large that the remote clock
+// must have been set are applied immediately.
 //
-// b = r - l - median(r-l)
-// a = l - mean(l)
-// a * f = b
-// f = a \ b                                    <=>
-// f = dot(a, b) / dot(a, a)      <- least squares solution
-// (l - mean(l)) * f = b                        <=>
-// (l - mean(l)) * f = r - l - median(r-l)      <=>
-// (l - mean(l)) * f + l + median(r-l) = r      <=>
-// (l - mean(l)) * f + l + median(r-l) = r      <=>
-// l * (f + 1) + median(r-l) - mean(l) * f = r
-//     \_____/   \_______________________/
-//      factor             offset
-//
-// note that for extra efficiency all operations except for the division in the
-// least squares solution and the multiplication in the last line can be performed as
-// integer operations.
-//
-// if there are only a few samples we cannot estimate the slope f accurately. so we
-// just estimate an offset (the median of the time differences between remote and local)
-//
-void RemoteCaptury::computeSync(Sync& s)
+void RemoteCaptury::addSyncSample(const SyncSample& sample)
 {
-	double meanLocalT = 0;
-	double medianOffset = 0.0;
+	constexpr uint64_t minTransitionTime = 100000; // 0.1 second
+	constexpr double maxSlew = 0.0005; // 0.5ms per second
+	constexpr double maxSlewedCorrection = 100000.0; // 0.1 second
 
-	int64_t offsets[50];
+	std::lock_guard<std::mutex> syncLock(syncMutex);
+	if (!clockSync.addSample(sample))
+		log("sync: round trip %u us is too long, sample not used\n", sample.pingPongT);
+
+	Sync tempSync(0.0, 1.0);
+	if (!clockSync.estimate(tempSync))
+		return;
 
-	int num = (int)syncSamples.size();
-	for (int i = 0; i < num; ++i) {
-		SyncSample& ss = syncSamples[i];
-		offsets[i] = ss.remoteT - ss.localT; // alternatively use median here
-		meanLocalT += ss.localT;
+	const uint64_t localT = getTime();
+	const double mappedRemoteT = (double)clockMapping.getRemoteTime(localT);
+	const double delta = (double)tempSync.getRemoteTime(localT) - mappedRemoteT;
+	if (!isSynchronized || std::abs(delta) > maxSlewedCorrection) {
+		oldSync = tempSync;
+		transitionStartLocalT = transitionEndLocalT = localT;
+	} else {
+		// continue from where the mapping is now at the rate of the previous estimate
+		oldSync = Sync(mappedRemoteT - localT * currentSync.factor, currentSync.factor);
+		transitionStartLocalT = localT;
+		transitionEndLocalT = localT + std::max(minTransitionTime, (uint64_t)(std::abs(delta) / maxSlew));
 	}
+	currentSync = tempSync;
+	isSynchronized = true;
+	clockMapping.publish(oldSync, currentSync, transitionStartLocalT, transitionEndLocalT);
 
-	std::sort(&offsets[0], &offsets[num]);
-	medianOffset = (num % 2 == 0) ? (offsets[num/2] + offsets[num/2+1]) * 0.5 : offsets[num/2];
+	CapturyTimeSyncStats stats;
+	clockSync.getStats(&stats, localT);
+	log("sync: offset %" PRId64 " drift %.3fppm +-%u us from %d samples, correcting by %.0f us over %" PRIu64 " us\n",
+		stats.offset, stats.drift, stats.errorBound, stats.numSamples, delta, transitionEndLocalT - transitionStartLocalT);
+}
 
-	if (num < 10 || (syncSamples.back().localT - syncSamples.front().localT) < 1000000) { // not enough samples
-		s.offset = medianOffset;
-		s.factor = 1.0;
-		log("sync based on %d samples: offset %g\n", num, s.offset);
-	} else {
-		s.offset = medianOffset;
-		s.factor = 0.0;
-		meanLocalT /= num;
-		int64_t sumAsqr = 0;
-		int64_t sumAB = 0;
-		for (SyncSample& ss : syncSamples) {
-			int64_t a = (int64_t)(ss.localT - meanLocalT);
-			sumAsqr += a*a;
-			int64_t b = (int64_t)(ss.remoteT - ss.localT - medianOffset);
-			sumAB += a*b;
+uint64_t RemoteCaptury::getRemoteTime(uint64_t localT)
+{
+	return clockMapping.getRemoteTime(localT);
+}
+
+extern "C" uint64_t Captury_getTime(RemoteCaptury* rc)
+{
+	return rc->getRemoteTime(getTime());
+}
+
+// mainLock must be locked when calling this function and is unlocked on return
+// buffer has to come from aData->poseMailbox->claim()
+void RemoteCaptury::receivedPose(PoseBuffer* buffer, ActorSlot* slot, uint64_t timestamp, std::unique_lock<std::mutex>& mainLock)
+{
+	const int actorId = slot->id;
+	ActorData* aData = &slot->data;
+	CapturyActor_p a = slot->actor;
+	if (aData->status == ACTOR_DELETED) {
+		mainLock.unlock();
+		buffer->release();
+		return;
+	}
+
+	CapturyPose* pose = &buffer->pose;
+
+	const uint64_t parsedNs = getMonotonicNanoseconds();
+	if (packetReceivedNs != 0)
+		receiveToParse.record(parsedNs - packetReceivedNs);
+
+	if (getLocalPoses)
+		Captury_convertPoseToLocal(this, pose, actorId);
+
+	// a gap of more than one and a half frames means poses went missing
+	int framerateNumerator, framerateDenominator;
+	getFramerate(&framerateNumerator, &framerateDenominator);
+	if (aData->currentPoseTimestamp != 0 && timestamp > aData->currentPoseTimestamp && framerateNumerator > 0 && framerateDenominator > 0) {
+		const uint64_t framePeriod = (uint64_t)framerateDenominator * 1000000 / framerateNumerator;
+		const uint64_t gap = timestamp - aData->currentPoseTimestamp;
+		if (framePeriod != 0 && gap * 2 > framePeriod * 3) {
+			const uint64_t dropped = (gap + framePeriod / 2) / framePeriod - 1;
+			aData->numDroppedPoses += dropped;
+			numDroppedPoses += dropped;
 		}
-		s.factor = sumAB / (double)sumAsqr;
-		s.offset -= meanLocalT * s.factor;
-		s.factor += 1.0;
-		log("sync based on %d samples: offset %15f, factor %.15f (mlt %15f, moff %15f)\n", num, s.offset, s.factor, meanLocalT, medianOffset);
+	}
+	++aData->numPoses;
+	++numPosesReceived;
+
+	pose->timestamp = timestamp;
+	aData->currentPoseTimestamp = timestamp;
+
+	const uint64_t now = (packetReceivedTime != 0) ? packetReceivedTime : getTime();
+	// log("received pose %ld at %ld, diff %ld\n", pose->timestamp, now, now - aData->lastPoseTimestamp);
+	aData->lastPoseTimestamp = now;
+	if (!aData->livenessScheduled) {
+		aData->livenessScheduled = true;
+		liveness.schedule(actorId, now + liveness.timeout());
+	}
+
+	mostRecentPoseReceivedTime = getRemoteTime(now);
+	mostRecentPoseReceivedTimestamp = timestamp;
+
+	bool startedTracking = false;
+	if (aData->status != ACTOR_SCALING && aData->status != ACTOR_TRACKING) {
+		aData->status = ACTOR_TRACKING;
+		startedTracking = true;
+		actorChanges.recordStatus(actorId, ACTOR_TRACKING);
+	}
+
+	CapturyActor* actor = nullptr;
+	if (newPoseCallback != NULL && a) {
+		actor = a.get();
+		returnedActors[actor] = a;
+	}
+
+	// mark actors as stopped if no data was received for a while
+	std::vector<int> stoppedActorIds;
+	if (liveness.isDue(now))
+		checkActors(now, stoppedActorIds);
+
+	int trackingQuality = aData->trackingQuality;
+	buffer->trackingQuality = trackingQuality;
+	std::shared_ptr<PoseMailbox> mailbox = aData->poseMailbox;
+
+	std::vector<PoseBuffer*> completedFrame;
+	if (assembleFrames || assembleFrameArrays)
+		collectFramePose(buffer, completedFrame);
+	mainLock.unlock();
+
+	if (!completedFrame.empty())
+		publishFrame(completedFrame);
+
+	// keep the pose alive for the callback even if it is replaced in the mean time.
+	// readers of the mailbox never wait for mainMutex or the stream thread.
+	buffer->retain();
+	mailbox->publish(buffer);
+
+	if (startedTracking && actorChangedCallback)
+		actorChangedCallback(this, actorId, ACTOR_TRACKING, actorChangedArg);
+
+	buffer->callbackNs = getMonotonicNanoseconds();
+	parseToCallback.record(buffer->callbackNs - parsedNs);
+
+	if (actor != nullptr)
+		newPoseCallback(this, actor, pose, trackingQuality, newPoseArg);
+
+	buffer->release();
+
+	if (actorChangedCallback) {
+		for (int id : stoppedActorIds)
+			actorChangedCallback(this, id, ACTOR_STOPPED, actorChangedArg);
 	}
 }
 
-void RemoteCaptury::updateSync(uint64_t localT)
+// mainMutex must be locked
+void RemoteCaptury::actorModeChanged(int actorId, int mode)
 {
-	constexpr uint64_t defaultTransitionTime = 100000; // 0.1 second
-	Sync tempSync(0.0, 1.0);
-	computeSync(tempSync);
+	ActorSlot* slot = actors.find(actorId);
+	if (slot != nullptr) {
+		slot->data.status = (CapturyActorStatus)mode;
+		// actors that are switched on but never receive a pose are stopped as well
+		if ((mode == ACTOR_SCALING || mode == ACTOR_TRACKING) && !slot->data.livenessScheduled) {
+			slot->data.livenessScheduled = true;
+			liveness.schedule(actorId, getTime() + liveness.timeout());
+		}
+	}
+	actorChanges.recordStatus(actorId, mode);
+}
 
-	std::lock_guard<std::mutex> syncLock(syncMutex);
-	transitionStartLocalT = localT;
+// mainMutex must be locked. stops the actors whose check is due and that did not receive a pose for liveness.timeout().
+void RemoteCaptury::checkActors(uint64_t now, std::vector<int>& stoppedActorIds)
+{
+	liveness.advance(now, dueActorIds);
+	for (int id : dueActorIds) {
+		ActorSlot* slot = actors.find(id);
+		if (slot == nullptr) // deleted in the mean time
+			continue;
 
-	// transitionFactor = std::abs(transitionStartRemoteT - remoteT) / defaultTransitionTime;
-	// TODO limit skew speed
-	transitionEndLocalT = transitionStartLocalT + defaultTransitionTime;
-	double transitionStartRemoteT = (double)currentSync.getRemoteTime(localT);
+		ActorData& data = slot->data;
+		if (data.lastPoseTimestamp + liveness.timeout() > now) { // received a pose since it was scheduled
+			liveness.schedule(id, data.lastPoseTimestamp + liveness.timeout());
+			continue;
+		}
 
-	oldSync = currentSync;
-	currentSync = tempSync;
+		data.livenessScheduled = false;
+		if (data.status == ACTOR_SCALING || data.status == ACTOR_TRACKING) {
+			data.status = ACTOR_STOPPED;
+			actorChanges.recordStatus(id, ACTOR_STOPPED);
+			stoppedActorIds.push_back(id);
+		}
+	}
+}
 
-	double delta = transitionStartRemoteT - currentSync.getRemoteTime(localT);
-	double factor = currentSync.factor;
+// stops actors even if no poses arrive at all
+void RemoteCaptury::checkActorsAndNotify()
+{
+	const uint64_t now = getTime();
+	std::vector<int> stoppedActorIds;
+	std::unique_lock<std::mutex> mainLock(mainMutex);
+	if (!liveness.isDue(now))
+		return;
+	checkActors(now, stoppedActorIds);
+	mainLock.unlock();
 
-	log("sync: old - new estimate %g (factor %g)\n", delta, factor);
+	if (actorChangedCallback) {
+		for (int id : stoppedActorIds)
+			actorChangedCallback(this, id, ACTOR_STOPPED, actorChangedArg);
+	}
 }
 
-uint64_t RemoteCaptury::getRemoteTime(uint64_t localT)
+// mainMutex must be locked. completedFrame returns the poses of a frame that is ready to be published.
+void RemoteCaptury::collectFramePose(PoseBuffer* buffer, std::vector<PoseBuffer*>& completedFrame)
 {
-	std::lock_guard<std::mutex> syncLock(syncMutex);
-	if (localT >= transitionEndLocalT) {
-		uint64_t t = currentSync.getRemoteTime(localT);
-		return t;
+	const uint64_t timestamp = buffer->pose.timestamp;
+	if (timestamp < pendingFrameTimestamp || (timestamp == pendingFrameTimestamp && pendingFramePublished))
+		return; // late pose of a frame that is already gone
+
+	if (timestamp > pendingFrameTimestamp) {
+		// the previous frame is as complete as it is going to get
+		completedFrame.swap(pendingFramePoses);
+		pendingFrameTimestamp = timestamp;
+		pendingFramePublished = false;
+		pendingFrameExpectedPoses = 0;
+		for (ActorSlot& slot : actors)
+			if (slot.data.poseMailbox && (slot.data.status == ACTOR_SCALING || slot.data.status == ACTOR_TRACKING))
+				++pendingFrameExpectedPoses;
 	}
 
-	uint64_t oldEstimate = oldSync.getRemoteTime(localT);
-	uint64_t newEstimate = currentSync.getRemoteTime(localT);
-	double at = double(localT - transitionStartLocalT) / (transitionEndLocalT - transitionStartLocalT);
-	// log("sync: local %" PRIu64 " old %" PRIu64 " new %" PRIu64 " -> %" PRIu64 "\n", localT, oldEstimate, newEstimate, (uint64_t)(oldEstimate * (1.0 - at) + newEstimate * at));
-	return (uint64_t)(oldEstimate * (1.0 - at) + newEstimate * at);
+	buffer->retain();
+	pendingFramePoses.push_back(buffer);
+
+	if ((int)pendingFramePoses.size() >= pendingFrameExpectedPoses) {
+		// every actor that is tracked has delivered its pose. no need to wait for the next frame.
+		for (PoseBuffer* b : completedFrame)
+			b->release();
+		completedFrame.clear();
+		completedFrame.swap(pendingFramePoses);
+		pendingFramePublished = true;
+	}
 }
 
-extern "C" uint64_t Captury_getTime(RemoteCaptury* rc)
+// releases the poses
+void RemoteCaptury::publishFrame(std::vector<PoseBuffer*>& poses)
 {
-	return rc->getRemoteTime(getTime());
+	std::sort(poses.begin(), poses.end(), [](const PoseBuffer* a, const PoseBuffer* b) { return a->pose.actor < b->pose.actor; });
+
+	{
+		std::lock_guard<std::mutex> frameLock(frameMutex);
+		if (assembleFrames) {
+			FrameSnapshotBuffer* buffer = frameMailbox.claim(FrameSnapshotBuffer::size(poses));
+			buffer->fill(poses, ++frameMailbox.version);
+			frameMailbox.publish(buffer);
+		}
+		if (assembleFrameArrays) {
+			FrameArraysBuffer* buffer = frameArraysMailbox.claim(FrameArraysBuffer::size(poses));
+			buffer->fill(poses, ++frameArraysMailbox.version);
+			frameArraysMailbox.publish(buffer);
+		}
+	}
+
+	for (PoseBuffer* b : poses)
+		b->release();
+	poses.clear();
+}
+
+// mainMutex must be locked
+void RemoteCaptury::clearPendingFrame()
+{
+	for (PoseBuffer* b : pendingFramePoses)
+		b->release();
+	pendingFramePoses.clear();
+	pendingFrameTimestamp = 0;
+	pendingFramePublished = false;
+}
+
+//
+// thin wrappers around SSE2 / AVX2 so that the kernels below can be written once
+//
+#ifdef CAPTURY_SIMD_WIDTH
+#if CAPTURY_SIMD_WIDTH == 8
+typedef __m256 vfloat;
+typedef __m256i vint;
+static inline vfloat vset(float f)			{ return _mm256_set1_ps(f); }
+static inline vfloat vadd(vfloat a, vfloat b)		{ return _mm256_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b)		{ return _mm256_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b)		{ return _mm256_mul_ps(a, b); }
+static inline vfloat vand(vfloat a, vfloat b)		{ return _mm256_and_ps(a, b); }
+static inline vfloat vandnot(vfloat a, vfloat b)	{ return _mm256_andnot_ps(a, b); }
+static inline vfloat vor(vfloat a, vfloat b)		{ return _mm256_or_ps(a, b); }
+static inline vfloat vxor(vfloat a, vfloat b)		{ return _mm256_xor_ps(a, b); }
+static inline vint vround(vfloat a)			{ return _mm256_cvtps_epi32(a); }
+static inline vfloat vtofloat(vint a)			{ return _mm256_cvtepi32_ps(a); }
+static inline vfloat vbitmask(vint a, int bit)		{ return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(a, _mm256_set1_epi32(bit)), _mm256_set1_epi32(bit))); }
+static inline vint vaddi(vint a, int b)			{ return _mm256_add_epi32(a, _mm256_set1_epi32(b)); }
+static inline vfloat vload(const float* f, int stride)	{ return _mm256_set_ps(f[7*stride], f[6*stride], f[5*stride], f[4*stride], f[3*stride], f[2*stride], f[stride], f[0]); }
+static inline void vstore(float* f, vfloat a)		{ _mm256_storeu_ps(f, a); }
+static inline vint vandi(vint a, int b)			{ return _mm256_and_si256(a, _mm256_set1_epi32(b)); }
+static inline vint vslli(vint a, int n)			{ return _mm256_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline vint vsrli(vint a, int n)			{ return _mm256_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline vint vsrai(vint a, int n)			{ return _mm256_sra_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline vint vset32(const uint32_t* u)		{ return _mm256_setr_epi32(u[0], u[1], u[2], u[3], u[4], u[5], u[6], u[7]); }
+#else
+typedef __m128 vfloat;
+typedef __m128i vint;
+static inline vfloat vset(float f)			{ return _mm_set1_ps(f); }
+static inline vfloat vadd(vfloat a, vfloat b)		{ return _mm_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b)		{ return _mm_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b)		{ return _mm_mul_ps(a, b); }
+static inline vfloat vand(vfloat a, vfloat b)		{ return _mm_and_ps(a, b); }
+static inline vfloat vandnot(vfloat a, vfloat b)	{ return _mm_andnot_ps(a, b); }
+static inline vfloat vor(vfloat a, vfloat b)		{ return _mm_or_ps(a, b); }
+static inline vfloat vxor(vfloat a, vfloat b)		{ return _mm_xor_ps(a, b); }
+static inline vint vround(vfloat a)			{ return _mm_cvtps_epi32(a); }
+static inline vfloat vtofloat(vint a)			{ return _mm_cvtepi32_ps(a); }
+static inline vfloat vbitmask(vint a, int bit)		{ return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(a, _mm_set1_epi32(bit)), _mm_set1_epi32(bit))); }
+static inline vint vaddi(vint a, int b)			{ return _mm_add_epi32(a, _mm_set1_epi32(b)); }
+static inline vfloat vload(const float* f, int stride)	{ return _mm_set_ps(f[3*stride], f[2*stride], f[stride], f[0]); }
+static inline void vstore(float* f, vfloat a)		{ _mm_storeu_ps(f, a); }
+static inline vint vandi(vint a, int b)			{ return _mm_and_si128(a, _mm_set1_epi32(b)); }
+static inline vint vslli(vint a, int n)			{ return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline vint vsrli(vint a, int n)			{ return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline vint vsrai(vint a, int n)			{ return _mm_sra_epi32(a, _mm_cvtsi32_si128(n)); }
+static inline vint vset32(const uint32_t* u)		{ return _mm_setr_epi32(u[0], u[1], u[2], u[3]); }
+#endif
+
+static inline vfloat vselect(vfloat mask, vfloat a, vfloat b) { return vor(vand(mask, a), vandnot(mask, b)); }
+#endif
+
+static inline uint32_t loadUnaligned32(const uint8_t* v)
+{
+	uint32_t u;
+	memcpy(&u, v, sizeof(u));
+	return u;
+}
+
+// the sign is extended by shifting the top bit of the field into bit 31 and back
+static inline int32_t signExtend24(uint32_t u)	{ return (int32_t)(u << 8) >> 8; }
+static inline int32_t signExtend16(uint32_t u)	{ return (int32_t)(u << 16) >> 16; }
+
+// 11 bits x, 11 bits y, 10 bits z
+static inline void decompressRotation(float* copyTo, uint32_t rall)
+{
+	copyTo[0] = ((rall & 0x000007FF))       * (360.0f / 2047) - 180.0f;
+	copyTo[1] = ((rall & 0x003FF800) >> 11) * (360.0f / 2047) - 180.0f;
+	copyTo[2] = ((rall & 0xFFC00000) >> 22) * (180.0f / 1023);
+}
+
+// compressed layout: the root has a 3x24 bit absolute translation, all other joints a 3x16 bit translation
+// relative to their parent. every joint is followed by a 32 bit rotation. all translations are in 1/16 mm.
+static void decompressPose(CapturyPose* pose, uint8_t* v, CapturyActor* actor)
+{
+	float* values = (float*)pose->transforms;
+	int numJoints = (actor->numJoints < pose->numTransforms) ? actor->numJoints : pose->numTransforms;
+	if (numJoints > 0) {
+		values[0] = signExtend24(loadUnaligned32(v)) * 0.0625f;
+		values[1] = signExtend24(loadUnaligned32(v + 3)) * 0.0625f;
+		values[2] = signExtend24(loadUnaligned32(v + 6)) * 0.0625f;
+		decompressRotation(values + 3, loadUnaligned32(v + 9));
+		v += 13;
+	}
+
+	// all other joints take 10 bytes each so every field sits at a fixed offset
+	int i = 1;
+#ifdef CAPTURY_SIMD_WIDTH
+	for ( ; i + CAPTURY_SIMD_WIDTH <= numJoints; i += CAPTURY_SIMD_WIDTH, v += 10 * CAPTURY_SIMD_WIDTH) {
+		uint32_t txy[CAPTURY_SIMD_WIDTH], tz[CAPTURY_SIMD_WIDTH], rall[CAPTURY_SIMD_WIDTH];
+		for (int k = 0; k < CAPTURY_SIMD_WIDTH; ++k) {
+			txy[k] = loadUnaligned32(v + k*10);
+			tz[k] = loadUnaligned32(v + k*10 + 4);
+			rall[k] = loadUnaligned32(v + k*10 + 6);
+		}
+		const vint t = vset32(txy);
+		const vint z = vset32(tz);
+		const vint r = vset32(rall);
+
+		float decoded[6][CAPTURY_SIMD_WIDTH];
+		vstore(decoded[0], vmul(vtofloat(vsrai(vslli(t, 16), 16)), vset(0.0625f)));
+		vstore(decoded[1], vmul(vtofloat(vsrai(t, 16)), vset(0.0625f)));
+		vstore(decoded[2], vmul(vtofloat(vsrai(vslli(z, 16), 16)), vset(0.0625f)));
+		vstore(decoded[3], vsub(vmul(vtofloat(vandi(r, 0x7FF)), vset(360.0f / 2047)), vset(180.0f)));
+		vstore(decoded[4], vsub(vmul(vtofloat(vandi(vsrli(r, 11), 0x7FF)), vset(360.0f / 2047)), vset(180.0f)));
+		vstore(decoded[5], vmul(vtofloat(vsrli(r, 22)), vset(180.0f / 1023)));
+
+		float* copyTo = values + i*6;
+		for (int k = 0; k < CAPTURY_SIMD_WIDTH; ++k, copyTo += 6) {
+			for (int c = 0; c < 6; ++c)
+				copyTo[c] = decoded[c][k];
+		}
+	}
+#endif
+	for ( ; i < numJoints; ++i, v += 10) {
+		float* copyTo = values + i*6;
+		const uint32_t txy = loadUnaligned32(v);
+		copyTo[0] = signExtend16(txy) * 0.0625f;
+		copyTo[1] = signExtend16(txy >> 16) * 0.0625f;
+		copyTo[2] = signExtend16(loadUnaligned32(v + 4)) * 0.0625f;
+		decompressRotation(copyTo + 3, loadUnaligned32(v + 6));
+	}
+
+	// make translations absolute. parents always come before their children.
+	for (i = 1; i < numJoints; ++i) {
+		const int parent = actor->joints[i].parent;
+		if (parent < 0 || parent >= i)
+			continue;
+		values[i*6]   += values[parent*6];
+		values[i*6+1] += values[parent*6+1];
+		values[i*6+2] += values[parent*6+2];
+	}
+
+	for (int i = 0; i < pose->numBlendShapes; ++i, v += 2) {
+		uint16_t activation;
+		memcpy(&activation, v, sizeof(activation));
+		pose->blendShapeActivations[i] = activation / 32768.0f;
+	}
 }
 
-void RemoteCaptury::receivedPose(CapturyPose* pose, int actorId, ActorData* aData, uint64_t timestamp)
+// decodes the values of a complete pose
+static void decodePose(CapturyPose* pose, const void* data, const PoseLayout& layout, CapturyActor* actor)
 {
-	std::unique_lock<std::mutex> mainLock(mainMutex);
-	
-	if (aData->status == ACTOR_DELETED)
+	if (layout.compressed) {
+		decompressPose(pose, (uint8_t*)data, actor);
 		return;
+	}
 
-	if (getLocalPoses)
-		Captury_convertPoseToLocal(this, pose, actorId);
-
-	pose->timestamp = timestamp;
+	const float* values = (const float*)data;
+	const int numTransforms = std::min(layout.numTransforms, pose->numTransforms);
+	const int numBlendShapes = std::min(layout.numBlendShapes, pose->numBlendShapes);
+	if (numTransforms != 0) {
+		if (layout.onlyRootTranslation) {
+			if (layout.numTransformValues >= 6) {
+				memcpy(pose->transforms, values, 6*sizeof(float));
+				for (int i = 1, n = 6; i < numTransforms; ++i, n += 3)
+					memcpy(pose->transforms[i].rotation, values+n, 3*sizeof(float));
+			}
+		} else
+			memcpy(pose->transforms, values, numTransforms*6*sizeof(float));
+	}
+	if (numBlendShapes != 0)
+		memcpy(pose->blendShapeActivations, values + layout.numTransformValues, numBlendShapes*sizeof(float));
+}
 
-	uint64_t now = getTime();
-	// log("received pose %ld at %ld, diff %ld\n", pose->timestamp, now, now - aData->lastPoseTimestamp);
-	aData->lastPoseTimestamp = now;
+// mainMutex must be locked. layout is NULL for continuation packets.
+void RemoteCaptury::receivedPoseFragment(ActorSlot* slot, uint64_t timestamp, const void* data, int size, const PoseLayout* layout, std::unique_lock<std::mutex>& mainLock)
+{
+	ActorData& aData = slot->data;
+	PoseReassembly& reassembly = aData.reassembly;
+	const uint64_t now = getTime();
 
-	mostRecentPoseReceivedTime = getRemoteTime(now);
-	mostRecentPoseReceivedTimestamp = timestamp;
+	// drop poses that are superseded by a newer pose or took too long
+	uint64_t numExpired = 0;
+	int numFailed = reassembly.expire(aData.currentPoseTimestamp, now - std::min(now, reassemblyTimeout.load()), numExpired);
 
-	if (aData->status != ACTOR_SCALING && aData->status != ACTOR_TRACKING) {
-		aData->status = ACTOR_TRACKING;
-		if (actorChangedCallback) {
-			mainLock.unlock();
-			actorChangedCallback(this, actorId, ACTOR_TRACKING, actorChangedArg);
-			mainLock.lock();
+	if (timestamp <= aData.currentPoseTimestamp) {
+		if (timestamp == aData.currentPoseTimestamp)
+			++numDuplicateFragments;
+		else
+			++numExpired;
+	} else {
+		PoseReassembly::Pose* pose = reassembly.find(timestamp);
+		if (pose == nullptr) {
+			while (reassembly.numInFlight() >= std::max(1, maxPosesInFlight.load()))
+				numFailed += reassembly.expireOldest(numExpired);
+			pose = &reassembly.add(timestamp, now);
 		}
-	}
-
-	if (newPoseCallback != NULL && actorsById.count(actorId)) {
-		CapturyActor_p a = actorsById[actorId];
-		CapturyActor* actor = a.get();
-		returnedActors[actor] = a;
-		mainLock.unlock();
-		newPoseCallback(this, actor, pose, aData->trackingQuality, newPoseArg);
-		mainLock.lock();
-	}
 
-	// mark actors as stopped if no data was received for a while
-	now -= 500000; // half a second ago
-	std::vector<int> stoppedActorIds;
-	for (std::unordered_map<int, ActorData>::iterator it = actorData.begin(); it != actorData.end(); ++it) {
-		if (it->second.lastPoseTimestamp > now) // still current
-			continue;
+		if (layout != nullptr && pose->haveFirstPacket)
+			++numDuplicateFragments;
+		else {
+			++pose->numParts;
+			if (layout != nullptr) {
+				pose->haveFirstPacket = true;
+				pose->layout = *layout;
+				pose->data.insert(pose->data.begin(), (const uint8_t*)data, (const uint8_t*)data + size);
+			} else
+				pose->data.insert(pose->data.end(), (const uint8_t*)data, (const uint8_t*)data + size);
 
-		if (it->second.status == ACTOR_SCALING || it->second.status == ACTOR_TRACKING) {
-			if (actorChangedCallback)
-				stoppedActorIds.push_back(it->first);
-			it->second.status = ACTOR_STOPPED;
+			if (pose->haveFirstPacket && (int)pose->data.size() > pose->layout.numBytes) {
+				lastErrorMessage = "pose continuation too large";
+				reassembly.remove(*pose);
+				++numFailed;
+			} else if (pose->haveFirstPacket && (int)pose->data.size() == pose->layout.numBytes) {
+				PoseBuffer* buffer = aData.poseMailbox->claim();
+				decodePose(&buffer->pose, pose->data.data(), pose->layout, slot->actor.get());
+				reassembly.remove(*pose);
+				++numReassembledPoses;
+
+				numExpiredFragments += numExpired;
+				aData.numReassemblyFailures += numFailed;
+				numReassemblyFailures += numFailed;
+				receivedPose(buffer, slot, timestamp, mainLock);
+				return;
+			}
 		}
 	}
 
-	mainLock.unlock();
-	for (int id : stoppedActorIds)
-	{
-		actorChangedCallback(this, id, ACTOR_STOPPED, actorChangedArg);
-	}
-	mainLock.lock();
-}
-
-static void decompressPose(CapturyPose* pose, uint8_t* v, CapturyActor* actor)
-{
-	float* copyTo = (float*)pose->transforms;
-	float* values = (float*)pose->transforms;
-	int numJoints = (actor->numJoints < pose->numTransforms) ? actor->numJoints : pose->numTransforms;
-	for (int i = 0; i < numJoints; ++i) {
-		if (i == 0) {
-			int32_t t = v[0] | (v[1] << 8) | (v[2] << 16);
-			if ((t & 0x800000) != 0)
-				t |= 0xFF000000;
-			copyTo[0] = t * 0.0625f;
-			v += 3;
-			t = v[0] | (v[1] << 8) | (v[2] << 16);
-			if ((t & 0x800000) != 0)
-				t |= 0xFF000000;
-			copyTo[1] = t * 0.0625f;
-			v += 3;
-			t = v[0] | (v[1] << 8) | (v[2] << 16);
-			if ((t & 0x800000) != 0)
-				t |= 0xFF000000;
-			copyTo[2] = t * 0.0625f;
-			v += 3;
-		} else {
-			int32_t t = v[0] | (v[1] << 8);
-			if ((t & 0x8000) != 0)
-				t |= 0xFFFF0000;
-			copyTo[0] = t * 0.0625f + values[actor->joints[i].parent*6];
-			v += 2;
-			t = v[0] | (v[1] << 8);
-			if ((t & 0x8000) != 0)
-				t |= 0xFFFF0000;
-			copyTo[1] = t * 0.0625f + values[actor->joints[i].parent*6+1];
-			v += 2;
-			t = v[0] | (v[1] << 8);
-			if ((t & 0x8000) != 0)
-				t |= 0xFFFF0000;
-			copyTo[2] = t * 0.0625f + values[actor->joints[i].parent*6+2];
-			v += 2;
-		}
-
-		// decompress rotation
-		uint32_t rall = *(uint32_t*)v;
-		v += 4;
-		copyTo[3] = ((rall & 0x000007FF))       * (360.0f / 2047) - 180.0f;
-		copyTo[4] = ((rall & 0x003FF800) >> 11) * (360.0f / 2047) - 180.0f;
-		copyTo[5] = ((rall & 0xFFC00000) >> 22) * (180.0f / 1023);
-		copyTo += 6;
-	}
-
-	for (int i = 0; i < pose->numBlendShapes; ++i, v += 2)
-		pose->blendShapeActivations[i] = (*(uint16_t*)v) / 32768.0f;
+	numExpiredFragments += numExpired;
+	aData.numReassemblyFailures += numFailed;
+	numReassemblyFailures += numFailed;
 }
 
 void RemoteCaptury::receivedPosePacket(CapturyPosePacket* cpp)
 {
 	std::unique_lock<std::mutex> mainLock(mainMutex);
-	if (actorsById.count(cpp->actor) == 0) {
+	ActorSlot* slot = actors.find(cpp->actor);
+	if (slot == nullptr || !slot->actor) {
 		char buff[400];
 		snprintf(buff, 400, "Actor %x does not exist", cpp->actor);
 		lastErrorMessage = buff;
@@ -874,7 +2401,7 @@ void RemoteCaptury::receivedPosePacket(CapturyPosePacket* cpp)
 		at = (int)((char*)(((CapturyPosePacket2*)cpp)->values) - (char*)cpp);
 	}
 
-	CapturyActor* actor = actorsById[cpp->actor].get();
+	CapturyActor* actor = slot->actor.get();
 	bool onlyRootTranslation;
 	int numTransforms, numTransformValues;
 	int numBlendShapes;
@@ -894,7 +2421,7 @@ void RemoteCaptury::receivedPosePacket(CapturyPosePacket* cpp)
 		expectedNumValues = actor->numJoints * 6 + actor->numBlendShapes;
 	}
 
-	if (actorsById.count(cpp->actor) != 0 && expectedNumValues != numValues) {
+	if (expectedNumValues != numValues) {
 		if ((onlyRootTranslation && actor->numJoints * 3 + 3 == numValues) ||
 		    (!onlyRootTranslation && actor->numJoints * 6 == numValues))
 			numBlendShapes = 0;
@@ -907,65 +2434,34 @@ void RemoteCaptury::receivedPosePacket(CapturyPosePacket* cpp)
 		}
 	}
 
-	std::unordered_map<int, ActorData>::iterator it = actorData.find(cpp->actor);
-	if (it == actorData.end() || (it->second.currentPose.numTransforms == 0 && it->second.currentPose.numBlendShapes == 0)) {
-		it = actorData.insert(std::make_pair(cpp->actor, ActorData())).first;
-		it->second.currentPose.actor = cpp->actor;
-		it->second.currentPose.numTransforms = numTransforms;
-		it->second.currentPose.transforms = (numTransforms != 0) ? new CapturyTransform[numTransforms] : nullptr;
-		it->second.currentPose.numBlendShapes = numBlendShapes;
-		it->second.currentPose.blendShapeActivations = (numBlendShapes != 0) ? new float[numBlendShapes] : nullptr;
-	}
+	ActorData& aData = slot->data;
+	if (!aData.poseMailbox || (aData.poseMailbox->numTransforms == 0 && aData.poseMailbox->numBlendShapes == 0))
+		aData.poseMailbox = std::make_shared<PoseMailbox>(cpp->actor, numTransforms, numBlendShapes);
 
 	if (cpp->type == capturyPose2 || cpp->type == capturyCompressedPose2) {
-		it->second.scalingProgress = ((CapturyPosePacket2*)cpp)->scalingProgress;
-		it->second.trackingQuality = ((CapturyPosePacket2*)cpp)->trackingQuality;
-		it->second.flags = ((CapturyPosePacket2*)cpp)->flags;
+		aData.scalingProgress = ((CapturyPosePacket2*)cpp)->scalingProgress;
+		aData.trackingQuality = ((CapturyPosePacket2*)cpp)->trackingQuality;
+		aData.flags = ((CapturyPosePacket2*)cpp)->flags;
 	}
 
-	// select oldest in-progress item
-	int inProgressIndex = 0;
-	uint64_t oldest = 0xFFFFFFFFFFFFFFFF;
-	for (int x = 0; x < 4; ++x) {
-		if (it->second.inProgress[x].timestamp < oldest) {
-			oldest = it->second.inProgress[x].timestamp;
-			inProgressIndex = x;
-		}
-	}
+	PoseLayout layout;
+	layout.numTransforms = numTransforms;
+	layout.numTransformValues = numTransformValues;
+	layout.numBlendShapes = numBlendShapes;
+	layout.onlyRootTranslation = onlyRootTranslation;
+	layout.compressed = (cpp->type == capturyCompressedPose || cpp->type == capturyCompressedPose2);
+	layout.numBytes = layout.compressed ? (numTransforms-1)*10 + 13 + numBlendShapes * 2 : (numTransformValues + numBlendShapes) * (int)sizeof(float);
 
-	// either copy to currentPose or inProgress pose
+	// either decode straight into the buffer that will be published or wait for the rest of the pose
 	int numBytesToCopy = cpp->size - at;
-	bool done = false;
-	if ((cpp->type == capturyPose || cpp->type == capturyPose2) && numBytesToCopy == (int)((numTransformValues + numBlendShapes)*sizeof(float))) {
-		if (numTransforms != 0) {
-			if (onlyRootTranslation) {
-				if (numTransformValues >= 6) {
-					memcpy(it->second.currentPose.transforms, values, 6*sizeof(float));
-					for (int i = 1, n = 6; n < numTransformValues; ++i, n += 3)
-						memcpy(it->second.currentPose.transforms[i].rotation, values+n, 3*sizeof(float));
-				}
-			} else
-				memcpy(it->second.currentPose.transforms, values, numTransformValues*sizeof(float));
-		}
-		if (numBlendShapes != 0)
-			memcpy(it->second.currentPose.blendShapeActivations, values + numTransformValues, numBlendShapes*sizeof(float));
-		done = true;
-	} else if ((cpp->type == capturyCompressedPose || cpp->type == capturyCompressedPose2) && numBytesToCopy == (numTransforms-1)*10 + 13 + numBlendShapes * 2) {
-		decompressPose(&it->second.currentPose, (uint8_t*)values, actor);
-		done = true;
-	} else {// partial
-		if (it->second.inProgress[inProgressIndex].pose == NULL)
-			it->second.inProgress[inProgressIndex].pose = new float[numValues];
-		memcpy(it->second.inProgress[inProgressIndex].pose, values, numBytesToCopy);
-		it->second.inProgress[inProgressIndex].bytesDone = numBytesToCopy;
-		it->second.inProgress[inProgressIndex].timestamp = cpp->timestamp;
-		it->second.inProgress[inProgressIndex].onlyRootTranslation = onlyRootTranslation;
-	}
-
-	if (done) {
-		mainLock.unlock();
-		receivedPose(&it->second.currentPose, cpp->actor, &it->second, cpp->timestamp);
-	}
+	if (numBytesToCopy == layout.numBytes) {
+		PoseBuffer* buffer = aData.poseMailbox->claim();
+		decodePose(&buffer->pose, values, layout, actor);
+		receivedPose(buffer, slot, cpp->timestamp, mainLock);
+	} else if (numBytesToCopy < layout.numBytes)
+		receivedPoseFragment(slot, cpp->timestamp, values, numBytesToCopy, &layout, mainLock);
+	else
+		log("pose of actor %x has %d bytes, expected %d\n", cpp->actor, numBytesToCopy, layout.numBytes);
 }
 
 SOCKET RemoteCaptury::openTcpSocket()
@@ -986,8 +2482,7 @@ SOCKET RemoteCaptury::openTcpSocket()
 		return (SOCKET)-1;
 	}
 
-	// set read timeout
-	setSocketTimeout(sok, 500);
+	tcpReader.reset();
 
 #ifndef WIN32
 	char buf[100];
@@ -1015,515 +2510,943 @@ static bool isSocketErrorTryAgain(int err)
 #endif
 }
 
-// waits for at most 500ms before it fails
-// returns false if the expected packet is not received
-bool RemoteCaptury::receive(SOCKET& sok)
+//
+// shared reactor
+//
+// each IoLoop thread waits for all of its sockets at once and sleeps until the next timer is due.
+// handlers drain their socket until it would block, which is what edge-triggered epoll requires
+// and does no harm with level-triggered poll.
+//
+IoLoop::IoLoop()
+{
+	// datagrams sent to ourselves wake up the loop when a task is queued
+	wakeSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	sockaddr_in loopback;
+	memset(&loopback, 0, sizeof(loopback));
+	loopback.sin_family = AF_INET;
+	loopback.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	loopback.sin_port = 0;
+	socklen_t len = sizeof(loopback);
+	bind(wakeSock, (sockaddr*) &loopback, sizeof(loopback));
+	getsockname(wakeSock, (sockaddr*) &loopback, &len);
+	::connect(wakeSock, (sockaddr*) &loopback, sizeof(loopback));
+	setSocketNonBlocking(wakeSock);
+
+#ifdef CAPTURY_HAVE_EPOLL
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	epoll_event ev;
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.fd = wakeSock;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeSock, &ev);
+#endif
+
+	thread = std::thread(&IoLoop::loop, this);
+}
+
+IoLoop::~IoLoop()
+{
+	stopping = true;
+	wake();
+	thread.join();
+
+#ifdef CAPTURY_HAVE_EPOLL
+	close(epollFd);
+#endif
+	closesocket(wakeSock);
+}
+
+void IoLoop::wake()
+{
+	char c = 0;
+	send(wakeSock, &c, 1, 0);
+}
+
+void IoLoop::run(const Handler& task)
 {
-	static std::vector<char> buffer(9000);
-	CapturyRequestPacket* p = (CapturyRequestPacket*)buffer.data();
+	if (std::this_thread::get_id() == thread.get_id()) {
+		task();
+		return;
+	}
 
+	std::promise<void> done;
 	{
-		fd_set reader;
-		FD_ZERO(&reader);
-		FD_SET(sok, &reader);
+		std::lock_guard<std::mutex> taskLock(taskMutex);
+		tasks.push_back([&task, &done]() { task(); done.set_value(); });
+	}
+	wake();
+	done.get_future().wait();
+}
 
-		struct timeval tv;
-		tv.tv_sec = 0;
-		tv.tv_usec = 500000; // 500ms should be enough
-		int ret = select((int)(sok+1), &reader, NULL, NULL, &tv);
-		if (ret == -1) { // error
-			int err = sockerror();
-			if (isSocketErrorFatal(err)) {
-				// connection closed by peer or network down
-				closesocket(sok);
-				sok = (SOCKET)-1;
-			}
-			log("error waiting for socket: %s\n", sockstrerror(err));
-			return false;
+void IoLoop::runTasks()
+{
+	std::vector<Handler> pending;
+	{
+		std::lock_guard<std::mutex> taskLock(taskMutex);
+		pending.swap(tasks);
+	}
+	for (Handler& task : pending)
+		task();
+}
+
+void IoLoop::addSocket(SOCKET sock, bool wantWrite, const Handler& handler)
+{
+	watches.push_back(Watch{sock, wantWrite, handler});
+#ifdef CAPTURY_HAVE_EPOLL
+	epoll_event ev;
+	ev.events = EPOLLIN | EPOLLET | (wantWrite ? (uint32_t)EPOLLOUT : 0u);
+	ev.data.fd = sock;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, sock, &ev);
+#endif
+}
+
+void IoLoop::setWantWrite(SOCKET sock, bool wantWrite)
+{
+	for (Watch& w : watches) {
+		if (w.sock != sock)
+			continue;
+		w.wantWrite = wantWrite;
+#ifdef CAPTURY_HAVE_EPOLL
+		epoll_event ev;
+		ev.events = EPOLLIN | EPOLLET | (wantWrite ? (uint32_t)EPOLLOUT : 0u);
+		ev.data.fd = sock;
+		epoll_ctl(epollFd, EPOLL_CTL_MOD, sock, &ev);
+#endif
+	}
+}
+
+// must be called before sock is closed
+void IoLoop::removeSocket(SOCKET sock)
+{
+	for (size_t i = 0; i < watches.size(); ++i) {
+		if (watches[i].sock != sock)
+			continue;
+#ifdef CAPTURY_HAVE_EPOLL
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, sock, nullptr);
+#endif
+		watches.erase(watches.begin() + i);
+		return;
+	}
+}
+
+int IoLoop::addTimer(uint64_t interval, const Handler& handler)
+{
+	const int id = nextTimerId++;
+	timers.push_back(Timer{id, getMonotonicNanoseconds() / 1000 + interval, interval, handler});
+	return id;
+}
+
+void IoLoop::removeTimer(int id)
+{
+	for (size_t i = 0; i < timers.size(); ++i) {
+		if (timers[i].id == id) {
+			timers.erase(timers.begin() + i);
+			return;
 		}
-		if (ret == 0) { // timeout
-			return true;
+	}
+}
+
+// handlers may add and remove sockets so they are looked up for every event and called through a copy
+void IoLoop::dispatch(SOCKET sock)
+{
+	if (sock == wakeSock) {
+		char buf[64];
+		while (recv(wakeSock, buf, sizeof(buf), 0) > 0)
+			;
+		runTasks();
+		return;
+	}
+
+	for (const Watch& w : watches) {
+		if (w.sock == sock) {
+			Handler handler = w.handler;
+			handler();
+			return;
 		}
+	}
+}
 
-		{
-			struct sockaddr_in thisEnd;
-			socklen_t len = sizeof(thisEnd);
- 			getsockname(sok, (sockaddr*) &thisEnd, &len);
+int IoLoop::runTimers()
+{
+	uint64_t now = getMonotonicNanoseconds() / 1000;
+	std::vector<int> due;
+	for (const Timer& t : timers)
+		if (t.due <= now)
+			due.push_back(t.id);
+
+	for (int id : due) {
+		for (Timer& t : timers) {
+			if (t.id != id)
+				continue;
+			t.due = std::max(t.due + t.interval, now);
+			Handler handler = t.handler;
+			handler();
+			break;
 		}
+	}
 
-		// first peek to find out which packet type this is
-		int size = recv(sok, buffer.data(), sizeof(CapturyRequestPacket), 0);
-		if (size == 0) { // the other end shut down the socket...
-			log("socket shut down by other end %s\n", sockstrerror());
-			closesocket(sok);
-			sok = (SOCKET)-1;
-			return false;
+	if (timers.empty())
+		return -1;
+
+	now = getMonotonicNanoseconds() / 1000;
+	uint64_t next = timers[0].due;
+	for (const Timer& t : timers)
+		next = std::min(next, t.due);
+	return (next <= now) ? 0 : (int)std::min<uint64_t>((next - now + 999) / 1000, 1000000);
+}
+
+void IoLoop::loop()
+{
+#ifdef CAPTURY_HAVE_EPOLL
+	epoll_event events[64];
+#else
+	std::vector<pollfd> fds;
+#endif
+
+	while (!stopping) {
+		runTasks();
+		const int timeout = runTimers();
+
+#ifdef CAPTURY_HAVE_EPOLL
+		const int numEvents = epoll_wait(epollFd, events, 64, timeout);
+		for (int i = 0; i < numEvents && !stopping; ++i)
+			dispatch(events[i].data.fd);
+#else
+		fds.resize(watches.size() + 1);
+		fds[0].fd = wakeSock;
+		fds[0].events = POLLIN;
+		for (size_t i = 0; i < watches.size(); ++i) {
+			fds[i+1].fd = watches[i].sock;
+			fds[i+1].events = POLLIN | (watches[i].wantWrite ? POLLOUT : 0);
 		}
-		if (size == -1) { // error
-			int err = sockerror();
-			log("socket error %s\n", sockstrerror(err));
-			if (isSocketErrorFatal(err)) {
-				closesocket(sok);
-				sok = (SOCKET)-1;
-			}
+		const int numEvents = poll(fds.data(), (int)fds.size(), timeout);
+		for (size_t i = 0; numEvents > 0 && i < fds.size() && !stopping; ++i)
+			if (fds[i].revents != 0)
+				dispatch(fds[i].fd);
+#endif
+	}
+
+	runTasks();
+}
+
+std::shared_ptr<IoReactor> IoReactor::acquire(int numThreads)
+{
+	static std::mutex reactorMutex;
+	static std::weak_ptr<IoReactor> sharedReactor;
+
+	std::lock_guard<std::mutex> reactorLock(reactorMutex);
+	std::shared_ptr<IoReactor> reactor = sharedReactor.lock();
+	if (reactor)
+		return reactor;
+
+#ifdef WIN32
+	if (!wsaInited) {
+		WSADATA init;
+		WSAStartup(WINSOCK_VERSION, &init);
+		wsaInited = true;
+	}
+#endif
+
+	reactor = std::make_shared<IoReactor>();
+	for (int i = 0; i < std::max(1, numThreads); ++i)
+		reactor->loops.emplace_back(new IoLoop);
+	sharedReactor = reactor;
+	return reactor;
+}
+
+//
+// packet capture files
+//
+// <name> starts with a CaptureFileHeader followed by one CaptureRecord and its payload for every packet
+// in the order they were received. records are only ever appended.
+// <name>.idx holds one CaptureIndexEntry per record so that a replay can map it and seek without
+// parsing the whole capture. if the index is missing or shorter than the capture (e.g. after a crash)
+// the records are scanned instead.
+//
+enum { captureChannelTcp = 0, captureChannelStream = 1 };
+
+struct CaptureFileHeader {
+	char		magic[8];	// "CPTRYCAP"
+	uint32_t	version;
+	uint32_t	reserved;
+};
+
+struct CaptureRecord {
+	uint64_t	receiveTime;	// local time in us
+	uint32_t	size;		// payload size
+	uint8_t		channel;	// captureChannelTcp or captureChannelStream
+	uint8_t		reserved[3];
+};
+
+struct CaptureIndexEntry {
+	uint64_t	receiveTime;
+	uint64_t	offset;		// of the CaptureRecord
+};
+
+static const char captureMagic[8] = {'C', 'P', 'T', 'R', 'Y', 'C', 'A', 'P'};
+static const uint32_t captureVersion = 1;
+
+// read-only memory mapping of a whole file
+struct MappedFile {
+	const char*	data = nullptr;
+	size_t		size = 0;
+#ifdef WIN32
+	HANDLE		file = INVALID_HANDLE_VALUE;
+	HANDLE		mapping = NULL;
+#endif
+
+	bool open(const char* filename)
+	{
+#ifdef WIN32
+		file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+			return false;
+		size = (size_t)fileSize.QuadPart;
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+			return false;
+		data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		return data != nullptr;
+#else
+		int fd = ::open(filename, O_RDONLY);
+		if (fd == -1)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			close(fd);
 			return false;
 		}
+		void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapped == MAP_FAILED)
+			return false;
+		data = (const char*)mapped;
+		size = (size_t)st.st_size;
+		return true;
+#endif
+	}
 
-		if (p->size > (int)sizeof(CapturyRequestPacket)) {
-			if (p->size > 10000000) {
-				log("invalid packet size: %d. closing connection.", p->size);
-				closesocket(sok);
-				sok = (SOCKET)-1;
-				return false;
-			}
+	~MappedFile()
+	{
+#ifdef WIN32
+		if (data != nullptr)
+			UnmapViewOfFile(data);
+		if (mapping != NULL)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+#else
+		if (data != nullptr)
+			munmap((void*)data, size);
+#endif
+	}
+};
 
-			int at = sizeof(CapturyRequestPacket);
-			if (p->size > (int)buffer.size()) {
-				buffer.resize(p->size);
-				p = (CapturyRequestPacket*)buffer.data();
-			}
-			int toGet = p->size - at;
-			while (toGet > 0) {
-				size = recv(sok, &buffer[at], toGet, 0);
-				if (size == 0) { // the other end shut down the socket...
-					log("socket shut down by other end: %s\n", sockstrerror());
-					closesocket(sok);
-					sok = (SOCKET)-1;
-					return false;
-				}
-				if (size == -1) { // error
-					int err = sockerror();
-					log("socket error: %s\n", sockstrerror(err));
-					if (isSocketErrorFatal(err)) {
-						closesocket(sok);
-						sok = (SOCKET)-1;
-					}
-					return false;
-				}
-				at += size;
-				toGet = std::min<int>(p->size, (int)buffer.size()) - at;
+struct PacketCaptureFile {
+	MappedFile			records;
+	MappedFile			index;
+	const CaptureIndexEntry*	entries = nullptr;
+	size_t				numEntries = 0;
+	std::vector<CaptureIndexEntry>	scannedEntries; // only used if the index file is unusable
+
+	bool open(const char* filename)
+	{
+		if (!records.open(filename) || records.size < sizeof(CaptureFileHeader))
+			return false;
+		const CaptureFileHeader* header = (const CaptureFileHeader*)records.data;
+		if (memcmp(header->magic, captureMagic, sizeof(captureMagic)) != 0 || header->version != captureVersion)
+			return false;
+
+		std::string indexName = std::string(filename) + ".idx";
+		if (index.open(indexName.c_str())) {
+			entries = (const CaptureIndexEntry*)index.data;
+			numEntries = index.size / sizeof(CaptureIndexEntry);
+			if (numEntries != 0) {
+				const CaptureIndexEntry& last = entries[numEntries-1];
+				if (last.offset + sizeof(CaptureRecord) + ((const CaptureRecord*)(records.data + last.offset))->size == records.size)
+					return true;
 			}
-			size = std::min<int>(p->size, (int)buffer.size());
 		}
 
-		// log("received packet size %d type %d (expected %d)\n", size, p->type, expect);
+		uint64_t offset = sizeof(CaptureFileHeader);
+		while (offset + sizeof(CaptureRecord) <= records.size) {
+			const CaptureRecord* record = (const CaptureRecord*)(records.data + offset);
+			if (offset + sizeof(CaptureRecord) + record->size > records.size)
+				break; // truncated
+			scannedEntries.push_back({record->receiveTime, offset});
+			offset += sizeof(CaptureRecord) + record->size;
+		}
+		entries = scannedEntries.data();
+		numEntries = scannedEntries.size();
+		return true;
+	}
+};
+
+bool RemoteCaptury::startPacketCapture(const char* filename)
+{
+	stopPacketCapture();
+
+	std::lock_guard<std::mutex> captureLock(captureMutex);
+	captureFile = fopen(filename, "wb");
+	if (captureFile == nullptr) {
+		lastErrorMessage = std::string("cannot open ") + filename;
+		return false;
+	}
+	std::string indexName = std::string(filename) + ".idx";
+	captureIndexFile = fopen(indexName.c_str(), "wb");
+	if (captureIndexFile == nullptr) {
+		lastErrorMessage = "cannot open " + indexName;
+		fclose(captureFile);
+		captureFile = nullptr;
+		return false;
+	}
+
+	CaptureFileHeader header;
+	memcpy(header.magic, captureMagic, sizeof(captureMagic));
+	header.version = captureVersion;
+	header.reserved = 0;
+	fwrite(&header, sizeof(header), 1, captureFile);
+	captureOffset = sizeof(header);
+
+	capturing = true;
+	log("capturing packets to %s\n", filename);
+	return true;
+}
+
+void RemoteCaptury::stopPacketCapture()
+{
+	capturing = false;
+
+	std::lock_guard<std::mutex> captureLock(captureMutex);
+	if (captureFile != nullptr)
+		fclose(captureFile);
+	if (captureIndexFile != nullptr)
+		fclose(captureIndexFile);
+	captureFile = nullptr;
+	captureIndexFile = nullptr;
+}
+
+// called by the receive and the stream thread for every packet
+void RemoteCaptury::capturePacket(int channel, const char* data, int size)
+{
+	if (!capturing)
+		return;
+
+	CaptureRecord record;
+	record.receiveTime = getTime();
+	record.size = (uint32_t)size;
+	record.channel = (uint8_t)channel;
+	memset(record.reserved, 0, sizeof(record.reserved));
+
+	std::lock_guard<std::mutex> captureLock(captureMutex);
+	if (captureFile == nullptr)
+		return;
+
+	CaptureIndexEntry entry = {record.receiveTime, captureOffset};
+	fwrite(&record, sizeof(record), 1, captureFile);
+	fwrite(data, 1, size, captureFile);
+	fwrite(&entry, sizeof(entry), 1, captureIndexFile);
+	captureOffset += sizeof(record) + size;
+}
 
-		switch (p->type) {
-		case capturyHello:
-			handshakeFinished = true;
+// returns the number of bytes received, 0 if nothing arrived or -1 if the connection was closed or broke
+int RemoteCaptury::receive(SOCKET& sok)
+{
+	// need at least the header or the rest of the packet that is currently arriving
+	int needed = sizeof(CapturyRequestPacket);
+	if (tcpReader.end - tcpReader.begin >= (int)sizeof(CapturyRequestPacket))
+		needed = ((CapturyRequestPacket*)&tcpReader.buffer[tcpReader.begin])->size;
+	const int space = tcpReader.makeRoom(needed);
+
+	// blocks until data arrives unless the socket is non-blocking. disconnect() shuts down the socket to wake us up.
+	int size = recv(sok, &tcpReader.buffer[tcpReader.end], space, 0);
+	if (size == 0) { // the other end shut down the socket...
+		if (stopReceiving) // ...or we did
+			return -1;
+		log("socket shut down by other end %s\n", sockstrerror());
+		closesocket(sok);
+		sok = (SOCKET)-1;
+		tcpReader.reset();
+		return -1;
+	}
+	if (size == -1) { // error
+		int err = sockerror();
+		if (isSocketErrorTryAgain(err))
+			return 0;
+		log("socket error %s\n", sockstrerror(err));
+		if (isSocketErrorFatal(err)) {
+			closesocket(sok);
+			sok = (SOCKET)-1;
+			tcpReader.reset();
+		}
+		return -1;
+	}
+	tcpReader.end += size;
+
+	packetReceivedNs = getMonotonicNanoseconds();
+	packetReceivedTime = getTime();
+	while (tcpReader.end - tcpReader.begin >= (int)sizeof(CapturyRequestPacket)) {
+		char* data = &tcpReader.buffer[tcpReader.begin];
+		const int packetSize = ((CapturyRequestPacket*)data)->size;
+		if (packetSize < (int)sizeof(CapturyRequestPacket) || packetSize > 10000000) {
+			log("invalid packet size: %d. closing connection.", packetSize);
+			closesocket(sok);
+			sok = (SOCKET)-1;
+			tcpReader.reset();
+			return -1;
+		}
+		if (tcpReader.end - tcpReader.begin < packetSize)
 			break;
-		case capturyActors: {
-			CapturyActorsPacket* cap = (CapturyActorsPacket*)p;
-			log("expecting %d actor packets\n", cap->numActors);
-			// if (expect == capturyActors) {
-			// 	if (cap->numActors != 0) {
-			// 		packetsMissing = cap->numActors;
-			// 		expect = capturyActor;
-			// 	}
-			// }
-			// numRetries += packetsMissing;
-			break; }
-		case capturyCameras: {
-			CapturyCamerasPacket* ccp = (CapturyCamerasPacket*)p;
-			numCameras = ccp->numCameras;
-			// if (expect == capturyCameras) {
-			// 	packetsMissing = numCameras;
-			// 	expect = capturyCamera;
-			// }
-			// numRetries += packetsMissing;
-			break; }
-		case capturyActor:
-		case capturyActor2:
-		case capturyActor3: {
-			CapturyActor_p actor(new CapturyActor);
-			CapturyActorPacket* cap = (CapturyActorPacket*)p;
-			strncpy(actor->name, cap->name, sizeof(actor->name));
-			actor->id = cap->id;
-			actor->numJoints = cap->numJoints;
-			actor->joints = new CapturyJoint[actor->numJoints];
-			char* at = (char*)cap->joints;
-			char* end = &buffer[size];
-			int version = (p->type == capturyActor) ? 1 : (p->type == capturyActor2) ? 2 : 3;
-
-			int numTransmittedJoints = 0;
-			for (int j = 0; at < end; ++j) {
-				switch (version) {
-				case 1: {
-					CapturyJointPacket* jp = (CapturyJointPacket*)at;
-					actor->joints[j].parent = jp->parent;
-					for (int x = 0; x < 3; ++x) {
-						actor->joints[j].offset[x] = jp->offset[x];
-						actor->joints[j].orientation[x] = jp->orientation[x];
-						actor->joints[j].scale[x] = 1.0f;
-					}
-					strncpy(actor->joints[j].name, jp->name, sizeof(actor->joints[j].name));
-					at += sizeof(CapturyJointPacket);
-					break; }
-				case 2: {
-					CapturyJointPacket2* jp = (CapturyJointPacket2*)at;
-					actor->joints[j].parent = jp->parent;
-					for (int x = 0; x < 3; ++x) {
-						actor->joints[j].offset[x] = jp->offset[x];
-						actor->joints[j].orientation[x] = jp->orientation[x];
-						actor->joints[j].scale[x] = 1.0f;
-					}
-					strncpy(actor->joints[j].name, jp->name, sizeof(actor->joints[j].name)-1);
-					at += sizeof(CapturyJointPacket2) + strlen(jp->name) + 1;
-					break; }
-				case 3: {
-					CapturyJointPacket3* jp = (CapturyJointPacket3*)at;
-					actor->joints[j].parent = jp->parent;
-					for (int x = 0; x < 3; ++x) {
-						actor->joints[j].offset[x] = jp->offset[x];
-						actor->joints[j].orientation[x] = jp->orientation[x];
-						actor->joints[j].scale[x] = jp->scale[x];
-					}
-					strncpy(actor->joints[j].name, jp->name, sizeof(actor->joints[j].name)-1);
-					at += sizeof(CapturyJointPacket3) + strlen(jp->name) + 1;
-					break; }
-				}
-				numTransmittedJoints = j + 1;
-			}
-			actor->numBlendShapes = 0;
-			actor->numMetaData = 0;
-			/*int numTransmittedJoints = std::min<int>((cap->size - sizeof(CapturyActorPacket)) / sizeof(CapturyJointPacket), actor->numJoints);
-			for (int j = 0; j < numTransmittedJoints; ++j) {
-				strcpy(actor->joints[j].name, cap->joints[j].name);
-				actor->joints[j].parent = cap->joints[j].parent;
-				for (int x = 0; x < 3; ++x) {
-					actor->joints[j].offset[x] = cap->joints[j].offset[x];
-					actor->joints[j].orientation[x] = cap->joints[j].orientation[x];
-				}
-			}*/
-			for (int j = numTransmittedJoints; j < actor->numJoints; ++j) { // initialize to default values
-				strncpy(actor->joints[j].name, "uninitialized", sizeof(actor->joints[j].name));
-				actor->joints[j].parent = 0;
-				for (int x = 0; x < 3; ++x) {
-					actor->joints[j].offset[x] = 0;
-					actor->joints[j].orientation[x] = 0;
-				}
-			}
-			if (numTransmittedJoints < actor->numJoints) {
-				// expect = (version == 1) ? capturyActorContinued : (version == 2) ? capturyActorContinued2 : capturyActorContinued3;
-				// numRetries += 1;
-			}
-			log("received actor %x (%d/%d)\n", actor->id, numTransmittedJoints, actor->numJoints);
-			p->type = capturyActor;
-			if (numTransmittedJoints == actor->numJoints) {
-				//log("received fulll actor %d\n", actor->id);
-				std::unique_lock<std::mutex> mainLock(mainMutex);
-				actorsById[actor->id] = actor;
-				CapturyActorStatus status = actorData[actor->id].status;
-				mainLock.unlock();
-				if (actorChangedCallback)
-					actorChangedCallback(this, actor->id, status, actorChangedArg);
-			} else {
-				std::lock_guard<std::mutex> partialActorLock(partialActorMutex);
-				partialActors[actor->id] = actor;
-			}
-			break; }
-		case capturyActorContinued:
-		case capturyActorContinued2:
-		case capturyActorContinued3: {
-			int version = (p->type == capturyActor) ? 1 : (p->type == capturyActor2) ? 2 : 3;
-			CapturyActorContinuedPacket* cacp = (CapturyActorContinuedPacket*)p;
-			std::unique_lock<std::mutex> partialActorLock(partialActorMutex);
-			if (partialActors.count(cacp->id) == 0) {
-				break;
-			}
 
-			CapturyActor_p actor = partialActors[cacp->id];
-			partialActorLock.unlock();
+		tcpReader.begin += packetSize;
+		capturePacket(captureChannelTcp, data, packetSize);
+		receivedTcpPacket(data, packetSize);
+	}
+
+	return size;
+}
+
+// handles a single packet received on the TCP socket (or replayed from a capture)
+void RemoteCaptury::receivedTcpPacket(char* data, int size)
+{
+	CapturyRequestPacket* p = (CapturyRequestPacket*)data;
+
+	// log("received packet size %d type %d (expected %d)\n", size, p->type, expect);
 
-			int j = cacp->startJoint;
+	switch (p->type) {
+	case capturyHello:
+		handshakeFinished = true;
+		// Captury Live sends the framerate before the hello. older versions may not so ask once.
+		if (framerate == unknownFramerate && !replaying) {
+			CapturyRequestPacket req;
+			req.type = capturyGetFramerate;
+			req.size = sizeof(req);
+			sendPacket(&req, capturyFramerate);
+		}
+		break;
+	case capturyActors: {
+		CapturyActorsPacket* cap = (CapturyActorsPacket*)p;
+		log("expecting %d actor packets\n", cap->numActors);
+		// if (expect == capturyActors) {
+		// 	if (cap->numActors != 0) {
+		// 		packetsMissing = cap->numActors;
+		// 		expect = capturyActor;
+		// 	}
+		// }
+		// numRetries += packetsMissing;
+		break; }
+	case capturyCameras: {
+		CapturyCamerasPacket* ccp = (CapturyCamerasPacket*)p;
+		numCameras = ccp->numCameras;
+		// if (expect == capturyCameras) {
+		// 	packetsMissing = numCameras;
+		// 	expect = capturyCamera;
+		// }
+		// numRetries += packetsMissing;
+		break; }
+	case capturyActor:
+	case capturyActor2:
+	case capturyActor3: {
+		CapturyActor_p actor(new CapturyActor);
+		CapturyActorPacket* cap = (CapturyActorPacket*)p;
+		strncpy(actor->name, cap->name, sizeof(actor->name));
+		actor->id = cap->id;
+		actor->numJoints = cap->numJoints;
+		actor->joints = new CapturyJoint[actor->numJoints];
+		char* at = (char*)cap->joints;
+		char* end = &data[size];
+		int version = (p->type == capturyActor) ? 1 : (p->type == capturyActor2) ? 2 : 3;
+
+		int numTransmittedJoints = 0;
+		for (int j = 0; at < end; ++j) {
 			switch (version) {
 			case 1: {
-				CapturyJointPacket* end = (CapturyJointPacket*)&buffer[size];
-				for (int k = 0; j < actor->numJoints && &cacp->joints[k] < end; ++j, ++k) {
-					strncpy(actor->joints[j].name, cacp->joints[k].name, sizeof(actor->joints[j].name)-1);
-					actor->joints[j].parent = cacp->joints[k].parent;
-					for (int x = 0; x < 3; ++x) {
-						actor->joints[j].offset[x] = cacp->joints[k].offset[x];
-						actor->joints[j].orientation[x] = cacp->joints[k].orientation[x];
-						actor->joints[j].scale[x] = 1.0f;
-					}
-					actor->joints[j].boneType = CAPTURY_UNKNOWN_BONE;
+				CapturyJointPacket* jp = (CapturyJointPacket*)at;
+				actor->joints[j].parent = jp->parent;
+				for (int x = 0; x < 3; ++x) {
+					actor->joints[j].offset[x] = jp->offset[x];
+					actor->joints[j].orientation[x] = jp->orientation[x];
+					actor->joints[j].scale[x] = 1.0f;
 				}
+				strncpy(actor->joints[j].name, jp->name, sizeof(actor->joints[j].name));
+				at += sizeof(CapturyJointPacket);
 				break; }
 			case 2: {
-				char* at = (char*)cacp->joints;
-				char* end = (char*)&buffer[size];
-				for ( ; j < actor->numJoints && at < end; ++j) {
-					CapturyJointPacket2* jp = (CapturyJointPacket2*)at;
-					actor->joints[j].parent = jp->parent;
-					for (int x = 0; x < 3; ++x) {
-						actor->joints[j].offset[x] = jp->offset[x];
-						actor->joints[j].orientation[x] = jp->orientation[x];
-						actor->joints[j].scale[x] = 1.0f;
-					}
-					actor->joints[j].boneType = CAPTURY_UNKNOWN_BONE;
-					strncpy(actor->joints[j].name, jp->name, sizeof(actor->joints[j].name)-1);
-					at += sizeof(CapturyJointPacket2) + strlen(jp->name) + 1;
+				CapturyJointPacket2* jp = (CapturyJointPacket2*)at;
+				actor->joints[j].parent = jp->parent;
+				for (int x = 0; x < 3; ++x) {
+					actor->joints[j].offset[x] = jp->offset[x];
+					actor->joints[j].orientation[x] = jp->orientation[x];
+					actor->joints[j].scale[x] = 1.0f;
 				}
+				strncpy(actor->joints[j].name, jp->name, sizeof(actor->joints[j].name)-1);
+				at += sizeof(CapturyJointPacket2) + strlen(jp->name) + 1;
 				break; }
 			case 3: {
-				char* at = (char*)cacp->joints;
-				char* end = (char*)&buffer[size];
-				for ( ; j < actor->numJoints && at < end; ++j) {
-					CapturyJointPacket3* jp = (CapturyJointPacket3*)at;
-					actor->joints[j].parent = jp->parent;
-					for (int x = 0; x < 3; ++x) {
-						actor->joints[j].offset[x] = jp->offset[x];
-						actor->joints[j].orientation[x] = jp->orientation[x];
-						actor->joints[j].scale[x] = jp->scale[x];
-					}
-					actor->joints[j].boneType = CAPTURY_UNKNOWN_BONE;
-					strncpy(actor->joints[j].name, jp->name, sizeof(actor->joints[j].name)-1);
-					at += sizeof(CapturyJointPacket3) + strlen(jp->name) + 1;
+				CapturyJointPacket3* jp = (CapturyJointPacket3*)at;
+				actor->joints[j].parent = jp->parent;
+				for (int x = 0; x < 3; ++x) {
+					actor->joints[j].offset[x] = jp->offset[x];
+					actor->joints[j].orientation[x] = jp->orientation[x];
+					actor->joints[j].scale[x] = jp->scale[x];
 				}
+				strncpy(actor->joints[j].name, jp->name, sizeof(actor->joints[j].name)-1);
+				at += sizeof(CapturyJointPacket3) + strlen(jp->name) + 1;
 				break; }
 			}
-			if (j == actor->numJoints) {
-				// log("received fulll actor %d\n", actor->id);
-				std::unique_lock<std::mutex> mainLock(mainMutex);
-				actorsById[actor->id] = actor;
-				CapturyActorStatus status = actorData[actor->id].status;
-				if (actorChangedCallback)
-				{
-					mainLock.unlock();
-					actorChangedCallback(this, actor->id, status, actorChangedArg);
-					mainLock.lock();
+			numTransmittedJoints = j + 1;
+		}
+		actor->numBlendShapes = 0;
+		actor->numMetaData = 0;
+		/*int numTransmittedJoints = std::min<int>((cap->size - sizeof(CapturyActorPacket)) / sizeof(CapturyJointPacket), actor->numJoints);
+		for (int j = 0; j < numTransmittedJoints; ++j) {
+			strcpy(actor->joints[j].name, cap->joints[j].name);
+			actor->joints[j].parent = cap->joints[j].parent;
+			for (int x = 0; x < 3; ++x) {
+				actor->joints[j].offset[x] = cap->joints[j].offset[x];
+				actor->joints[j].orientation[x] = cap->joints[j].orientation[x];
+			}
+		}*/
+		for (int j = numTransmittedJoints; j < actor->numJoints; ++j) { // initialize to default values
+			strncpy(actor->joints[j].name, "uninitialized", sizeof(actor->joints[j].name));
+			actor->joints[j].parent = 0;
+			for (int x = 0; x < 3; ++x) {
+				actor->joints[j].offset[x] = 0;
+				actor->joints[j].orientation[x] = 0;
+			}
+		}
+		if (numTransmittedJoints < actor->numJoints) {
+			// expect = (version == 1) ? capturyActorContinued : (version == 2) ? capturyActorContinued2 : capturyActorContinued3;
+			// numRetries += 1;
+		}
+		log("received actor %x (%d/%d)\n", actor->id, numTransmittedJoints, actor->numJoints);
+		p->type = capturyActor;
+		if (numTransmittedJoints == actor->numJoints) {
+			//log("received fulll actor %d\n", actor->id);
+			std::unique_lock<std::mutex> mainLock(mainMutex);
+			ActorSlot& slot = actors.findOrAdd(actor->id);
+			slot.actor = actor;
+			CapturyActorStatus status = slot.data.status;
+			actorChanges.recordDefinition(actor->id, status);
+			mainLock.unlock();
+			if (actorChangedCallback)
+				actorChangedCallback(this, actor->id, status, actorChangedArg);
+		} else {
+			std::lock_guard<std::mutex> partialActorLock(partialActorMutex);
+			partialActors[actor->id] = actor;
+		}
+		break; }
+	case capturyActorContinued:
+	case capturyActorContinued2:
+	case capturyActorContinued3: {
+		int version = (p->type == capturyActor) ? 1 : (p->type == capturyActor2) ? 2 : 3;
+		CapturyActorContinuedPacket* cacp = (CapturyActorContinuedPacket*)p;
+		std::unique_lock<std::mutex> partialActorLock(partialActorMutex);
+		if (partialActors.count(cacp->id) == 0) {
+			break;
+		}
+
+		CapturyActor_p actor = partialActors[cacp->id];
+		partialActorLock.unlock();
+
+		int j = cacp->startJoint;
+		switch (version) {
+		case 1: {
+			CapturyJointPacket* end = (CapturyJointPacket*)&data[size];
+			for (int k = 0; j < actor->numJoints && &cacp->joints[k] < end; ++j, ++k) {
+				strncpy(actor->joints[j].name, cacp->joints[k].name, sizeof(actor->joints[j].name)-1);
+				actor->joints[j].parent = cacp->joints[k].parent;
+				for (int x = 0; x < 3; ++x) {
+					actor->joints[j].offset[x] = cacp->joints[k].offset[x];
+					actor->joints[j].orientation[x] = cacp->joints[k].orientation[x];
+					actor->joints[j].scale[x] = 1.0f;
 				}
-				partialActors.erase(actor->id);
-			} else {
-				// expect is already set correctly
-				// numRetries += 1;
-				// packetsMissing += 1;
+				actor->joints[j].boneType = CAPTURY_UNKNOWN_BONE;
 			}
-			log("received actor cont %d (%d/%d)\n", actor->id, j, actor->numJoints);
 			break; }
-		case capturyActorBlendShapes: {
-			CapturyActorBlendShapesPacket* cabs = (CapturyActorBlendShapesPacket*)p;
-			std::lock_guard<std::mutex> mainLock(mainMutex);
-			CapturyActor_p actor = actorsById[cabs->actorId];
-			actor->numBlendShapes = cabs->numBlendShapes;
-			actor->blendShapes = new CapturyBlendShape[actor->numBlendShapes];
-			char* at = cabs->blendShapeNames;
-			for (int i = 0; i < actor->numBlendShapes; ++i) {
-				strncpy(actor->blendShapes[i].name, at, 63);
-				actor->blendShapes[i].name[63] = '\0';
-				at += std::min<int>((int)strlen(actor->blendShapes[i].name) + 1, 64);
+		case 2: {
+			char* at = (char*)cacp->joints;
+			char* end = (char*)&data[size];
+			for ( ; j < actor->numJoints && at < end; ++j) {
+				CapturyJointPacket2* jp = (CapturyJointPacket2*)at;
+				actor->joints[j].parent = jp->parent;
+				for (int x = 0; x < 3; ++x) {
+					actor->joints[j].offset[x] = jp->offset[x];
+					actor->joints[j].orientation[x] = jp->orientation[x];
+					actor->joints[j].scale[x] = 1.0f;
+				}
+				actor->joints[j].boneType = CAPTURY_UNKNOWN_BONE;
+				strncpy(actor->joints[j].name, jp->name, sizeof(actor->joints[j].name)-1);
+				at += sizeof(CapturyJointPacket2) + strlen(jp->name) + 1;
 			}
 			break; }
-		case capturyActorMetaData: {
-			CapturyActorMetaDataPacket* cmd = (CapturyActorMetaDataPacket*)p;
-			std::lock_guard<std::mutex> mainLock(mainMutex);
-			CapturyActor_p actor = actorsById[cmd->actorId];
-			actor->numMetaData = cmd->numEntries;
-			actor->metaDataKeys = new char*[actor->numMetaData];
-			actor->metaDataValues = new char*[actor->numMetaData];
-			char* at = cmd->metaData;
-			for (int i = 0; i < actor->numMetaData; ++i) { // from a memory allocation perspective this is pretty inefficient
-				actor->metaDataKeys[i] = strdup(at);
-				at += strlen(actor->metaDataKeys[i]) + 1;
-				actor->metaDataValues[i] = strdup(at);
-				at += strlen(actor->metaDataValues[i]) + 1;
+		case 3: {
+			char* at = (char*)cacp->joints;
+			char* end = (char*)&data[size];
+			for ( ; j < actor->numJoints && at < end; ++j) {
+				CapturyJointPacket3* jp = (CapturyJointPacket3*)at;
+				actor->joints[j].parent = jp->parent;
+				for (int x = 0; x < 3; ++x) {
+					actor->joints[j].offset[x] = jp->offset[x];
+					actor->joints[j].orientation[x] = jp->orientation[x];
+					actor->joints[j].scale[x] = jp->scale[x];
+				}
+				actor->joints[j].boneType = CAPTURY_UNKNOWN_BONE;
+				strncpy(actor->joints[j].name, jp->name, sizeof(actor->joints[j].name)-1);
+				at += sizeof(CapturyJointPacket3) + strlen(jp->name) + 1;
 			}
 			break; }
-		case capturyBoneTypes: {
-			CapturyBoneTypePacket* cbt = (CapturyBoneTypePacket*)p;
-			std::lock_guard<std::mutex> mainLock(mainMutex);
-			CapturyActor_p actor = actorsById[cbt->actorId];
-			for (int i = 0; i < std::min<int>(actor->numJoints, size - sizeof(CapturyBoneTypePacket)); ++i)
-				actor->joints[i].boneType = cbt->boneTypes[i];
-			break; }
-		case capturyCamera: {
-			CapturyCamera camera;
-			CapturyCameraPacket* ccp = (CapturyCameraPacket*)p;
-			strncpy(camera.name, ccp->name, sizeof(camera.name));
-			camera.id = ccp->id;
-			for (int x = 0; x < 3; ++x) {
-				camera.position[x] = ccp->position[x];
-				camera.orientation[x] = ccp->orientation[x];
+		}
+		if (j == actor->numJoints) {
+			// log("received fulll actor %d\n", actor->id);
+			std::unique_lock<std::mutex> mainLock(mainMutex);
+			ActorSlot& slot = actors.findOrAdd(actor->id);
+			slot.actor = actor;
+			CapturyActorStatus status = slot.data.status;
+			actorChanges.recordDefinition(actor->id, status);
+			if (actorChangedCallback)
+			{
+				mainLock.unlock();
+				actorChangedCallback(this, actor->id, status, actorChangedArg);
+				mainLock.lock();
 			}
-			camera.sensorSize[0] = ccp->sensorSize[0];
-			camera.sensorSize[1] = ccp->sensorSize[1];
-			camera.focalLength = ccp->focalLength;
-			camera.lensCenter[0] = ccp->lensCenter[0];
-			camera.lensCenter[1] = ccp->lensCenter[1];
-			strncpy(camera.distortionModel, "none", sizeof(camera.distortionModel));
-			memset(&camera.distortion[0], 0, sizeof(camera.distortion));
-
-			// TODO compute extrinsic and intrinsic matrix
-
-			std::lock_guard<std::mutex> mainLock(mainMutex);
-			cameras.push_back(camera);
-			break; }
-		case capturyPose:
-		case capturyPose2:
-		case capturyCompressedPose:
-		case capturyCompressedPose2:
-			receivedPosePacket((CapturyPosePacket*)buffer.data());
+			partialActors.erase(actor->id);
+		} else {
+			// expect is already set correctly
+			// numRetries += 1;
+			// packetsMissing += 1;
+		}
+		log("received actor cont %d (%d/%d)\n", actor->id, j, actor->numJoints);
+		break; }
+	case capturyActorBlendShapes: {
+		CapturyActorBlendShapesPacket* cabs = (CapturyActorBlendShapesPacket*)p;
+		std::lock_guard<std::mutex> mainLock(mainMutex);
+		ActorSlot* slot = actors.find(cabs->actorId);
+		if (slot == nullptr || !slot->actor)
 			break;
-		case capturyDaySessionShot: {
-			CapturyDaySessionShotPacket* dss = (CapturyDaySessionShotPacket*)p;
-			currentDay = dss->day;
-			currentSession = dss->session;
-			currentShot = dss->shot;
-			break; }
-		case capturyTime2: {
-			CapturyTimePacket2* tp = (CapturyTimePacket2*)p;
-			if (tp->timeId != nextTimeId) {
-				log("time id doesn't match, expected %d got %d", nextTimeId, tp->timeId);
-				p->type = capturyError;
-				break;
-			}
-			} // fall through
-		case capturyTime: {
-			CapturyTimePacket* tp = (CapturyTimePacket*)p;
-			uint64_t pongTime = getTime();
-			// we assume that the network transfer time is symmetric
-			// so the timestamp given in the packet was captured at (pingTime + pongTime) / 2
-			uint64_t t = (pongTime - pingTime) / 2 + pingTime;
-			syncSamples.emplace_back(t, tp->timestamp, (uint32_t)(pongTime - pingTime));
-			if (syncSamples.size() > 50)
-				syncSamples.erase(syncSamples.begin());
-			updateSync(t);
-			log("local: %" PRIu64 " remote: %" PRIu64 " => offset %" PRId64 ", roundtrip %" PRId64 "\n", t, tp->timestamp, tp->timestamp - t, pongTime - pingTime);
-			break; }
-		case capturyFramerate: {
-			CapturyFrameratePacket* fp = (CapturyFrameratePacket*)p;
-			framerateNumerator = fp->numerator;
-			framerateDenominator = fp->denominator;
-			break; }
-		case capturyEnableRemoteLogging:
-			doRemoteLogging = true;
+		CapturyActor_p actor = slot->actor;
+		actor->numBlendShapes = cabs->numBlendShapes;
+		actor->blendShapes = new CapturyBlendShape[actor->numBlendShapes];
+		char* at = cabs->blendShapeNames;
+		for (int i = 0; i < actor->numBlendShapes; ++i) {
+			strncpy(actor->blendShapes[i].name, at, 63);
+			actor->blendShapes[i].name[63] = '\0';
+			at += std::min<int>((int)strlen(actor->blendShapes[i].name) + 1, 64);
+		}
+		break; }
+	case capturyActorMetaData: {
+		CapturyActorMetaDataPacket* cmd = (CapturyActorMetaDataPacket*)p;
+		std::lock_guard<std::mutex> mainLock(mainMutex);
+		ActorSlot* slot = actors.find(cmd->actorId);
+		if (slot == nullptr || !slot->actor)
 			break;
-		case capturyDisableRemoteLogging:
-			doRemoteLogging = false;
+		CapturyActor_p actor = slot->actor;
+		actor->numMetaData = cmd->numEntries;
+		actor->metaDataKeys = new char*[actor->numMetaData];
+		actor->metaDataValues = new char*[actor->numMetaData];
+		char* at = cmd->metaData;
+		for (int i = 0; i < actor->numMetaData; ++i) { // from a memory allocation perspective this is pretty inefficient
+			actor->metaDataKeys[i] = strdup(at);
+			at += strlen(actor->metaDataKeys[i]) + 1;
+			actor->metaDataValues[i] = strdup(at);
+			at += strlen(actor->metaDataValues[i]) + 1;
+		}
+		break; }
+	case capturyBoneTypes: {
+		CapturyBoneTypePacket* cbt = (CapturyBoneTypePacket*)p;
+		std::lock_guard<std::mutex> mainLock(mainMutex);
+		ActorSlot* slot = actors.find(cbt->actorId);
+		if (slot == nullptr || !slot->actor)
 			break;
-		case capturyImageHeader: {
-			CapturyImageHeaderPacket* tp = (CapturyImageHeaderPacket*)p;
-
-			// update the image structures
-			std::unique_lock<std::mutex> mainLock(mainMutex);
-			if (actorData.count(tp->actor) > 0) {
-				free(actorData[tp->actor].currentTextures.data);
-				actorData[tp->actor].currentTextures.data = NULL;
-			}
-			actorData[tp->actor].currentTextures.camera = -1;
-			actorData[tp->actor].currentTextures.width = tp->width;
-			actorData[tp->actor].currentTextures.height = tp->height;
-			actorData[tp->actor].currentTextures.timestamp = 0;
+		CapturyActor_p actor = slot->actor;
+		for (int i = 0; i < std::min<int>(actor->numJoints, size - sizeof(CapturyBoneTypePacket)); ++i)
+			actor->joints[i].boneType = cbt->boneTypes[i];
+		break; }
+	case capturyCamera: {
+		CapturyCamera camera;
+		CapturyCameraPacket* ccp = (CapturyCameraPacket*)p;
+		strncpy(camera.name, ccp->name, sizeof(camera.name));
+		camera.id = ccp->id;
+		for (int x = 0; x < 3; ++x) {
+			camera.position[x] = ccp->position[x];
+			camera.orientation[x] = ccp->orientation[x];
+		}
+		camera.sensorSize[0] = ccp->sensorSize[0];
+		camera.sensorSize[1] = ccp->sensorSize[1];
+		camera.focalLength = ccp->focalLength;
+		camera.lensCenter[0] = ccp->lensCenter[0];
+		camera.lensCenter[1] = ccp->lensCenter[1];
+		strncpy(camera.distortionModel, "none", sizeof(camera.distortionModel));
+		memset(&camera.distortion[0], 0, sizeof(camera.distortion));
+
+		// TODO compute extrinsic and intrinsic matrix
+
+		std::lock_guard<std::mutex> mainLock(mainMutex);
+		cameras.push_back(camera);
+		break; }
+	case capturyPose:
+	case capturyPose2:
+	case capturyCompressedPose:
+	case capturyCompressedPose2:
+		receivedPosePacket((CapturyPosePacket*)data);
+		break;
+	case capturyDaySessionShot: {
+		CapturyDaySessionShotPacket* dss = (CapturyDaySessionShotPacket*)p;
+		currentDay = dss->day;
+		currentSession = dss->session;
+		currentShot = dss->shot;
+		break; }
+	case capturyTime2: {
+		// replayed replies belong to requests of the recorded session, not to pingTime and nextTimeId
+		if (replaying)
+			break;
+		CapturyTimePacket2* tp = (CapturyTimePacket2*)p;
+		if (tp->timeId != nextTimeId) {
+			log("time id doesn't match, expected %d got %d\n", nextTimeId.load(), tp->timeId);
+			p->type = capturyError;
+			break;
+		}
+		} // fall through
+	case capturyTime: {
+		if (replaying)
+			break;
+		CapturyTimePacket* tp = (CapturyTimePacket*)p;
+		const uint64_t ping = pingTime;
+		// when the reply was read from the socket rather than when we got around to handling it
+		uint64_t pongTime = packetReceivedTime;
+		if (pongTime < ping)
+			pongTime = getTime();
+		// we assume that the network transfer time is symmetric
+		// so the timestamp given in the packet was captured at (pingTime + pongTime) / 2
+		uint64_t t = (pongTime - ping) / 2 + ping;
+		addSyncSample(SyncSample(t, tp->timestamp, (uint32_t)(pongTime - ping)));
+		log("local: %" PRIu64 " remote: %" PRIu64 " => offset %" PRId64 ", roundtrip %" PRId64 "\n", t, tp->timestamp, tp->timestamp - t, pongTime - ping);
+		break; }
+	case capturyFramerate: {
+		CapturyFrameratePacket* fp = (CapturyFrameratePacket*)p;
+		const uint64_t rate = ((uint64_t)(uint32_t)fp->numerator << 32) | (uint32_t)fp->denominator;
+		if (framerate.exchange(rate) != rate) {
+			log("framerate %d/%d\n", fp->numerator, fp->denominator);
+			if (framerateChangedCallback != NULL)
+				framerateChangedCallback(this, fp->numerator, fp->denominator, framerateChangedArg);
+		}
+		break; }
+	case capturyEnableRemoteLogging:
+		doRemoteLogging = true;
+		break;
+	case capturyDisableRemoteLogging:
+		doRemoteLogging = false;
+		break;
+	case capturyImageHeader: {
+		CapturyImageHeaderPacket* tp = (CapturyImageHeaderPacket*)p;
+
+		// update the image structures
+		std::unique_lock<std::mutex> mainLock(mainMutex);
+		ActorData& aData = actors.findOrAdd(tp->actor).data;
+		free(aData.currentTextures.data);
+		aData.currentTextures.data = NULL;
+		aData.currentTextures.camera = -1;
+		aData.currentTextures.width = tp->width;
+		aData.currentTextures.height = tp->height;
+		aData.currentTextures.timestamp = 0;
 //			log("got image header %dx%d for actor %x\n", currentTextures[tp->actor].width, currentTextures[tp->actor].height, tp->actor);
-			actorData[tp->actor].currentTextures.data = (unsigned char*)malloc(tp->width*tp->height*3);
-			actorData[tp->actor].receivedPackets = std::vector<int>( ((tp->width*tp->height*3 + tp->dataPacketSize-16-1) / (tp->dataPacketSize-16)), 0);
-			mainLock.unlock();
+		aData.currentTextures.data = (unsigned char*)malloc(tp->width*tp->height*3);
+		aData.receivedPackets = std::vector<int>( ((tp->width*tp->height*3 + tp->dataPacketSize-16-1) / (tp->dataPacketSize-16)), 0);
+		mainLock.unlock();
 
-			// and request the data to go with it
-			if (sock == -1 || streamSocketPort == 0)
-				break;
+		// and request the data to go with it
+		if (sock == -1 || streamSocketPort == 0)
+			break;
 
-			CapturyGetImageDataPacket packet;
-			packet.type = capturyGetImageData;
-			packet.size = sizeof(packet);
-			packet.actor = tp->actor;
-			packet.port = streamSocketPort;
+		CapturyGetImageDataPacket packet;
+		packet.type = capturyGetImageData;
+		packet.size = sizeof(packet);
+		packet.actor = tp->actor;
+		packet.port = streamSocketPort;
 //			log("requesting image to port %d\n", ntohs(packet.port));
 
-			if (send(sock, (const char*)&packet, packet.size, 0) != packet.size)
-				break;
-
-			break; }
-		case capturyMarkerTransform: {
-			CapturyMarkerTransformPacket* cmt = (CapturyMarkerTransformPacket*)p;
-			ActorAndJoint aj(cmt->actor, cmt->joint);
-			MarkerTransform& mt = markerTransforms[aj];
-			mt.timestamp = cmt->timestamp;
-			mt.trafo.translation[0] = cmt->translation[0];
-			mt.trafo.translation[1] = cmt->translation[1];
-			mt.trafo.translation[2] = cmt->translation[2];
-			mt.trafo.rotation[0] = cmt->rotation[0];
-			mt.trafo.rotation[1] = cmt->rotation[1];
-			mt.trafo.rotation[2] = cmt->rotation[2];
-			break; }
-		case capturyScalingProgress: {
-			CapturyScalingProgressPacket* spp = (CapturyScalingProgressPacket*)p;
-			std::lock_guard<std::mutex> mainLock(mainMutex);
-			if (actorData.count(spp->actor))
-				actorData[spp->actor].scalingProgress = spp->progress;
-			break; }
-		case capturyBackgroundQuality: {
-			CapturyBackgroundQualityPacket* bqp = (CapturyBackgroundQualityPacket*)p;
-			backgroundQuality = bqp->quality;
-			break; }
-		case capturyStatus: {
-			CapturyStatusPacket* sp = (CapturyStatusPacket*)p;
-			lastStatusMessage = sp->message; // FIXME this is unsafe. assumes that message is 0 terminated.
-			break; }
-		case capturyStartRecordingAck2: {
-			CapturyTimePacket* srp = (CapturyTimePacket*)p;
-			startRecordingTime = srp->timestamp;
-			break; }
-		case capturyActorModeChanged: {
-			CapturyActorModeChangedPacket* amc = (CapturyActorModeChangedPacket*)p;
-			if (actorChangedCallback != NULL)
-				actorChangedCallback(this, amc->actor, amc->mode, actorChangedArg);
-			std::lock_guard<std::mutex> mainLock(mainMutex);
-			if (actorData.count(amc->actor))
-				actorData[amc->actor].status = (CapturyActorStatus)amc->mode;
-			break; }
-		case capturyStreamAck:
-		case capturySetShotAck:
-		case capturyStartRecordingAck:
-		case capturyStopRecordingAck:
-		case capturyCustomAck:
-			break; // all good
-		default:
-			log("unrecognized packet: %d bytes, type %d, size %d", size, p->type, p->size);
+		if (send(sock, (const char*)&packet, packet.size, 0) != packet.size)
 			break;
-		}
-
-		// if (p->type == expect) {
-		// 	--packetsMissing;
 
-		// 	if (packetsMissing == 0)
-		// 		break;
-		// }
+		break; }
+	case capturyMarkerTransform: {
+		CapturyMarkerTransformPacket* cmt = (CapturyMarkerTransformPacket*)p;
+		ActorAndJoint aj(cmt->actor, cmt->joint);
+		MarkerTransform& mt = markerTransforms[aj];
+		mt.timestamp = cmt->timestamp;
+		mt.trafo.translation[0] = cmt->translation[0];
+		mt.trafo.translation[1] = cmt->translation[1];
+		mt.trafo.translation[2] = cmt->translation[2];
+		mt.trafo.rotation[0] = cmt->rotation[0];
+		mt.trafo.rotation[1] = cmt->rotation[1];
+		mt.trafo.rotation[2] = cmt->rotation[2];
+		break; }
+	case capturyScalingProgress: {
+		CapturyScalingProgressPacket* spp = (CapturyScalingProgressPacket*)p;
+		std::lock_guard<std::mutex> mainLock(mainMutex);
+		ActorSlot* slot = actors.find(spp->actor);
+		if (slot != nullptr)
+			slot->data.scalingProgress = spp->progress;
+		break; }
+	case capturyBackgroundQuality: {
+		CapturyBackgroundQualityPacket* bqp = (CapturyBackgroundQualityPacket*)p;
+		backgroundQuality = bqp->quality;
+		break; }
+	case capturyStatus: {
+		CapturyStatusPacket* sp = (CapturyStatusPacket*)p;
+		lastStatusMessage = sp->message; // FIXME this is unsafe. assumes that message is 0 terminated.
+		break; }
+	case capturyStartRecordingAck2: {
+		CapturyTimePacket* srp = (CapturyTimePacket*)p;
+		startRecordingTime = srp->timestamp;
+		break; }
+	case capturyActorModeChanged: {
+		CapturyActorModeChangedPacket* amc = (CapturyActorModeChangedPacket*)p;
+		if (actorChangedCallback != NULL)
+			actorChangedCallback(this, amc->actor, amc->mode, actorChangedArg);
+		std::lock_guard<std::mutex> mainLock(mainMutex);
+		actorModeChanged(amc->actor, amc->mode);
+		break; }
+	case capturyStreamAck:
+	case capturySetShotAck:
+	case capturyStartRecordingAck:
+	case capturyStopRecordingAck:
+	case capturyCustomAck:
+		break; // all good
+	default:
+		log("unrecognized packet: %d bytes, type %d, size %d", size, p->type, p->size);
+		break;
 	}
-
-	return true;
 }
 
 void RemoteCaptury::deleteActors()
 {
 	log("deleting all actors\n");
 	std::unique_lock<std::mutex> mainLock(mainMutex);
-	for (auto it : actorsById)
-		delete[] it.second->joints;
-	actorsById.clear();
-
 	std::vector<int> deletedActorIds;
-	std::unordered_map<int, ActorData>::iterator it;
-	for (it = actorData.begin(); it != actorData.end(); ++it) {
-		if (it->second.currentPose.numTransforms != 0) {
-			if (it->second.currentPose.numTransforms)
-				delete[] it->second.currentPose.transforms;
-			it->second.currentPose.numTransforms = 0; // should not be necessary but weird things do happen
-			if (it->second.currentPose.numBlendShapes)
-				delete[] it->second.currentPose.blendShapeActivations;
-			it->second.currentPose.numBlendShapes = 0; // should not be necessary but weird things do happen
-			it->second.currentPose.transforms = NULL;
-		}
-		if (it->second.currentTextures.data != NULL)
-			free(it->second.currentTextures.data);
+	for (ActorSlot& slot : actors) {
+		if (slot.actor)
+			delete[] slot.actor->joints;
+		if (slot.data.currentTextures.data != NULL)
+			free(slot.data.currentTextures.data);
 
 		if (actorChangedCallback)
-			deletedActorIds.push_back(it->first);
+			deletedActorIds.push_back(slot.id);
 	}
-	actorData.clear();
+	actors.clear();
+	liveness.clear();
+	actorChanges.recordAllDeleted();
+	clearPendingFrame();
 	mainLock.unlock();
 
+	{
+		std::lock_guard<std::mutex> frameLock(frameMutex);
+		frameMailbox.publish(nullptr);
+		frameArraysMailbox.publish(nullptr);
+	}
+
 	for (int id : deletedActorIds)
 		actorChangedCallback(this, id, ACTOR_DELETED, actorChangedArg);
 }
@@ -1534,7 +3457,7 @@ void RemoteCaptury::receiveLoop()
 	log("starting receive loop\n");
 	
 	while (!stopReceiving && (!handshaking || !handshakeFinished)) {
-		if (!receive(sock)) {
+		if (receive(sock) < 0) {
 			if (sock == -1) {
 				deleteActors();
 				cameras.clear();
@@ -1564,6 +3487,63 @@ void RemoteCaptury::receiveLoop()
 	log("stopping receive loop\n");
 }
 
+bool RemoteCaptury::replay(const char* filename, double speed)
+{
+	std::shared_ptr<PacketCaptureFile> capture = std::make_shared<PacketCaptureFile>();
+	if (!capture->open(filename)) {
+		lastErrorMessage = std::string("cannot read packet capture ") + filename;
+		return false;
+	}
+
+	if (sock != -1 || receiveThread.joinable())
+		disconnect();
+
+	handshakeFinished = false;
+	stopReceiving = 0;
+	replaying = true;
+	receiveThread = std::thread(&RemoteCaptury::replayLoop, this, capture, speed);
+
+	return true;
+}
+
+// feeds the captured packets through the same code that handles packets from the sockets
+void RemoteCaptury::replayLoop(std::shared_ptr<PacketCaptureFile> capture, double speed)
+{
+	log("replaying %d packets at %gx speed\n", (int)capture->numEntries, speed);
+
+	std::vector<char> buffer;
+	const uint64_t startTime = getTime();
+	const uint64_t firstReceiveTime = (capture->numEntries != 0) ? capture->entries[0].receiveTime : 0;
+	size_t i = 0;
+	for ( ; i < capture->numEntries && !stopReceiving; ++i) {
+		const CaptureIndexEntry& entry = capture->entries[i];
+		if (entry.offset + sizeof(CaptureRecord) > capture->records.size)
+			break;
+		const CaptureRecord* record = (const CaptureRecord*)(capture->records.data + entry.offset);
+		if (entry.offset + sizeof(CaptureRecord) + record->size > capture->records.size || record->size < sizeof(CapturyRequestPacket))
+			break;
+
+		if (speed > 0.0) {
+			const uint64_t due = startTime + (uint64_t)((entry.receiveTime - firstReceiveTime) / speed);
+			for (uint64_t now = getTime(); now < due && !stopReceiving; now = getTime())
+				sleepMicroSeconds(std::min<uint64_t>(due - now, 100000));
+		}
+
+		// the handlers may modify the packet so it cannot be passed from the read-only mapping
+		const char* payload = (const char*)(record + 1);
+		buffer.assign(payload, payload + record->size);
+		packetReceivedNs = getMonotonicNanoseconds();
+		packetReceivedTime = getTime();
+		if (record->channel == captureChannelStream)
+			receivedStreamPacket(buffer.data(), (int)record->size);
+		else
+			receivedTcpPacket(buffer.data(), (int)record->size);
+	}
+
+	log("replayed %d of %d packets\n", (int)i, (int)capture->numEntries);
+	replaying = false;
+}
+
 bool RemoteCaptury::sendPacket(CapturyRequestPacket* packet, CapturyPacketTypes expectedReplyType)
 {
 	if (send(sock, (const char*)packet, packet->size, 0) != packet->size)
@@ -1572,6 +3552,225 @@ bool RemoteCaptury::sendPacket(CapturyRequestPacket* packet, CapturyPacketTypes
 	return true;
 }
 
+// dispatches a single datagram received on the stream socket
+void RemoteCaptury::receivedStreamPacket(char* buffer, int size)
+{
+	capturePacket(captureChannelStream, buffer, size);
+
+	CapturyPosePacket* cpp = (CapturyPosePacket*)buffer;
+
+	if (cpp->type == capturyImageData) {
+		// received data for the image
+		CapturyImageDataPacket* cip = (CapturyImageDataPacket*)buffer;
+		//log("received image data for actor %x (payload %d bytes)\n", cip->actor, cip->size-16);
+
+		// check if we have a texture already
+		std::lock_guard<std::mutex> mainLock(mainMutex);
+		ActorSlot* slot = actors.find(cip->actor);
+		if (slot == nullptr) {
+			log("received image data for actor %x without having received image header\n", cip->actor);
+			return;
+		}
+
+		// copy data from packet into the buffer
+		const int imgSize = slot->data.currentTextures.width * slot->data.currentTextures.height * 3;
+
+		// check if packet fits
+		if (cip->offset >= imgSize || cip->offset + cip->size-16 > imgSize) {
+			log("received image data for actor %x (%d-%d) that is larger than header (%dx%d*3 = %d)\n", cip->actor, cip->offset, cip->offset+cip->size-16, slot->data.currentTextures.width, slot->data.currentTextures.height, imgSize);
+			return;
+		}
+
+		// mark paket as received
+		const int packetIndex = cip->offset / (cip->size-16);
+		slot->data.receivedPackets[packetIndex] = 1;
+
+		// copy data
+		memcpy(slot->data.currentTextures.data + cip->offset, cip->data, cip->size-16);
+
+		return;
+	}
+
+	if (cpp->type == capturyStreamedImageHeader) {
+		CapturyImageHeaderPacket* tp = (CapturyImageHeaderPacket*)buffer;
+
+		// update the image structures
+		std::unique_lock<std::mutex> mainLock(mainMutex);
+		if (currentImages.count(tp->actor) == 0) {
+			currentImages[tp->actor].camera = tp->actor;
+			currentImages[tp->actor].width = tp->width;
+			currentImages[tp->actor].height = tp->height;
+			currentImages[tp->actor].timestamp = 0;
+			currentImages[tp->actor].data = (unsigned char*)malloc(tp->width*tp->height*3);
+		} else if (currentImages[tp->actor].width != tp->width || currentImages[tp->actor].height != tp->height)
+			currentImages[tp->actor].data = (unsigned char*)realloc(currentImages[tp->actor].data, tp->width*tp->height*3);
+
+		currentImagesReceivedPackets[tp->actor] = std::vector<int>( ((tp->width*tp->height*3 + tp->dataPacketSize-16-1) / (tp->dataPacketSize-16)) + 1, 0);
+		mainLock.unlock();
+
+		// and request the data to go with it
+		if (sock != -1 && streamSocketPort != 0) {
+			CapturyGetImageDataPacket imPacket;
+			imPacket.type = capturyGetStreamedImageData;
+			imPacket.size = sizeof(imPacket);
+			imPacket.actor = tp->actor;
+			imPacket.port = streamSocketPort;
+			if (send(sock, (const char*)&imPacket, imPacket.size, 0) != imPacket.size)
+				log("cannot request streamed image data\n");
+		}
+		return;
+	}
+
+	if (cpp->type == capturyStreamedImageData) {
+		// received data for the image
+		CapturyImageDataPacket* cip = (CapturyImageDataPacket*)buffer;
+//			log("received image data for camera %d (payload %d bytes)\n", cip->actor, cip->size-16);
+
+		// check if we have a texture already
+		std::map<int, CapturyImage>::iterator it = currentImages.find(cip->actor);
+		if (it == currentImages.end()) {
+			log("received image data for camera %d without having received image header\n", cip->actor);
+			return;
+		}
+
+		// copy data from packet into the buffer
+		std::unique_lock<std::mutex> mainLock(mainMutex);
+		const int imgSize = it->second.width * it->second.height * 3;
+
+		// check if packet fits
+		if (cip->offset >= imgSize || cip->offset + cip->size-16 > imgSize) {
+			log("received image data for camera %d (%d-%d) that is larger than header (%dx%d*3 = %d)\n", cip->actor, cip->offset, cip->offset+cip->size-16, it->second.width, it->second.height, imgSize);
+			return;
+		}
+
+		bool finished = false;
+
+		// mark paket as received
+		const int packetIndex = cip->offset / (cip->size-16);
+		std::vector<int>& recvd = currentImagesReceivedPackets[cip->actor];
+		if (recvd[packetIndex] == 1) { // copying image to done although it is not quite finished
+			auto done = currentImagesDone.find(cip->actor);
+			if (done == currentImagesDone.end()) {
+				currentImagesDone[cip->actor].camera = it->second.camera;
+				currentImagesDone[cip->actor].data = (unsigned char*)malloc(it->second.width*it->second.height*3);
+				done = currentImagesDone.find(cip->actor);
+			}
+			done->second.width = it->second.width;
+			done->second.height = it->second.height;
+			done->second.timestamp = it->second.timestamp;
+			std::swap(done->second.data, it->second.data);
+			std::fill(recvd.begin(), recvd.end(), 0);
+			finished = true;
+		}
+		recvd[packetIndex] = 1;
+		++recvd[recvd.size()-1];
+
+		// copy data
+		memcpy(it->second.data + cip->offset, cip->data, cip->size-16);
+
+		if (recvd[recvd.size()-1] == (int)recvd.size()-2) { // done
+			auto done = currentImagesDone.find(cip->actor);
+			if (done == currentImagesDone.end()) {
+				currentImagesDone[cip->actor].camera = it->second.camera;
+				currentImagesDone[cip->actor].data = (unsigned char*)malloc(it->second.width*it->second.height*3);
+				done = currentImagesDone.find(cip->actor);
+			}
+			done->second.width = it->second.width;
+			done->second.height = it->second.height;
+			done->second.timestamp = it->second.timestamp;
+			std::swap(done->second.data, it->second.data);
+			std::fill(recvd.begin(), recvd.end(), 0);
+			finished = true;
+		}
+
+		if (finished && imageCallback)
+		{
+			mainLock.unlock();
+			imageCallback(this, &currentImagesDone[cip->actor], imageArg);
+			mainLock.lock();
+		}
+
+		return;
+	}
+
+	if (cpp->type == capturyARTag) {
+		//log("received ARTag message\n");
+		CapturyARTagPacket* art = (CapturyARTagPacket*)buffer;
+		std::unique_lock<std::mutex> mainLock(mainMutex);
+		arTagsTime = getTime();
+		arTags.resize(art->numTags);
+		memcpy(&arTags[0], &art->tags[0], sizeof(CapturyARTag) * art->numTags);
+		//for (int i = 0; i < art->numTags; ++i)
+		//	log("  id %d: orient % 4.1f,% 4.1f,% 4.1f\n", art->tags[i].id, art->tags[i].transform.rotation[0], art->tags[i].transform.rotation[1], art->tags[i].transform.rotation[2]);
+		if (arTagCallback != NULL)
+		{
+			mainLock.unlock();
+			arTagCallback(this, art->numTags, &art->tags[0], arTagArg);
+			mainLock.lock();
+		}
+		return;
+	}
+
+	if (cpp->type == capturyAngles) {
+		CapturyAnglesPacket* ang = (CapturyAnglesPacket*)buffer;
+		if (newAnglesCallback != NULL)
+			newAnglesCallback(this, Captury_getActor(this, ang->actor), ang->numAngles, ang->angles, newAnglesArg);
+		std::lock_guard<std::mutex> mainLock(mainMutex);
+		std::vector<CapturyAngleData>& currentAngles = actors.findOrAdd(ang->actor).currentAngles;
+		currentAngles.resize(ang->numAngles);
+		for (int i = 0; i < ang->numAngles; ++i)
+			currentAngles[i] = *(CapturyAngleData*)((char*)ang->angles + sizeof(CapturyAngleData) * i);
+		return;
+	}
+
+	if (cpp->type == capturyActorModeChanged) {
+		CapturyActorModeChangedPacket* amc = (CapturyActorModeChangedPacket*)buffer;
+		log("received actorModeChanged packet %x %d\n", amc->actor, amc->mode);
+		if (actorChangedCallback != NULL)
+			actorChangedCallback(this, amc->actor, amc->mode, actorChangedArg);
+		std::lock_guard<std::mutex> mainLock(mainMutex);
+		actorModeChanged(amc->actor, amc->mode);
+		return;
+	}
+	if (cpp->type == capturyPoseCont || cpp->type == capturyCompressedPoseCont) {
+		std::unique_lock<std::mutex> mainLock(mainMutex);
+		ActorSlot* slot = actors.find(cpp->actor);
+		if (slot == nullptr || !slot->actor) {
+			char buff[400];
+			snprintf(buff, 400, "pose continuation: Actor %d does not exist", cpp->actor);
+			lastErrorMessage = buff;
+			return;
+		}
+
+		CapturyPoseCont* cpc = (CapturyPoseCont*)cpp;
+		int numBytesToCopy = size - (int)((char*)cpc->values - (char*)cpc);
+		receivedPoseFragment(slot, cpc->timestamp, cpc->values, numBytesToCopy, nullptr, mainLock);
+		return;
+	}
+
+	if (cpp->type == capturyLatency) {
+		CapturyLatencyPacket* lp = (CapturyLatencyPacket*)buffer;
+		std::lock_guard<std::mutex> mainLock(mainMutex);
+		currentLatency = *lp;
+		if (mostRecentPoseReceivedTimestamp == currentLatency.poseTimestamp) {
+			receivedPoseTime = mostRecentPoseReceivedTime;
+			receivedPoseTimestamp = mostRecentPoseReceivedTimestamp;
+		} else {
+			receivedPoseTime = 0; // most recent one doesn't match
+			receivedPoseTimestamp = 0;
+		}
+		log("latency received %" PRIu64 ", %" PRIu64 " - %" PRIu64 ", %" PRIu64 " - %" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", lp->firstImagePacket, lp->optimizationStart, lp->optimizationEnd, lp->sendPacketTime, dataAvailableTime, dataReceivedTime, receivedPoseTime);
+		return;
+	}
+
+	if (cpp->type != capturyPose && cpp->type != capturyPose2 && cpp->type != capturyCompressedPose && cpp->type != capturyCompressedPose2) {
+		log("stream socket received unrecognized packet %d\n", cpp->type);
+		return;
+	}
+
+	receivedPosePacket(cpp);
+}
+
 static void streamLoop(void* arg)
 {
 	RemoteCaptury** rc = (RemoteCaptury**)arg;
@@ -1580,39 +3779,31 @@ static void streamLoop(void* arg)
 	free(arg);
 }
 
-void RemoteCaptury::streamLoop(CapturyStreamPacketTcp* packet)
+// opens the stream socket and asks the server to start streaming to it. returns -1 on failure.
+SOCKET RemoteCaptury::openStreamSocket(CapturyStreamPacketTcp* packet)
 {
 	SOCKET streamSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
 	if (streamSock == -1) {
 		log("failed to create stream socket\n");
-		return;
+		return (SOCKET)-1;
 	}
 
 	if (bind(streamSock, (sockaddr*) &localStreamAddress, sizeof(localStreamAddress)) != 0) {
 		closesocket(streamSock);
 		log("failed to bind stream socket\n");
-		return;
+		return (SOCKET)-1;
 	}
 
 	if (::connect(streamSock, (sockaddr*) &remoteAddress, sizeof(remoteAddress)) != 0) {
 		closesocket(streamSock);
 		log("failed to connect stream socket\n");
-		return;
+		return (SOCKET)-1;
 	}
 
 	// send dummy packet to trick some firewalls into letting us through
 	CapturyTimePacket timePacket = {capturyTime, sizeof(CapturyTimePacket), getTime()};
 	send(streamSock, (const char*)&timePacket, sizeof(timePacket), 0);
 
-	uint64_t lastKeepAliveTime = getTime();
-
-	int sockBufSize = 500000;
-	socklen_t optSize = sizeof(sockBufSize);
-	getsockopt(streamSock, SOL_SOCKET, SO_RCVBUF, (char*)&sockBufSize, &optSize);
-
-	// set read timeout
-	setSocketTimeout(streamSock, 100);
-
 	struct sockaddr_in thisEnd;
 
 	{
@@ -1636,42 +3827,60 @@ void RemoteCaptury::streamLoop(CapturyStreamPacketTcp* packet)
 	// send request on TCP socket
 	if (send(sock, (const char*)packet, packet->size, 0) != packet->size) {
 		lastErrorMessage = "Failed to start streaming";
-		return;
+		closesocket(streamSock);
+		streamSocketPort = 0;
+		return (SOCKET)-1;
 	}
 
-	while (!stopStreamThread) {
-/*		fd_set reader;
-		FD_ZERO(&reader);
-		FD_SET(streamSock, &reader);
-
-		// keep the streaming alive
-
-		tv.tv_sec = 0;
-		tv.tv_usec = 500000; // 0.5s = 2Hz
-		int ret = select((int)(MAXIMUM(sock, streamSock)+1), &reader, NULL, NULL, &tv);
-		if (ret == -1) { // error
-			log("error waiting for stream socket\n");
-			lastErrorMessage = "Error waiting for stream socket";
-			return 0;
-		}
-		if (ret == 0) {
-			lastErrorMessage = "Stream timed out";
-			continue;
-		}*/
-
-		dataAvailableTime = getRemoteTime(getTime());
-
-		std::vector<char> buffer(10000);
-		CapturyPosePacket* cpp = (CapturyPosePacket*)buffer.data();
+	return streamSock;
+}
 
-		// first peek to find out which packet type this is
-		int size = recv(streamSock, buffer.data(), (int)buffer.size(), 0);
-//		log("received stream packet size %d (%d %d)\n", (int) size, cpp->type, cpp->size);
-		if (size == 0) { // the other end shut down the socket...
+// dispatches a batch of datagrams that StreamReceiver::receive() returned
+void RemoteCaptury::receivedStreamBatch(StreamReceiver& receiver, int numReceived)
+{
+	// the clock is read once for the whole batch
+	packetReceivedNs = getMonotonicNanoseconds();
+	packetReceivedTime = getTime();
+	dataReceivedTime = getRemoteTime(packetReceivedTime);
+	dataAvailableTime = dataReceivedTime; // the batch is received as soon as the first datagram is available
+
+	++numStreamWakeups;
+	numStreamDatagrams += numReceived;
+	lastStreamBatchSize = numReceived;
+	if (numReceived > maxStreamBatchSize)
+		maxStreamBatchSize = numReceived;
+
+	for (int i = 0; i < numReceived; ++i) {
+		if (receiver.sizes[i] == 0) { // the other end shut down the socket...
 			lastErrorMessage = "Stream socket closed unexpectedly";
 			continue;
 		}
-		if (size == -1) { // error
+		receivedStreamPacket(receiver.slot(i), receiver.sizes[i]);
+	}
+	receiver.ringHead = (receiver.ringHead + numReceived) % StreamReceiver::ringSlots;
+}
+
+void RemoteCaptury::streamLoop(CapturyStreamPacketTcp* packet)
+{
+	SOCKET streamSock = openStreamSocket(packet);
+	if (streamSock == -1)
+		return;
+
+	CapturyTimePacket timePacket = {capturyTime, sizeof(CapturyTimePacket), getTime()};
+	uint64_t lastKeepAliveTime = getTime();
+
+	int sockBufSize = 500000;
+	socklen_t optSize = sizeof(sockBufSize);
+	getsockopt(streamSock, SOL_SOCKET, SO_RCVBUF, (char*)&sockBufSize, &optSize);
+
+	// set read timeout
+	setSocketTimeout(streamSock, 100);
+
+	std::unique_ptr<StreamReceiver> receiver(new StreamReceiver);
+
+	while (!stopStreamThread) {
+		int numReceived = receiver->receive(streamSock);
+		if (numReceived == -1) { // error
 			int err = sockerror();
 			if (isSocketErrorTryAgain(err)) {
 				#ifdef WIN32
@@ -1682,6 +3891,8 @@ void RemoteCaptury::streamLoop(CapturyStreamPacketTcp* packet)
 				}
 				#endif
 
+				checkActorsAndNotify();
+
 				// renew the keep-alive firewall hole punching
 				uint64_t now = getTime();
 				if (now > lastKeepAliveTime + 1000000) {
@@ -1699,265 +3910,193 @@ void RemoteCaptury::streamLoop(CapturyStreamPacketTcp* packet)
 			break;
 		}
 
-		dataReceivedTime = Captury_getTime(this); // get remote time
+		receivedStreamBatch(*receiver, numReceived);
+	}
 
-		if (cpp->type == capturyImageData) {
-			// received data for the image
-			CapturyImageDataPacket* cip = (CapturyImageDataPacket*)buffer.data();
-			//log("received image data for actor %x (payload %d bytes)\n", cip->actor, cip->size-16);
+	closesocket(streamSock);
 
-			// check if we have a texture already
-			std::lock_guard<std::mutex> mainLock(mainMutex);
-			std::unordered_map<int, ActorData>::iterator it = actorData.find(cip->actor);
-			if (it == actorData.end()) {
-				log("received image data for actor %x without having received image header\n", cip->actor);
-				continue;
-			}
+	streamSocketPort = 0;
 
-			// copy data from packet into the buffer
-			const int imgSize = it->second.currentTextures.width * it->second.currentTextures.height * 3;
+	log("closing streaming thread\n");
+}
 
-			// check if packet fits
-			if (cip->offset >= imgSize || cip->offset + cip->size-16 > imgSize) {
-				log("received image data for actor %x (%d-%d) that is larger than header (%dx%d*3 = %d)\n", cip->actor, cip->offset, cip->offset+cip->size-16, it->second.currentTextures.width, it->second.currentTextures.height, imgSize);
-				continue;
-			}
+// starts a non-blocking connect. tcpReadyOnLoop() is called once it is done.
+void RemoteCaptury::startConnectingOnLoop()
+{
+	if (stopReceiving)
+		return;
 
-			// mark paket as received
-			const int packetIndex = cip->offset / (cip->size-16);
-			actorData[cip->actor].receivedPackets[packetIndex] = 1;
+	SOCKET sok = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (sok == -1) {
+		scheduleReconnectOnLoop();
+		return;
+	}
+	setSocketNonBlocking(sok);
 
-			// copy data
-			memcpy(it->second.currentTextures.data + cip->offset, cip->data, cip->size-16);
+	if ((localAddress.sin_port != 0 && bind(sok, (sockaddr*) &localAddress, sizeof(localAddress)) != 0) ||
+	    (::connect(sok, (sockaddr*) &remoteAddress, sizeof(remoteAddress)) != 0 && !isConnectInProgress(sockerror()))) {
+		closesocket(sok);
+		scheduleReconnectOnLoop();
+		return;
+	}
 
-			continue;
-		}
+	sock = sok;
+	tcpReader.reset();
+	tcpConnecting = true;
+	ioLoop->addSocket(sock, true, [this]() { tcpReadyOnLoop(); });
+}
 
-		if (cpp->type == capturyStreamedImageHeader) {
-			CapturyImageHeaderPacket* tp = (CapturyImageHeaderPacket*)buffer.data();
+// tries again after the same 100ms the receive thread waits between attempts
+void RemoteCaptury::scheduleReconnectOnLoop()
+{
+	if (stopReceiving || reconnectTimer != 0)
+		return;
 
-			// update the image structures
-			std::unique_lock<std::mutex> mainLock(mainMutex);
-			if (currentImages.count(tp->actor) == 0) {
-				currentImages[tp->actor].camera = tp->actor;
-				currentImages[tp->actor].width = tp->width;
-				currentImages[tp->actor].height = tp->height;
-				currentImages[tp->actor].timestamp = 0;
-				currentImages[tp->actor].data = (unsigned char*)malloc(tp->width*tp->height*3);
-			} else if (currentImages[tp->actor].width != tp->width || currentImages[tp->actor].height != tp->height)
-				currentImages[tp->actor].data = (unsigned char*)realloc(currentImages[tp->actor].data, tp->width*tp->height*3);
-
-			currentImagesReceivedPackets[tp->actor] = std::vector<int>( ((tp->width*tp->height*3 + tp->dataPacketSize-16-1) / (tp->dataPacketSize-16)) + 1, 0);
-			mainLock.unlock();
+	reconnectTimer = ioLoop->addTimer(100000, [this]() {
+		ioLoop->removeTimer(reconnectTimer);
+		reconnectTimer = 0;
+		startConnectingOnLoop();
+	});
+}
 
-			// and request the data to go with it
-			if (sock != -1 && streamSocketPort != 0) {
-				CapturyGetImageDataPacket imPacket;
-				imPacket.type = capturyGetStreamedImageData;
-				imPacket.size = sizeof(imPacket);
-				imPacket.actor = tp->actor;
-				imPacket.port = streamSocketPort;
-				if (send(sock, (const char*)&imPacket, imPacket.size, 0) != imPacket.size)
-					log("cannot request streamed image data\n");
-			}
-			continue;
+void RemoteCaptury::tcpReadyOnLoop()
+{
+	if (tcpConnecting) {
+		int err = 0;
+		socklen_t len = sizeof(err);
+		getsockopt(sock, SOL_SOCKET, SO_ERROR, (char*)&err, &len);
+		if (err != 0) {
+			closeTcpOnLoop();
+			scheduleReconnectOnLoop();
+			return;
 		}
 
-		if (cpp->type == capturyStreamedImageData) {
-			// received data for the image
-			CapturyImageDataPacket* cip = (CapturyImageDataPacket*)buffer.data();
-//			log("received image data for camera %d (payload %d bytes)\n", cip->actor, cip->size-16);
+		tcpConnecting = false;
+		ioLoop->setWantWrite(sock, false);
 
-			// check if we have a texture already
-			std::map<int, CapturyImage>::iterator it = currentImages.find(cip->actor);
-			if (it == currentImages.end()) {
-				log("received image data for camera %d without having received image header\n", cip->actor);
-				continue;
-			}
+#ifndef WIN32
+		char buf[100];
+		log("connected to %s:%d\n", inet_ntop(AF_INET, &remoteAddress.sin_addr, buf, 100), ntohs(remoteAddress.sin_port));
+#endif
 
-			// copy data from packet into the buffer
-			std::unique_lock<std::mutex> mainLock(mainMutex);
-			const int imgSize = it->second.width * it->second.height * 3;
+		if (streamWhat != CAPTURY_STREAM_NOTHING)
+			Captury_startStreamingImagesAndAngles(this, streamWhat, streamCamera, (int)streamAngles.size(), streamAngles.data());
+	}
 
-			// check if packet fits
-			if (cip->offset >= imgSize || cip->offset + cip->size-16 > imgSize) {
-				log("received image data for camera %d (%d-%d) that is larger than header (%dx%d*3 = %d)\n", cip->actor, cip->offset, cip->offset+cip->size-16, it->second.width, it->second.height, imgSize);
-				continue;
-			}
+	while (sock != -1) {
+		const SOCKET sok = sock;
+		if (receive(sock) > 0)
+			continue;
 
-			bool finished = false;
-
-			// mark paket as received
-			const int packetIndex = cip->offset / (cip->size-16);
-			std::vector<int>& recvd = currentImagesReceivedPackets[cip->actor];
-			if (recvd[packetIndex] == 1) { // copying image to done although it is not quite finished
-				auto done = currentImagesDone.find(cip->actor);
-				if (done == currentImagesDone.end()) {
-					currentImagesDone[cip->actor].camera = it->second.camera;
-					currentImagesDone[cip->actor].data = (unsigned char*)malloc(it->second.width*it->second.height*3);
-					done = currentImagesDone.find(cip->actor);
-				}
-				done->second.width = it->second.width;
-				done->second.height = it->second.height;
-				done->second.timestamp = it->second.timestamp;
-				std::swap(done->second.data, it->second.data);
-				std::fill(recvd.begin(), recvd.end(), 0);
-				finished = true;
-			}
-			recvd[packetIndex] = 1;
-			++recvd[recvd.size()-1];
-
-			// copy data
-			memcpy(it->second.data + cip->offset, cip->data, cip->size-16);
-
-			if (recvd[recvd.size()-1] == (int)recvd.size()-2) { // done
-				auto done = currentImagesDone.find(cip->actor);
-				if (done == currentImagesDone.end()) {
-					currentImagesDone[cip->actor].camera = it->second.camera;
-					currentImagesDone[cip->actor].data = (unsigned char*)malloc(it->second.width*it->second.height*3);
-					done = currentImagesDone.find(cip->actor);
-				}
-				done->second.width = it->second.width;
-				done->second.height = it->second.height;
-				done->second.timestamp = it->second.timestamp;
-				std::swap(done->second.data, it->second.data);
-				std::fill(recvd.begin(), recvd.end(), 0);
-				finished = true;
-			}
+		if (sock == -1) { // receive() closed the connection
+			ioLoop->removeSocket(sok);
+			tcpReader.reset();
 
-			if (finished && imageCallback)
-			{
-				mainLock.unlock();
-				imageCallback(this, &currentImagesDone[cip->actor], imageArg);
-				mainLock.lock();
-			}
+			deleteActors();
+			cameras.clear();
+			numCameras = -1;
+			stopStreamingOnLoop();
 
-			continue;
+			scheduleReconnectOnLoop();
 		}
+		return;
+	}
+}
 
-		if (cpp->type == capturyARTag) {
-			//log("received ARTag message\n");
-			CapturyARTagPacket* art = (CapturyARTagPacket*)buffer.data();
-			std::unique_lock<std::mutex> mainLock(mainMutex);
-			arTagsTime = getTime();
-			arTags.resize(art->numTags);
-			memcpy(&arTags[0], &art->tags[0], sizeof(CapturyARTag) * art->numTags);
-			//for (int i = 0; i < art->numTags; ++i)
-			//	log("  id %d: orient % 4.1f,% 4.1f,% 4.1f\n", art->tags[i].id, art->tags[i].transform.rotation[0], art->tags[i].transform.rotation[1], art->tags[i].transform.rotation[2]);
-			if (arTagCallback != NULL)
-			{
-				mainLock.unlock();
-				arTagCallback(this, art->numTags, &art->tags[0], arTagArg);
-				mainLock.lock();
-			}
-			continue;
-		}
+void RemoteCaptury::closeTcpOnLoop()
+{
+	if (sock != -1) {
+		ioLoop->removeSocket(sock);
+		closesocket(sock);
+		sock = (SOCKET)-1;
+	}
+	tcpConnecting = false;
+	tcpReader.reset();
+}
 
-		if (cpp->type == capturyAngles) {
-			CapturyAnglesPacket* ang = (CapturyAnglesPacket*)buffer.data();
-			if (newAnglesCallback != NULL)
-				newAnglesCallback(this, Captury_getActor(this, ang->actor), ang->numAngles, ang->angles, newAnglesArg);
-			std::lock_guard<std::mutex> mainLock(mainMutex);
-			currentAngles[ang->actor].resize(ang->numAngles);
-			for (int i = 0; i < ang->numAngles; ++i)
-				currentAngles[ang->actor][i] = *(CapturyAngleData*)((char*)ang->angles + sizeof(CapturyAngleData) * i);
-			continue;
-		}
+void RemoteCaptury::startStreamingOnLoop(CapturyStreamPacketTcp* packet)
+{
+	stopStreamingOnLoop();
 
-		if (cpp->type == capturyActorModeChanged) {
-			CapturyActorModeChangedPacket* amc = (CapturyActorModeChangedPacket*)buffer.data();
-			log("received actorModeChanged packet %x %d\n", amc->actor, amc->mode);
-			if (actorChangedCallback != NULL)
-				actorChangedCallback(this, amc->actor, amc->mode, actorChangedArg);
-			std::lock_guard<std::mutex> mainLock(mainMutex);
-			if (actorData.count(amc->actor))
-				actorData[amc->actor].status = (CapturyActorStatus)amc->mode;
-			continue;
-		}
-		if (cpp->type == capturyPoseCont || cpp->type == capturyCompressedPoseCont) {
-			std::unique_lock<std::mutex> mainLock(mainMutex);
-			if (actorsById.count(cpp->actor) == 0) {
-				char buff[400];
-				snprintf(buff, 400, "pose continuation: Actor %d does not exist", cpp->actor);
-				lastErrorMessage = buff;
-				continue;
-			}
+	SOCKET sok = openStreamSocket(packet);
+	if (sok == -1)
+		return;
+	setSocketNonBlocking(sok);
 
-			std::unordered_map<int, ActorData>::iterator it = actorData.find(cpp->actor);
-			ActorData& aData = it->second;
-			int inProgressIndex = -1;
-			for (int x = 0; x < 4; ++x) {
-				if (cpp->timestamp == aData.inProgress[x].timestamp) {
-					inProgressIndex = x;
-					break;
-				}
-			}
-			if (inProgressIndex == -1) {
-				lastErrorMessage = "pose continuation packet for wrong timestamp";
-				continue;
-			}
+	streamSock = sok;
+	if (!streamReceiver)
+		streamReceiver.reset(new StreamReceiver);
+	ioLoop->addSocket(streamSock, false, [this]() { streamReadyOnLoop(); });
 
-			CapturyPoseCont* cpc = (CapturyPoseCont*)cpp;
+	// renew the keep-alive firewall hole punching
+	keepAliveTimer = ioLoop->addTimer(1000000, [this]() {
+		CapturyTimePacket timePacket = {capturyTime, sizeof(CapturyTimePacket), getTime()};
+		send(streamSock, (const char*)&timePacket, sizeof(timePacket), 0);
+	});
 
-			int numBytesToCopy = size - (int)((char*)cpc->values - (char*)cpc);
-			int numJoints = actorsById[cpp->actor]->numJoints;
-			int numBlendShapes = actorsById[cpp->actor]->numBlendShapes;
-			int totalBytes = (numJoints * 6 + numBlendShapes) * sizeof(float);
-			if (aData.inProgress[inProgressIndex].bytesDone + numBytesToCopy > totalBytes) {
-				lastErrorMessage = "pose continuation too large";
-				continue;
-			}
+	// as often as the stream thread would time out waiting for packets
+	livenessTimer = ioLoop->addTimer(100000, [this]() { checkActorsAndNotify(); });
+}
 
-			char* at = ((char*)aData.inProgress[inProgressIndex].pose) + aData.inProgress[inProgressIndex].bytesDone;
-			memcpy(at, cpc->values, numBytesToCopy);
-			aData.inProgress[inProgressIndex].bytesDone += numBytesToCopy;
-
-			if (aData.inProgress[inProgressIndex].bytesDone == totalBytes) {
-				if (cpp->type == capturyCompressedPoseCont)
-					decompressPose(&aData.currentPose, (uint8_t*)aData.inProgress[inProgressIndex].pose, actorsById[cpp->actor].get());
-				else if (aData.inProgress[inProgressIndex].onlyRootTranslation) {
-					memcpy(aData.currentPose.transforms, aData.inProgress[inProgressIndex].pose, numJoints * 6 * sizeof(float));
-					for (int i = 1, n = 6; i < numJoints; ++i, n += 3)
-						memcpy(it->second.currentPose.transforms[i].rotation, aData.inProgress[inProgressIndex].pose+n, 3*sizeof(float));
-					memcpy(aData.currentPose.blendShapeActivations, aData.inProgress[inProgressIndex].pose + (3 + numJoints * 3) * sizeof(float), numBlendShapes * sizeof(float));
-				} else {
-					memcpy(aData.currentPose.transforms, aData.inProgress[inProgressIndex].pose, numJoints * 6 * sizeof(float));
-					memcpy(aData.currentPose.blendShapeActivations, aData.inProgress[inProgressIndex].pose + numJoints * 6 * sizeof(float), numBlendShapes * sizeof(float));
-				}
-				mainLock.unlock();
-				receivedPose(&aData.currentPose, cpc->actor, &actorData[cpc->actor], aData.inProgress[inProgressIndex].timestamp);
-			}
-			continue;
-		}
+void RemoteCaptury::stopStreamingOnLoop()
+{
+	if (keepAliveTimer != 0) {
+		ioLoop->removeTimer(keepAliveTimer);
+		keepAliveTimer = 0;
+	}
+	if (livenessTimer != 0) {
+		ioLoop->removeTimer(livenessTimer);
+		livenessTimer = 0;
+	}
 
-		if (cpp->type == capturyLatency) {
-			CapturyLatencyPacket* lp = (CapturyLatencyPacket*)buffer.data();
-			std::lock_guard<std::mutex> mainLock(mainMutex);
-			currentLatency = *lp;
-			if (mostRecentPoseReceivedTimestamp == currentLatency.poseTimestamp) {
-				receivedPoseTime = mostRecentPoseReceivedTime;
-				receivedPoseTimestamp = mostRecentPoseReceivedTimestamp;
-			} else {
-				receivedPoseTime = 0; // most recent one doesn't match
-				receivedPoseTimestamp = 0;
-			}
-			log("latency received %" PRIu64 ", %" PRIu64 " - %" PRIu64 ", %" PRIu64 " - %" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", lp->firstImagePacket, lp->optimizationStart, lp->optimizationEnd, lp->sendPacketTime, dataAvailableTime, dataReceivedTime, receivedPoseTime);
-			continue;
-		}
+	if (streamSock == -1)
+		return;
 
-		if (cpp->type != capturyPose && cpp->type != capturyPose2 && cpp->type != capturyCompressedPose && cpp->type != capturyCompressedPose2) {
-			log("stream socket received unrecognized packet %d\n", cpp->type);
-			continue;
+	ioLoop->removeSocket(streamSock);
+	closesocket(streamSock);
+	streamSock = (SOCKET)-1;
+	streamSocketPort = 0;
+
+	log("closing stream socket\n");
+}
+
+void RemoteCaptury::streamReadyOnLoop()
+{
+	// a callback may stop or restart streaming while a batch is dispatched
+	const SOCKET sok = streamSock;
+	while (streamSock == sok) {
+		int numReceived = streamReceiver->receive(sok);
+		if (numReceived == -1) { // error
+			int err = sockerror();
+			if (isSocketErrorTryAgain(err))
+				return;
+
+			char buff[200];
+			snprintf(buff, 200, "Stream socket error: %s", sockstrerror(err));
+			lastErrorMessage = buff;
+			log("streaming error: %s\n", buff);
+			stopStreamingOnLoop();
+			return;
 		}
 
-		receivedPosePacket(cpp);
+		receivedStreamBatch(*streamReceiver, numReceived);
 	}
+}
 
-	closesocket(streamSock);
-
-	streamSocketPort = 0;
+void RemoteCaptury::leaveReactor()
+{
+	if (ioLoop == nullptr)
+		return;
 
-	log("closing streaming thread\n");
+	ioLoop->run([this]() {
+		if (syncTimer != 0) {
+			ioLoop->removeTimer(syncTimer);
+			syncTimer = 0;
+			syncLoopIsRunning = false;
+		}
+	});
+	ioLoop = nullptr;
+	reactor.reset();
 }
 
 extern "C" RemoteCaptury* Captury_create()
@@ -1968,6 +4107,12 @@ extern "C" RemoteCaptury* Captury_create()
 extern "C" int Captury_destroy(RemoteCaptury* rc)
 {
 	int ret = Captury_disconnect(rc);
+	rc->leaveReactor();
+	if (rc->syncThread.joinable()) {
+		rc->stopSyncThread = true;
+		rc->syncThread.join();
+	}
+	rc->stopPacketCapture();
 	delete rc;
 	return ret;
 }
@@ -1993,7 +4138,7 @@ bool RemoteCaptury::connect(const char* ip, unsigned short port, unsigned short
 		return false;
 #endif
 
-	if (sock != -1)
+	if (sock != -1 || receiveThread.joinable())
 		disconnect();
 
 	localAddress.sin_family = AF_INET;
@@ -2011,6 +4156,27 @@ bool RemoteCaptury::connect(const char* ip, unsigned short port, unsigned short
 	handshakeFinished = false;
 	stopReceiving = 0;
 
+	if (ioLoop != nullptr) {
+		if (async == 0) {
+			// fail right away like the receive thread does if the server cannot be reached
+			SOCKET sok = openTcpSocket();
+			if (sok == -1)
+				return false;
+			setSocketNonBlocking(sok);
+			ioLoop->run([this, sok]() {
+				sock = sok;
+				ioLoop->addSocket(sock, false, [this]() { tcpReadyOnLoop(); });
+			});
+
+			// block until handshake is finished
+			while (!handshakeFinished && !stopReceiving)
+				sleepMicroSeconds(1000);
+		} else
+			ioLoop->run([this]() { startConnectingOnLoop(); });
+
+		return true;
+	}
+
 	if (async == 0) {
 		if (sock == -1) {
 #ifdef WIN32
@@ -2048,6 +4214,28 @@ bool RemoteCaptury::disconnect()
 	stopReceiving = 1;
 	stopStreamThread = 1;
 
+	// wake up the receive thread which is blocked in recv
+	if (ioLoop == nullptr && sock != -1)
+		shutdown(sock, SHUT_RDWR);
+
+	if (ioLoop != nullptr) {
+		ioLoop->run([this, &closedOrStopped]() {
+			if (reconnectTimer != 0) {
+				ioLoop->removeTimer(reconnectTimer);
+				reconnectTimer = 0;
+			}
+			if (streamSock != -1) {
+				stopStreamingOnLoop();
+				closedOrStopped = true;
+			}
+			if (sock != -1) {
+				closeTcpOnLoop();
+				closedOrStopped = true;
+			}
+		});
+		handshakeFinished = false;
+	}
+
 	// Wait for threads to close if not closed already
 	if (receiveThread.joinable()) {
 		receiveThread.join();
@@ -2075,6 +4263,8 @@ bool RemoteCaptury::disconnect()
 // returns 1 if successful, 0 otherwise
 extern "C" int Captury_getConnectionStatus(RemoteCaptury* rc)
 {
+	if (rc->replaying)
+		return rc->handshakeFinished ? CAPTURY_CONNECTED : CAPTURY_CONNECTING;
 	if (rc->sock == -1)
 		return CAPTURY_DISCONNECTED;
 	return (rc->handshakeFinished && rc->stopReceiving == 0) ? CAPTURY_CONNECTED : CAPTURY_CONNECTING;
@@ -2087,15 +4277,15 @@ extern "C" int Captury_getActors(RemoteCaptury* rc, const CapturyActor** actrs)
 	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
 
 	rc->actorPointers.clear();
-	rc->actorPointers.reserve(rc->actorsById.size());
+	rc->actorPointers.reserve(rc->actors.size());
 	rc->actorSharedPointers.clear();
-	rc->actorSharedPointers.reserve(rc->actorsById.size());
+	rc->actorSharedPointers.reserve(rc->actors.size());
 
 	int numActors = 0;
-	for (auto& it : rc->actorsById) {
-		if (rc->actorData[it.first].status != ACTOR_DELETED) {
-			rc->actorPointers.push_back(*it.second.get());
-			rc->actorSharedPointers.push_back(it.second);
+	for (ActorSlot& slot : rc->actors) {
+		if (slot.actor && slot.data.status != ACTOR_DELETED) {
+			rc->actorPointers.push_back(*slot.actor.get());
+			rc->actorSharedPointers.push_back(slot.actor);
 			++numActors;
 		}
 	}
@@ -2124,11 +4314,12 @@ extern "C" const CapturyActor* Captury_getActor(RemoteCaptury* rc, int id)
 		return NULL;
 
 	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
-	if (rc->actorsById.count(id) == 0) {
+	ActorSlot* slot = rc->actors.find(id);
+	if (slot == nullptr || !slot->actor) {
 		return NULL;
 	}
 
-	CapturyActor_p ret = rc->actorsById[id];
+	CapturyActor_p ret = slot->actor;
 	rc->returnedActors[ret.get()] = ret;
 
 	return ret.get();
@@ -2253,6 +4444,11 @@ int RemoteCaptury::startStreamingImagesAndAngles(int what, int32_t camId, int nu
 	packet->cameraId = camId;
 
 	stopStreamThread = 0;
+	if (ioLoop != nullptr) {
+		ioLoop->run([this, packet]() { startStreamingOnLoop((CapturyStreamPacketTcp*)packet); });
+		free(rec);
+		return 1;
+	}
 	streamThread = std::thread(::streamLoop, rec);
 
 	return 1;
@@ -2266,7 +4462,9 @@ extern "C" int Captury_stopStreaming(RemoteCaptury* rc, int wait)
 
 	rc->stopStreamThread = 1;
 
-	if (wait && rc->streamThread.joinable())
+	if (rc->ioLoop != nullptr)
+		rc->ioLoop->run([rc]() { rc->stopStreamingOnLoop(); });
+	else if (wait && rc->streamThread.joinable())
 		rc->streamThread.join();
 
 	return 1;
@@ -2290,63 +4488,128 @@ CapturyPose* RemoteCaptury::getCurrentPoseAndTrackingConsistencyForActor(int act
 	std::unique_lock<std::mutex> mainLock(mainMutex);
 
 	// check whether any actor changed status
-	uint64_t now = getTime() - 500000; // half a second ago
-	bool stillCurrent = true;
+	const uint64_t now = getTime();
 	std::vector<int> stoppedActorIds;
-	for (std::unordered_map<int, ActorData>::iterator it = actorData.begin(); it != actorData.end(); ++it) {
-		if (it->second.lastPoseTimestamp > now) // still current
-			continue;
+	if (liveness.isDue(now))
+		checkActors(now, stoppedActorIds);
+	const bool stillCurrent = (std::find(stoppedActorIds.begin(), stoppedActorIds.end(), actorId) == stoppedActorIds.end());
 
-		if (it->second.status == ACTOR_SCALING || it->second.status == ACTOR_TRACKING) {
-			it->second.status = ACTOR_STOPPED;
-			if (actorChangedCallback)
-				stoppedActorIds.push_back(it->first);
-			if (it->first == actorId)
-				stillCurrent = false;
+	if (actorChangedCallback) {
+		for (int id : stoppedActorIds) {
+			mainLock.unlock();
+			actorChangedCallback(this, id, ACTOR_STOPPED, actorChangedArg);
+			mainLock.lock();
 		}
 	}
 
-	for (int id : stoppedActorIds) {
-		mainLock.unlock();
-		actorChangedCallback(this, id, ACTOR_STOPPED, actorChangedArg);
-		mainLock.lock();
-	}
-
 	if (!stillCurrent) {
 		lastErrorMessage = "actor has disappeared";
 		return NULL;
 	}
 
 	// uint64_t now = getTime();
-	std::unordered_map<int, ActorData>::iterator it = actorData.find(actorId);
-	if (it == actorData.end()) {
+	ActorSlot* slot = actors.find(actorId);
+	if (slot == nullptr) {
 		char buf[400];
 		snprintf(buf, 400, "Requested pose for unknown actor %d, have poses ", actorId);
 		lastErrorMessage = buf;
-		for (it = actorData.begin(); it != actorData.end(); ++it) {
-			snprintf(buf, 400, "%d ", it->first);
+		for (ActorSlot& s : actors) {
+			snprintf(buf, 400, "%d ", s.id);
 			lastErrorMessage += buf;
 		}
 		return NULL;
 	}
 
-	if (it->second.currentPose.numTransforms == 0 && it->second.currentPose.numBlendShapes == 0) {
+	std::shared_ptr<PoseMailbox> mailbox = slot->data.poseMailbox;
+	mainLock.unlock();
+
+	// copying the pose does not block the stream thread
+	PoseBuffer* buffer = (mailbox) ? mailbox->acquire() : nullptr;
+	if (buffer == nullptr || (buffer->pose.numTransforms == 0 && buffer->pose.numBlendShapes == 0)) {
+		if (buffer != nullptr)
+			buffer->release();
+		mainLock.lock();
 		lastErrorMessage = "most recent pose is empty";
 		return NULL;
 	}
 
-	CapturyPose* pose = (CapturyPose*)malloc(sizeof(CapturyPose) + it->second.currentPose.numTransforms * sizeof(CapturyTransform) + it->second.currentPose.numBlendShapes*sizeof(float));
-	pose->actor = actorId;
-	pose->timestamp = it->second.currentPose.timestamp;
-	pose->numTransforms = it->second.currentPose.numTransforms;
-	pose->transforms = (CapturyTransform*)&pose[1];
-	pose->numBlendShapes = it->second.currentPose.numBlendShapes;
-	pose->blendShapeActivations = (float*)(((CapturyTransform*)&pose[1]) + pose->numTransforms);
+	if (tc != nullptr)
+		*tc = buffer->trackingQuality;
+	CapturyPose* pose = Captury_clonePose(&buffer->pose);
+	buffer->release();
+	return pose;
+}
+
+extern "C" const CapturyPose* Captury_acquirePoseView(RemoteCaptury* rc, int actorId, int* trackingQuality)
+{
+	std::unique_lock<std::mutex> mainLock(rc->mainMutex);
+	ActorSlot* slot = rc->actors.find(actorId);
+	if (slot == nullptr || !slot->data.poseMailbox) {
+		rc->lastErrorMessage = "no pose for actor";
+		return NULL;
+	}
+	std::shared_ptr<PoseMailbox> mailbox = slot->data.poseMailbox;
+	mainLock.unlock();
+
+	PoseBuffer* buffer = mailbox->acquire();
+	if (buffer == nullptr) {
+		mainLock.lock();
+		rc->lastErrorMessage = "no pose received yet";
+		return NULL;
+	}
 
-	memcpy(pose->transforms, it->second.currentPose.transforms, sizeof(CapturyTransform) * pose->numTransforms);
-	memcpy(pose->blendShapeActivations, it->second.currentPose.blendShapeActivations, sizeof(float) * pose->numBlendShapes);
+	if (trackingQuality != nullptr)
+		*trackingQuality = buffer->trackingQuality;
+	return &buffer->pose;
+}
 
-	return pose;
+extern "C" const CapturyFrameSnapshot* Captury_getFrameSnapshot(RemoteCaptury* rc)
+{
+	rc->assembleFrames = true;
+
+	FrameSnapshotBuffer* buffer = rc->frameMailbox.acquire();
+	return (buffer != nullptr) ? &buffer->snapshot : NULL;
+}
+
+extern "C" void Captury_releaseFrameSnapshot(RemoteCaptury* rc, const CapturyFrameSnapshot* snapshot)
+{
+	if (snapshot != NULL)
+		FrameSnapshotBuffer::fromSnapshot(snapshot)->release();
+}
+
+extern "C" const CapturyFrameArrays* Captury_getFrameArrays(RemoteCaptury* rc)
+{
+	rc->assembleFrameArrays = true;
+
+	FrameArraysBuffer* buffer = rc->frameArraysMailbox.acquire();
+	return (buffer != nullptr) ? &buffer->arrays : NULL;
+}
+
+extern "C" void Captury_releaseFrameArrays(RemoteCaptury* rc, const CapturyFrameArrays* arrays)
+{
+	if (arrays != NULL)
+		FrameArraysBuffer::fromArrays(arrays)->release();
+}
+
+extern "C" void Captury_retainPoseView(RemoteCaptury* rc, const CapturyPose* pose)
+{
+	if (pose != NULL)
+		PoseBuffer::fromPose(pose)->retain();
+}
+
+extern "C" void Captury_releasePoseView(RemoteCaptury* rc, const CapturyPose* pose)
+{
+	if (pose != NULL)
+		PoseBuffer::fromPose(pose)->release();
+}
+
+extern "C" void Captury_poseConsumed(RemoteCaptury* rc, const CapturyPose* pose)
+{
+	if (pose == NULL)
+		return;
+	const uint64_t callbackNs = PoseBuffer::fromPose(pose)->callbackNs;
+	if (callbackNs != 0)
+		rc->callbackToConsumed.record(getMonotonicNanoseconds() - callbackNs);
 }
 
 extern "C" CapturyPose* Captury_getCurrentPose(RemoteCaptury* rc, int actorId)
@@ -2357,10 +4620,12 @@ extern "C" CapturyPose* Captury_getCurrentPose(RemoteCaptury* rc, int actorId)
 
 extern "C" CapturyAngleData* Captury_getCurrentAngles(RemoteCaptury* rc, int actorId, int* numAngles)
 {
-	if (rc->currentAngles.count(actorId)) {
+	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
+	ActorSlot* slot = rc->actors.find(actorId);
+	if (slot != nullptr && !slot->currentAngles.empty()) {
 		if (numAngles != nullptr)
-			*numAngles = (int)rc->currentAngles[actorId].size();
-		return rc->currentAngles[actorId].data();
+			*numAngles = (int)slot->currentAngles.size();
+		return slot->currentAngles.data();
 	} else {
 		if (numAngles != nullptr)
 			*numAngles = 0;
@@ -2377,8 +4642,8 @@ CAPTURY_DLL_EXPORT CapturyPose* Captury_clonePose(const CapturyPose* pose)
 {
 	CapturyPose* cloned = (CapturyPose*)malloc(sizeof(CapturyPose) + sizeof(CapturyTransform)*pose->numTransforms + sizeof(float)*pose->numBlendShapes);
 	memcpy(cloned, pose, sizeof(CapturyPose));
-	cloned->transforms = (CapturyTransform*)&pose[1];
-	cloned->blendShapeActivations = (float*)(((CapturyTransform*)&pose[1]) + pose->numTransforms);
+	cloned->transforms = (CapturyTransform*)&cloned[1];
+	cloned->blendShapeActivations = (float*)(((CapturyTransform*)&cloned[1]) + pose->numTransforms);
 
 	if (pose->numTransforms != 0)
 		memcpy(cloned->transforms, pose->transforms, sizeof(CapturyTransform)*pose->numTransforms);
@@ -2398,16 +4663,29 @@ extern "C" void Captury_freePose(CapturyPose* pose)
 extern "C" int Captury_getActorStatus(RemoteCaptury* rc, int actorId)
 {
 	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
-	std::unordered_map<int, ActorData>::iterator it = rc->actorData.find(actorId);
-	if (it == rc->actorData.end()) {
+	ActorSlot* slot = rc->actors.find(actorId);
+	if (slot == nullptr) {
 		return ACTOR_UNKNOWN;
 	}
 
-	CapturyActorStatus status = it->second.status;
+	CapturyActorStatus status = slot->data.status;
 
 	return status;
 }
 
+extern "C" uint64_t Captury_getActorChangeSequence(RemoteCaptury* rc)
+{
+	return rc->actorChanges.currentSequence();
+}
+
+extern "C" int Captury_getActorChanges(RemoteCaptury* rc, uint64_t since, CapturyActorChange* changes, int maxChanges)
+{
+	if (changes == nullptr && maxChanges > 0)
+		return 0;
+
+	return rc->actorChanges.get(since, changes, maxChanges);
+}
+
 extern "C" CapturyARTag* Captury_getCurrentARTags(RemoteCaptury* rc)
 {
 	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
@@ -2457,22 +4735,22 @@ extern "C" CapturyImage* Captury_getTexture(RemoteCaptury* rc, int actorId)
 	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
 
 	// check if we don't have a texture yet
-	std::unordered_map<int, ActorData>::iterator it = rc->actorData.find(actorId);
-	if (it == rc->actorData.end()) {
+	ActorSlot* slot = rc->actors.find(actorId);
+	if (slot == nullptr) {
 		return nullptr;
 	}
 
 	// create a copy of all data
-	const int size = it->second.currentTextures.width * it->second.currentTextures.height * 3;
+	const int size = slot->data.currentTextures.width * slot->data.currentTextures.height * 3;
 	CapturyImage* image = (CapturyImage*)malloc(sizeof(CapturyImage) + size);
-	image->width = it->second.currentTextures.width;
-	image->height = it->second.currentTextures.height;
+	image->width = slot->data.currentTextures.width;
+	image->height = slot->data.currentTextures.height;
 	image->camera = -1;
 	image->timestamp = 0;
 	image->data = (unsigned char*)&image[1];
 	image->gpuData = nullptr;
 
-	memcpy(image->data, it->second.currentTextures.data, size);
+	memcpy(image->data, slot->data.currentTextures.data, size);
 
 	return image;
 }
@@ -2521,18 +4799,19 @@ extern "C" uint64_t Captury_getMarkerTransform(RemoteCaptury* rc, int actorId, i
 extern "C" int Captury_getScalingProgress(RemoteCaptury* rc, int actorId)
 {
 	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
-	int scaling = rc->actorData.count(actorId) ? rc->actorData[actorId].scalingProgress : 0;
+	ActorSlot* slot = rc->actors.find(actorId);
+	int scaling = (slot != nullptr) ? slot->data.scalingProgress : 0;
 	return scaling;
 }
 
 extern "C" int Captury_getTrackingQuality(RemoteCaptury* rc, int actorId)
 {
 	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
-	auto it = rc->actorData.find(actorId);
-	if (it == rc->actorData.end()) {
+	ActorSlot* slot = rc->actors.find(actorId);
+	if (slot == nullptr) {
 		return 0;
 	}
-	int quality = it->second.trackingQuality;
+	int quality = slot->data.trackingQuality;
 
 	return quality;
 }
@@ -2625,19 +4904,27 @@ static void* syncLoop(void* arg)
 #endif
 {
 	RemoteCaptury* rc = (RemoteCaptury*)arg;
+
+	while (!rc->stopSyncThread) {
+		rc->requestTime();
+
+		// wake up often enough that Captury_destroy() does not have to wait long
+		for (int i = 0; i < 10 && !rc->stopSyncThread; ++i)
+			sleepMicroSeconds(100000);
+	}
+	return 0;
+}
+
+void RemoteCaptury::requestTime()
+{
 	CapturyTimePacket2 packet;
 	packet.type = capturyGetTime2;
 	packet.size = sizeof(packet);
+	++nextTimeId;
+	packet.timeId = nextTimeId;
 
-	while (true) {
-		++rc->nextTimeId;
-		packet.timeId = rc->nextTimeId;
-
-		rc->pingTime = getTime();
-		rc->sendPacket((CapturyRequestPacket*)&packet, capturyTime2);
-
-		sleepMicroSeconds(1000000);
-	}
+	pingTime = getTime();
+	sendPacket((CapturyRequestPacket*)&packet, capturyTime2);
 }
 
 extern "C" void Captury_startTimeSynchronizationLoop(RemoteCaptury* rc)
@@ -2645,10 +4932,34 @@ extern "C" void Captury_startTimeSynchronizationLoop(RemoteCaptury* rc)
 	if (rc->syncLoopIsRunning)
 		return;
 
-	rc->syncThread = std::thread(syncLoop, rc);
+	if (rc->ioLoop != nullptr) {
+		rc->ioLoop->run([rc]() {
+			rc->requestTime();
+			rc->syncTimer = rc->ioLoop->addTimer(1000000, [rc]() { rc->requestTime(); });
+		});
+	} else
+		rc->syncThread = std::thread(syncLoop, rc);
 	rc->syncLoopIsRunning = true;
 }
 
+extern "C" int Captury_useSharedReactor(RemoteCaptury* rc, int numThreads)
+{
+	// the sockets cannot be moved between threads while they are in use
+	if (rc->sock != -1 || rc->receiveThread.joinable() || rc->streamThread.joinable())
+		return 0;
+
+	if (numThreads <= 0) {
+		rc->leaveReactor();
+		return 1;
+	}
+
+	if (rc->ioLoop == nullptr) {
+		rc->reactor = IoReactor::acquire(numThreads);
+		rc->ioLoop = rc->reactor->assignLoop();
+	}
+	return 1;
+}
+
 extern "C" uint64_t Captury_synchronizeTime(RemoteCaptury* rc)
 {
 	CapturyTimePacket2 packet;
@@ -2672,9 +4983,120 @@ extern "C" uint64_t Captury_synchronizeTime(RemoteCaptury* rc)
 
 extern "C" int64_t Captury_getTimeOffset(RemoteCaptury* rc)
 {
+	// currentSync.offset is the offset at local time 0 which is meaningless if the clocks drift
+	const uint64_t localT = getTime();
+	return (int64_t)(rc->getRemoteTime(localT) - localT);
+}
+
+extern "C" int Captury_getTimeSyncStats(RemoteCaptury* rc, CapturyTimeSyncStats* stats)
+{
+	if (stats == nullptr)
+		return 0;
+
 	std::lock_guard<std::mutex> syncLock(rc->syncMutex);
-	int64_t offset = (int64_t)rc->currentSync.offset;
-	return offset;
+	const uint64_t localT = getTime();
+	rc->clockSync.getStats(stats, localT);
+	// Captury_getTime() may still be on its way towards the estimate
+	const int64_t pending = (int64_t)(rc->currentSync.getRemoteTime(localT) - rc->getRemoteTime(localT));
+	stats->errorBound += (uint32_t)std::min<int64_t>(std::abs(pending), UINT32_MAX - stats->errorBound);
+	return rc->isSynchronized ? 1 : 0;
+}
+
+extern "C" int Captury_startPacketCapture(RemoteCaptury* rc, const char* filename)
+{
+	return rc->startPacketCapture(filename) ? 1 : 0;
+}
+
+extern "C" void Captury_stopPacketCapture(RemoteCaptury* rc)
+{
+	rc->stopPacketCapture();
+}
+
+extern "C" int Captury_replayPacketCapture(RemoteCaptury* rc, const char* filename, double speed)
+{
+	return rc->replay(filename, speed) ? 1 : 0;
+}
+
+extern "C" void Captury_getStats(RemoteCaptury* rc, CapturyStats* stats)
+{
+	rc->receiveToParse.get(&stats->receiveToParse);
+	rc->parseToCallback.get(&stats->parseToCallback);
+	rc->callbackToConsumed.get(&stats->callbackToConsumed);
+	stats->numPoses = rc->numPosesReceived;
+	stats->numDroppedPoses = rc->numDroppedPoses;
+	stats->numReassemblyFailures = rc->numReassemblyFailures;
+	stats->numReassembledPoses = rc->numReassembledPoses;
+	stats->numExpiredFragments = rc->numExpiredFragments;
+	stats->numDuplicateFragments = rc->numDuplicateFragments;
+}
+
+extern "C" int Captury_getActorStats(RemoteCaptury* rc, int actorId, CapturyActorStats* stats)
+{
+	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
+	ActorSlot* slot = rc->actors.find(actorId);
+	if (slot == nullptr)
+		return 0;
+
+	stats->numPoses = slot->data.numPoses;
+	stats->numDroppedPoses = slot->data.numDroppedPoses;
+	stats->numReassemblyFailures = slot->data.numReassemblyFailures;
+	return 1;
+}
+
+extern "C" void Captury_resetStats(RemoteCaptury* rc)
+{
+	rc->receiveToParse.reset();
+	rc->parseToCallback.reset();
+	rc->callbackToConsumed.reset();
+	rc->numPosesReceived = 0;
+	rc->numDroppedPoses = 0;
+	rc->numReassemblyFailures = 0;
+	rc->numReassembledPoses = 0;
+	rc->numExpiredFragments = 0;
+	rc->numDuplicateFragments = 0;
+
+	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
+	for (ActorSlot& slot : rc->actors) {
+		slot.data.numPoses = 0;
+		slot.data.numDroppedPoses = 0;
+		slot.data.numReassemblyFailures = 0;
+	}
+}
+
+extern "C" int Captury_setActorTimeout(RemoteCaptury* rc, uint64_t timeout)
+{
+	if (timeout == 0)
+		return 0;
+
+	std::lock_guard<std::mutex> mainLock(rc->mainMutex);
+	rc->liveness.setTimeout(timeout);
+	for (ActorSlot& slot : rc->actors) {
+		if (slot.data.livenessScheduled)
+			rc->liveness.schedule(slot.id, slot.data.lastPoseTimestamp + timeout);
+	}
+	return 1;
+}
+
+extern "C" int Captury_setReassemblyLimits(RemoteCaptury* rc, int maxPosesInFlight, uint64_t timeout)
+{
+	if (maxPosesInFlight < 1 || timeout == 0)
+		return 0;
+
+	rc->maxPosesInFlight = maxPosesInFlight;
+	rc->reassemblyTimeout = timeout;
+	return 1;
+}
+
+extern "C" void Captury_getStreamBatchStatistics(RemoteCaptury* rc, uint64_t* numWakeups, uint64_t* numDatagrams, int* lastBatchSize, int* maxBatchSize)
+{
+	if (numWakeups != nullptr)
+		*numWakeups = rc->numStreamWakeups;
+	if (numDatagrams != nullptr)
+		*numDatagrams = rc->numStreamDatagrams;
+	if (lastBatchSize != nullptr)
+		*lastBatchSize = rc->lastStreamBatchSize;
+	if (maxBatchSize != nullptr)
+		*maxBatchSize = rc->maxStreamBatchSize;
 }
 
 extern "C" void Captury_getFramerate(RemoteCaptury* rc, int* numerator, int* denominator)
@@ -2683,14 +5105,38 @@ extern "C" void Captury_getFramerate(RemoteCaptury* rc, int* numerator, int* den
 	packet.type = capturyGetFramerate;
 	packet.size = sizeof(packet);
 
-	if (!rc->sendPacket((CapturyRequestPacket*)&packet, capturyFramerate)) {
+	// a replay has no server to ask but the capture contains the answer
+	if (!rc->replaying && !rc->sendPacket((CapturyRequestPacket*)&packet, capturyFramerate)) {
 		*numerator = -1;
 		*denominator = -1;
 		return;
 	}
 
-	*numerator = rc->framerateNumerator;
-	*denominator = rc->framerateDenominator;
+	rc->getFramerate(numerator, denominator);
+}
+
+extern "C" int Captury_getCachedFramerate(RemoteCaptury* rc, int* numerator, int* denominator)
+{
+	rc->getFramerate(numerator, denominator);
+	return (*numerator > 0 && *denominator > 0) ? 1 : 0;
+}
+
+int Captury_registerFramerateChangedCallback(RemoteCaptury* rc, CapturyFramerateChangedCallback callback, void* userArg)
+{
+	if (rc->framerateChangedCallback != NULL) { // callback already exists
+		if (callback == NULL) { // remove callback
+			rc->framerateChangedCallback = NULL;
+			return 1;
+		} else
+			return 0;
+	}
+
+	if (callback == NULL) // trying to erase callback that is not there
+		return 0;
+
+	rc->framerateChangedArg = userArg;
+	rc->framerateChangedCallback = callback;
+	return 1;
 }
 
 int Captury_registerNewPoseCallback(RemoteCaptury* rc, CapturyNewPoseCallback callback, void* userArg)
@@ -2793,20 +5239,89 @@ int Captury_registerImageStreamingCallback(RemoteCaptury* rc, CapturyImageCallba
 #define RAD2DEGf		(57.29577951308232088f)
 #endif
 
-// initialize complete 4x4 matrix with rotation from euler angles and translation from translation vector
-static float* transformationMatrix(const float* eulerAngles, const float* translation, float* m4x4) // checked
+//
+// batch conversion of XYZ Euler angles (in degrees) to quaternions q = qz * qy * qx
+//
+// with c = cos(angle/2) and s = sin(angle/2):
+// w = cz*cy*cx + sz*sy*sx
+// x = cz*cy*sx - sz*sy*cx
+// y = cz*sy*cx + sz*cy*sx
+// z = sz*cy*cx - cz*sy*sx
+//
+// the vectorized version computes sine and cosine with the cephes polynomials after
+// reducing the argument to [-pi/4, pi/4]
+//
+#ifdef CAPTURY_SIMD_WIDTH
+static inline void vsincos(vfloat x, vfloat* sine, vfloat* cosine)
+{
+	// x = j * pi/2 + r with r in [-pi/4, pi/4]
+	vint j = vround(vmul(x, vset(0.63661977236758134f))); // 2/pi
+	vfloat fj = vtofloat(j);
+	vfloat r = vsub(x, vmul(fj, vset(1.5703125f)));
+	r = vsub(r, vmul(fj, vset(4.837512969970703125e-4f)));
+	r = vsub(r, vmul(fj, vset(7.54978995489188216e-8f)));
+	vfloat r2 = vmul(r, r);
+
+	vfloat s = vset(-1.9515295891e-4f);
+	s = vadd(vmul(s, r2), vset(8.3321608736e-3f));
+	s = vadd(vmul(s, r2), vset(-1.6666654611e-1f));
+	s = vadd(vmul(vmul(s, r2), r), r);
+
+	vfloat c = vset(2.443315711809948e-5f);
+	c = vadd(vmul(c, r2), vset(-1.388731625493765e-3f));
+	c = vadd(vmul(c, r2), vset(4.166664568298827e-2f));
+	c = vadd(vmul(vmul(c, r2), r2), vsub(vset(1.0f), vmul(r2, vset(0.5f))));
+
+	// pick the right polynomial and sign depending on the quadrant
+	vfloat swap = vbitmask(j, 1);
+	vfloat signBit = vset(-0.0f);
+	*sine = vxor(vselect(swap, c, s), vand(vbitmask(j, 2), signBit));
+	*cosine = vxor(vselect(swap, s, c), vand(vbitmask(vaddi(j, 1), 2), signBit));
+}
+#endif
+
+extern "C" void Captury_eulerToQuaternions(const CapturyTransform* transforms, int numTransforms, float* qx, float* qy, float* qz, float* qw)
 {
-	float c3 = std::cos(eulerAngles[0] * DEG2RADf);
-	float s3 = std::sin(eulerAngles[0] * DEG2RADf);
-	float c2 = std::cos(eulerAngles[1] * DEG2RADf);
-	float s2 = std::sin(eulerAngles[1] * DEG2RADf);
-	float c1 = std::cos(eulerAngles[2] * DEG2RADf);
-	float s1 = std::sin(eulerAngles[2] * DEG2RADf);
+	constexpr float halfDeg2Rad = 0.5f * 0.0174532925199432958f;
+	int i = 0;
+#ifdef CAPTURY_SIMD_WIDTH
+	constexpr int stride = sizeof(CapturyTransform) / sizeof(float);
+	for ( ; i + CAPTURY_SIMD_WIDTH <= numTransforms; i += CAPTURY_SIMD_WIDTH) {
+		const float* rot = transforms[i].rotation;
+		vfloat sx, cx, sy, cy, sz, cz;
+		vsincos(vmul(vload(rot, stride), vset(halfDeg2Rad)), &sx, &cx);
+		vsincos(vmul(vload(rot+1, stride), vset(halfDeg2Rad)), &sy, &cy);
+		vsincos(vmul(vload(rot+2, stride), vset(halfDeg2Rad)), &sz, &cz);
+
+		vfloat czcy = vmul(cz, cy);
+		vfloat szsy = vmul(sz, sy);
+		vfloat czsy = vmul(cz, sy);
+		vfloat szcy = vmul(sz, cy);
+		vstore(qw + i, vadd(vmul(czcy, cx), vmul(szsy, sx)));
+		vstore(qx + i, vsub(vmul(czcy, sx), vmul(szsy, cx)));
+		vstore(qy + i, vadd(vmul(czsy, cx), vmul(szcy, sx)));
+		vstore(qz + i, vsub(vmul(szcy, cx), vmul(czsy, sx)));
+	}
+#endif
+	for ( ; i < numTransforms; ++i) {
+		const float* rot = transforms[i].rotation;
+		float sx = std::sin(rot[0] * halfDeg2Rad), cx = std::cos(rot[0] * halfDeg2Rad);
+		float sy = std::sin(rot[1] * halfDeg2Rad), cy = std::cos(rot[1] * halfDeg2Rad);
+		float sz = std::sin(rot[2] * halfDeg2Rad), cz = std::cos(rot[2] * halfDeg2Rad);
+		qw[i] = cz*cy*cx + sz*sy*sx;
+		qx[i] = cz*cy*sx - sz*sy*cx;
+		qy[i] = cz*sy*cx + sz*cy*sx;
+		qz[i] = sz*cy*cx - cz*sy*sx;
+	}
+}
 
-	m4x4[0]  = c1*c2; m4x4[1]  = c1*s2*s3-c3*s1; m4x4[2]  = s1*s3+c1*c3*s2; m4x4[3]  = translation[0];
-	m4x4[4]  = c2*s1; m4x4[5]  = c1*c3+s1*s2*s3; m4x4[6]  = c3*s1*s2-c1*s3; m4x4[7]  = translation[1];
-	m4x4[8]  = -s2;   m4x4[9]  = c2*s3;          m4x4[10] = c2*c3;          m4x4[11] = translation[2];
-	m4x4[12] = 0.0f;  m4x4[13] = 0.0f;           m4x4[14] = 0.0f;           m4x4[15] = 1.0f;
+// initialize complete 4x4 matrix with rotation from a quaternion and translation from translation vector
+static float* transformationMatrix(float x, float y, float z, float w, const float* translation, float* m4x4)
+{
+	m4x4[0]  = 1.0f - 2.0f*(y*y + z*z); m4x4[1]  = 2.0f*(x*y - z*w);        m4x4[2]  = 2.0f*(x*z + y*w);        m4x4[3]  = translation[0];
+	m4x4[4]  = 2.0f*(x*y + z*w);        m4x4[5]  = 1.0f - 2.0f*(x*x + z*z); m4x4[6]  = 2.0f*(y*z - x*w);        m4x4[7]  = translation[1];
+	m4x4[8]  = 2.0f*(x*z - y*w);        m4x4[9]  = 2.0f*(y*z + x*w);        m4x4[10] = 1.0f - 2.0f*(x*x + y*y); m4x4[11] = translation[2];
+	m4x4[12] = 0.0f;                    m4x4[13] = 0.0f;                    m4x4[14] = 0.0f;                    m4x4[15] = 1.0f;
 
 	return m4x4;
 }
@@ -2878,14 +5393,17 @@ static void decompose(const float* mat, float* euler) // checked
 
 void Captury_convertPoseToLocal(RemoteCaptury* rc, CapturyPose* pose, int actorId) REQUIRES(rc->mutex)
 {
-	if (rc->actorsById.count(actorId) == 0)
+	ActorSlot* slot = rc->actors.find(actorId);
+	if (slot == nullptr || !slot->actor)
 		return;
 
-	CapturyActor* actor = rc->actorsById[actorId].get();
+	CapturyActor* actor = slot->actor.get();
 	CapturyTransform* at = pose->transforms;
-	float* matrices = (float*)malloc(sizeof(float) * 16 * actor->numJoints);
+	float* matrices = (float*)malloc(sizeof(float) * (16 + 4) * actor->numJoints);
+	float* quats = matrices + 16 * actor->numJoints;
+	Captury_eulerToQuaternions(pose->transforms, actor->numJoints, quats, quats + actor->numJoints, quats + 2*actor->numJoints, quats + 3*actor->numJoints);
 	for (int i = 0; i < actor->numJoints; ++i, ++at) {
-		transformationMatrix(at->rotation, at->translation, &matrices[i*16]);
+		transformationMatrix(quats[i], quats[actor->numJoints+i], quats[2*actor->numJoints+i], quats[3*actor->numJoints+i], at->translation, &matrices[i*16]);
 // 		float out[6];
 // 		decompose(&matrices[i*16], out+3);
 // 		log("% .4f % .4f % .4f\n", at[3], at[4], at[5]);
@@ -31,6 +31,14 @@ CAPTURY_DLL_EXPORT int Captury_connect(RemoteCaptury* rc, const char* ip, unsign
 // if async != 0, the function will return immediately and perform the connection attempt asynchronously
 CAPTURY_DLL_EXPORT int Captury_connect2(RemoteCaptury* rc, const char* ip, unsigned short port, unsigned short localPort, unsigned short localStreamPort, int async);
 
+// by default every RemoteCaptury runs its own receive, stream and time synchronization threads.
+// with a shared reactor the sockets and timers of all RemoteCaptury instances that use it are served by
+// numThreads event loop threads instead. the callbacks are then called from those threads.
+// the reactor is created with numThreads threads by the first call, later calls share it.
+// numThreads <= 0 goes back to the dedicated threads.
+// has to be called before connecting. returns 1 if successful, 0 otherwise
+CAPTURY_DLL_EXPORT int Captury_useSharedReactor(RemoteCaptury* rc, int numThreads);
+
 // returns 1 if successful, 0 otherwise
 CAPTURY_DLL_EXPORT int Captury_disconnect(RemoteCaptury* rc);
 
@@ -170,6 +178,32 @@ CAPTURY_DLL_EXPORT CapturyPose* Captury_clonePose(const CapturyPose* pose);
 // simple function for releasing memory of a pose
 CAPTURY_DLL_EXPORT void Captury_freePose(CapturyPose* pose);
 
+// returns the most recent pose of the actor without copying it or NULL if there is none yet
+// the pose stays valid and unchanged until it is handed back with Captury_releasePoseView()
+// the stream thread decodes new poses into other memory in the mean time so do not hold on to too many views
+CAPTURY_DLL_EXPORT const CapturyPose* Captury_acquirePoseView(RemoteCaptury* rc, int actorId, int* trackingQuality);
+// the pose passed to the new pose callback is a view, too. it is valid until the callback returns
+// unless it is retained with this function in which case it has to be released with Captury_releasePoseView()
+CAPTURY_DLL_EXPORT void Captury_retainPoseView(RemoteCaptury* rc, const CapturyPose* pose);
+CAPTURY_DLL_EXPORT void Captury_releasePoseView(RemoteCaptury* rc, const CapturyPose* pose);
+// tells the library that the application is done with a pose it got from the new pose callback, e.g. forwarded it.
+// the time since the callback is reported as callbackToConsumed by Captury_getStats(). call it before the view is released.
+CAPTURY_DLL_EXPORT void Captury_poseConsumed(RemoteCaptury* rc, const CapturyPose* pose);
+
+// returns the poses of all actors for the most recent complete frame in one block or NULL if there is none yet
+// a frame is complete when every tracked actor has sent its pose or when the next frame starts
+// frames are only assembled once this function has been called so the first call usually returns NULL
+// the snapshot stays valid and unchanged until it is handed back with Captury_releaseFrameSnapshot()
+CAPTURY_DLL_EXPORT const CapturyFrameSnapshot* Captury_getFrameSnapshot(RemoteCaptury* rc);
+CAPTURY_DLL_EXPORT void Captury_releaseFrameSnapshot(RemoteCaptury* rc, const CapturyFrameSnapshot* snapshot);
+
+// same as Captury_getFrameSnapshot() but with the poses of all actors stored as structure of arrays
+// so that consumers of many actors can run through the joints linearly
+// frames are only converted once this function has been called so the first call usually returns NULL
+// the arrays stay valid and unchanged until they are handed back with Captury_releaseFrameArrays()
+CAPTURY_DLL_EXPORT const CapturyFrameArrays* Captury_getFrameArrays(RemoteCaptury* rc);
+CAPTURY_DLL_EXPORT void Captury_releaseFrameArrays(RemoteCaptury* rc, const CapturyFrameArrays* arrays);
+
 typedef void (*CapturyNewPoseCallback)(RemoteCaptury*, CapturyActor*, CapturyPose*, int trackingQuality, void* userArg);
 
 // register callback that will be called when a new pose is received
@@ -199,6 +233,21 @@ CAPTURY_DLL_EXPORT int Captury_getActorStatus(RemoteCaptury* rc, int actorId);
 // returns 1 if successful otherwise 0
 CAPTURY_DLL_EXPORT int Captury_registerActorChangedCallback(RemoteCaptury* rc, CapturyActorChangedCallback callback, void* userArg);
 
+// every time an actor starts scaling or tracking (added), receives a new definition while doing so (changed)
+// or stops or is deleted (removed) the change is numbered and stored so that it can be polled
+// instead of or in addition to registering a callback
+typedef enum { CAPTURY_ACTOR_ADDED = 0, CAPTURY_ACTOR_CHANGED = 1, CAPTURY_ACTOR_REMOVED = 2 } CapturyActorChangeType;
+
+// returns the sequence number of the most recent change or 0 if there was none yet
+// this does not lock anything and can be called every frame.
+CAPTURY_DLL_EXPORT uint64_t Captury_getActorChangeSequence(RemoteCaptury* rc);
+
+// copies up to maxChanges changes with a sequence number larger than since in order to changes
+// returns the number of changes copied or -1 if changes after since have already been dropped
+// in that case get the full list with Captury_getActors() and continue from Captury_getActorChangeSequence() called before
+// only the most recent 4096 changes are kept
+CAPTURY_DLL_EXPORT int Captury_getActorChanges(RemoteCaptury* rc, uint64_t since, CapturyActorChange* changes, int maxChanges);
+
 typedef void (*CapturyARTagCallback)(RemoteCaptury*, int num, CapturyARTag*, void* userArg);
 
 // register callback that will be called when an artag is detected
@@ -251,7 +300,7 @@ CAPTURY_DLL_EXPORT void Captury_freeImage(CapturyImage* image);
 // returns the current time in microseconds
 CAPTURY_DLL_EXPORT uint64_t Captury_synchronizeTime(RemoteCaptury* rc);
 
-// start a thread that continuously synchronizes the time with Captury Live
+// start a thread (or a timer on the shared reactor) that continuously synchronizes the time with Captury Live
 // if this is running it is not necessary to call Captury_synchronizeTime()
 CAPTURY_DLL_EXPORT void Captury_startTimeSynchronizationLoop(RemoteCaptury* rc);
 
@@ -262,9 +311,64 @@ CAPTURY_DLL_EXPORT uint64_t Captury_getTime(RemoteCaptury* rc);
 // offset = CapturyLive.time - local.time
 CAPTURY_DLL_EXPORT int64_t Captury_getTimeOffset(RemoteCaptury* rc);
 
-// returns the current tracking framerate
+// fills in how well the local clock is synchronized with Captury Live
+// the remote time returned by Captury_getTime() follows a new estimate slowly (at most 0.5ms per second)
+// so that it never jumps. only the first estimate and corrections of more than 0.1s are applied at once.
+// the error bound holds for the remote time right now. it grows the longer no time request is answered.
+// returns 1 if the time has been synchronized at least once, 0 otherwise
+CAPTURY_DLL_EXPORT int Captury_getTimeSyncStats(RemoteCaptury* rc, CapturyTimeSyncStats* stats);
+
+// asks Captury Live for the current tracking framerate and returns the last one that was received
+// the reply arrives asynchronously. use Captury_getCachedFramerate() unless the framerate must be refreshed.
 CAPTURY_DLL_EXPORT void Captury_getFramerate(RemoteCaptury* rc, int* numerator, int* denominator);
 
+// returns the tracking framerate that was received during the handshake or since
+// this causes no network traffic and is safe to call for every pose
+// returns 1 if the framerate is known otherwise 0 (and -1/-1)
+CAPTURY_DLL_EXPORT int Captury_getCachedFramerate(RemoteCaptury* rc, int* numerator, int* denominator);
+
+typedef void (*CapturyFramerateChangedCallback)(RemoteCaptury* rc, int numerator, int denominator, void* userArg);
+
+// register callback that will be called when the framerate is first received and whenever it changes
+// it is called on the thread that reads the TCP socket
+// returns 1 if successful otherwise 0
+CAPTURY_DLL_EXPORT int Captury_registerFramerateChangedCallback(RemoteCaptury* rc, CapturyFramerateChangedCallback callback, void* userArg);
+
+// client side statistics: how long the stages between receiving a packet and calling the new pose callback take,
+// and how many poses were dropped or could not be reassembled. the totals are over all actors.
+CAPTURY_DLL_EXPORT void Captury_getStats(RemoteCaptury* rc, CapturyStats* stats);
+// returns 1 if successful, 0 if the actor has not sent any poses yet
+CAPTURY_DLL_EXPORT int Captury_getActorStats(RemoteCaptury* rc, int actorId, CapturyActorStats* stats);
+CAPTURY_DLL_EXPORT void Captury_resetStats(RemoteCaptury* rc);
+
+// actors that are scaling or tracking are marked as stopped when they have not received a pose for timeout microseconds (default: 500000us)
+// the actor changed callback is called for them
+// returns 1 if successful otherwise 0
+CAPTURY_DLL_EXPORT int Captury_setActorTimeout(RemoteCaptury* rc, uint64_t timeout);
+
+// poses that do not fit into one packet are split into several packets and put back together by the library
+// up to maxPosesInFlight incomplete poses per actor are kept for at most timeout microseconds
+// so that the packets of consecutive poses may arrive interleaved (defaults: 8 poses, 100000us)
+// returns 1 if successful otherwise 0
+CAPTURY_DLL_EXPORT int Captury_setReassemblyLimits(RemoteCaptury* rc, int maxPosesInFlight, uint64_t timeout);
+
+// record every packet received on the TCP and the stream socket to filename
+// an index of the packets is written to filename.idx
+// returns 1 if successful, 0 otherwise
+CAPTURY_DLL_EXPORT int Captury_startPacketCapture(RemoteCaptury* rc, const char* filename);
+CAPTURY_DLL_EXPORT void Captury_stopPacketCapture(RemoteCaptury* rc);
+
+// instead of connecting to Captury Live feed a packet capture through the regular packet handling
+// speed 1 replays in real time, 2 twice as fast, 0 as fast as possible
+// the replay runs in the background until the end of the capture or Captury_disconnect()
+// returns 1 if successful, 0 otherwise
+CAPTURY_DLL_EXPORT int Captury_replayPacketCapture(RemoteCaptury* rc, const char* filename, double speed);
+
+// returns how well the stream socket is drained in batches
+// numDatagrams / numWakeups is the average number of datagrams received per system call
+// any of the pointers may be NULL
+CAPTURY_DLL_EXPORT void Captury_getStreamBatchStatistics(RemoteCaptury* rc, uint64_t* numWakeups, uint64_t* numDatagrams, int* lastBatchSize, int* maxBatchSize);
+
 // get the last error message
 CAPTURY_DLL_EXPORT char* Captury_getLastErrorMessage(RemoteCaptury* rc);
 CAPTURY_DLL_EXPORT void Captury_freeErrorMessage(char* msg);
@@ -334,6 +438,11 @@ CAPTURY_DLL_EXPORT int Captury_getCurrentLatency(RemoteCaptury* rc, CapturyLaten
 // convert the pose given in global coordinates into local coordinates
 CAPTURY_DLL_EXPORT void Captury_convertPoseToLocal(RemoteCaptury* rc, CapturyPose* pose, int actorId);
 
+// convert the XYZ Euler angles of numTransforms transforms into quaternions q = qz * qy * qx
+// the quaternions are returned as structure of arrays: each output array must hold numTransforms floats
+// uses SSE/AVX2 where available
+CAPTURY_DLL_EXPORT void Captury_eulerToQuaternions(const CapturyTransform* transforms, int numTransforms, float* qx, float* qy, float* qz, float* qw);
+
 
 typedef void (*CapturyBackgroundFinishedCallback)(RemoteCaptury*, void* userData);
 
@@ -12,6 +12,7 @@
 #include "CoreGlobals.h"
 #include "Misc/ConfigCacheIni.h"
 #include "Misc/EngineVersionComparison.h"
+#include "Misc/Paths.h"
 
 #undef SetPort
 #include "SocketSubsystem.h"
@@ -26,6 +27,9 @@ FText SCapturySourceConfigWidget::initialIP = LOCTEXT("127.0.0.1", "127.0.0.1");
 bool SCapturySourceConfigWidget::useTCP = false;
 bool SCapturySourceConfigWidget::streamARTags = true;
 bool SCapturySourceConfigWidget::streamCompressed = false;
+bool SCapturySourceConfigWidget::convertOnWorkerThread = false;
+bool SCapturySourceConfigWidget::sharedIOThread = false;
+bool SCapturySourceConfigWidget::useCaptureTime = false;
 
 BEGIN_SLATE_FUNCTION_BUILD_OPTIMIZATION
 void SCapturySourceConfigWidget::Construct(const FArguments& InArgs)
@@ -36,11 +40,17 @@ void SCapturySourceConfigWidget::Construct(const FArguments& InArgs)
 	GConfig->GetBool(*section, TEXT("UseTCP"), useTCP, GEditorSettingsIni);
 	GConfig->GetBool(*section, TEXT("StreamARTags"), streamARTags, GEditorSettingsIni);
 	GConfig->GetBool(*section, TEXT("StreamCompressed"), streamCompressed, GEditorSettingsIni);
+	GConfig->GetBool(*section, TEXT("ConvertOnWorkerThread"), convertOnWorkerThread, GEditorSettingsIni);
+	GConfig->GetBool(*section, TEXT("SharedIOThread"), sharedIOThread, GEditorSettingsIni);
+	GConfig->GetBool(*section, TEXT("UseCaptureTime"), useCaptureTime, GEditorSettingsIni);
 	#else
 	initialIP =        GConfig->GetTextOrDefault(*section, TEXT("IP"), LOCTEXT("127.0.0.1", "127.0.0.1"), GEditorSettingsIni);
 	useTCP =           GConfig->GetBoolOrDefault(*section, TEXT("UseTCP"), false, GEditorSettingsIni);
 	streamARTags =     GConfig->GetBoolOrDefault(*section, TEXT("StreamARTags"), true, GEditorSettingsIni);
 	streamCompressed = GConfig->GetBoolOrDefault(*section, TEXT("StreamCompressed"), false, GEditorSettingsIni);
+	convertOnWorkerThread = GConfig->GetBoolOrDefault(*section, TEXT("ConvertOnWorkerThread"), false, GEditorSettingsIni);
+	sharedIOThread =   GConfig->GetBoolOrDefault(*section, TEXT("SharedIOThread"), false, GEditorSettingsIni);
+	useCaptureTime =   GConfig->GetBoolOrDefault(*section, TEXT("UseCaptureTime"), false, GEditorSettingsIni);
 	#endif
 
 	ChildSlot.Padding(4,6,0,6)
@@ -83,12 +93,39 @@ void SCapturySourceConfigWidget::Construct(const FArguments& InArgs)
 		    SNew(SCheckBox).IsChecked(streamCompressed)
 		    .OnCheckStateChanged(this, &SCapturySourceConfigWidget::streamCompressedChanged)
 		]
-		+ SGridPanel::Slot(0, 4).Padding(4, 2).VAlign(VAlign_Center)
+		+ SGridPanel::Slot(0, 4).Padding(4, 2)
+		[
+		    SNew(STextBlock).Text(LOCTEXT("ConvertOnWorkerThread", "Convert on Worker Thread:"))
+		]
+		+ SGridPanel::Slot(1, 4).Padding(4, 2)
+		[
+		    SNew(SCheckBox).IsChecked(convertOnWorkerThread)
+		    .OnCheckStateChanged(this, &SCapturySourceConfigWidget::convertOnWorkerThreadChanged)
+		]
+		+ SGridPanel::Slot(0, 5).Padding(4, 2)
+		[
+		    SNew(STextBlock).Text(LOCTEXT("SharedIOThread", "Shared I/O Thread:"))
+		]
+		+ SGridPanel::Slot(1, 5).Padding(4, 2)
+		[
+		    SNew(SCheckBox).IsChecked(sharedIOThread)
+		    .OnCheckStateChanged(this, &SCapturySourceConfigWidget::sharedIOThreadChanged)
+		]
+		+ SGridPanel::Slot(0, 6).Padding(4, 2)
+		[
+		    SNew(STextBlock).Text(LOCTEXT("UseCaptureTime", "Use Capture Time:"))
+		]
+		+ SGridPanel::Slot(1, 6).Padding(4, 2)
+		[
+		    SNew(SCheckBox).IsChecked(useCaptureTime)
+		    .OnCheckStateChanged(this, &SCapturySourceConfigWidget::useCaptureTimeChanged)
+		]
+		+ SGridPanel::Slot(0, 7).Padding(4, 2).VAlign(VAlign_Center)
 		[
 		    SNew(STextBlock).Text(LOCTEXT("Version", CAPTURY_LIVELINK_VERSION))
 		    .Font(FSlateFontInfo(FCoreStyle::GetDefaultFont(), 8))
 		]
-		+ SGridPanel::Slot(1, 4).Padding(4, 2)
+		+ SGridPanel::Slot(1, 7).Padding(4, 2)
 		[
 		    SNew(SButton).Text(LOCTEXT("OK", "Connect")).HAlign(HAlign_Center)
 		    .OnClicked(this, &SCapturySourceConfigWidget::okClicked)
@@ -119,11 +156,26 @@ void SCapturySourceConfigWidget::streamCompressedChanged(ECheckBoxState newState
 	streamCompressed = (newState == ECheckBoxState::Checked);
 }
 
+void SCapturySourceConfigWidget::convertOnWorkerThreadChanged(ECheckBoxState newState)
+{
+	convertOnWorkerThread = (newState == ECheckBoxState::Checked);
+}
+
+void SCapturySourceConfigWidget::sharedIOThreadChanged(ECheckBoxState newState)
+{
+	sharedIOThread = (newState == ECheckBoxState::Checked);
+}
+
+void SCapturySourceConfigWidget::useCaptureTimeChanged(ECheckBoxState newState)
+{
+	useCaptureTime = (newState == ECheckBoxState::Checked);
+}
+
 void SCapturySourceConfigWidget::openSource(const FText & InText, ETextCommit::Type type)
 {
 	switch (type) {
 	case ETextCommit::OnEnter: {
-		FString connectionString = FString::Printf(TEXT("%s;%d;%d;%d"), *InText.ToString(), useTCP, streamARTags, streamCompressed);
+		FString connectionString = FString::Printf(TEXT("%s;%d;%d;%d;%d;%d;%d"), *InText.ToString(), useTCP, streamARTags, streamCompressed, convertOnWorkerThread, sharedIOThread, useCaptureTime);
 		TSharedPtr<ILiveLinkSource> src = createSource(connectionString);
 		callback.Execute(src, connectionString);
 		initialIP = InText;
@@ -145,9 +197,15 @@ TSharedPtr<ILiveLinkSource> SCapturySourceConfigWidget::createSource(const FStri
 	bool tcp = (configs.Num() >= 2) ? configs[1].Equals(TEXT("1")) : useTCP;
 	bool artags = (configs.Num() >= 3) ? configs[2].Equals(TEXT("1")) : streamARTags;
 	bool compressed = (configs.Num() >= 4) ? configs[3].Equals(TEXT("1")) : streamCompressed;
+	bool worker = (configs.Num() >= 5) ? configs[4].Equals(TEXT("1")) : convertOnWorkerThread;
+	bool sharedIO = (configs.Num() >= 6) ? configs[5].Equals(TEXT("1")) : sharedIOThread;
+	bool captureTime = (configs.Num() >= 7) ? configs[6].Equals(TEXT("1")) : useCaptureTime;
 
 	FAddressInfoResult result = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->GetAddressInfo(*input, nullptr, EAddressInfoFlags::Default, NAME_None);
-	if (result.ReturnCode == SE_NO_ERROR) {
+	if (FPaths::FileExists(input)) { // packet capture to replay
+		ip = FText::FromString(input);
+		UE_LOG(LogTemp, Display, TEXT("CapturyLiveLink: replaying packet capture %s"), *input);
+	} else if (result.ReturnCode == SE_NO_ERROR) {
 		const TSharedRef<FInternetAddr>& addr = result.Results[0].Address;
 		ip = FText::FromString(addr->ToString(false));
 		UE_LOG(LogTemp, Display, TEXT("CapturyLiveLink: resolved host %s to %s"), *input, *ip.ToString());
@@ -158,7 +216,7 @@ TSharedPtr<ILiveLinkSource> SCapturySourceConfigWidget::createSource(const FStri
 
 	UE_LOG(LogTemp, Display, TEXT("CapturyLiveLink: create new source %s"), *in);
 
-	CapturyLiveLinkSource* src = new CapturyLiveLinkSource(ip, tcp, artags, compressed);
+	CapturyLiveLinkSource* src = new CapturyLiveLinkSource(ip, tcp, artags, compressed, worker, sharedIO, captureTime);
 	TSharedPtr<ILiveLinkSource> sharedPtr(src);
 	source = sharedPtr;
 
@@ -167,6 +225,9 @@ TSharedPtr<ILiveLinkSource> SCapturySourceConfigWidget::createSource(const FStri
 	GConfig->SetBool(*section, TEXT("UseTCP"), useTCP, GEditorSettingsIni);
 	GConfig->SetBool(*section, TEXT("StreamARTags"), streamARTags, GEditorSettingsIni);
 	GConfig->SetBool(*section, TEXT("StreamCompressed"), streamCompressed, GEditorSettingsIni);
+	GConfig->SetBool(*section, TEXT("ConvertOnWorkerThread"), convertOnWorkerThread, GEditorSettingsIni);
+	GConfig->SetBool(*section, TEXT("SharedIOThread"), sharedIOThread, GEditorSettingsIni);
+	GConfig->SetBool(*section, TEXT("UseCaptureTime"), useCaptureTime, GEditorSettingsIni);
 	GConfig->Flush(false, GEditorSettingsIni);
 
 	return sharedPtr;
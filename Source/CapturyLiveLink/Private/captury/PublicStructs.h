@@ -210,6 +210,80 @@ struct CapturyLatencyInfo {
 	uint64_t	timestampOfCorrespondingPose;
 };
 
+// distribution of the time spent in one stage of the client side pose pipeline
+struct CapturyStageStats {
+	uint64_t	count;
+	uint64_t	meanNs;
+	uint64_t	p50Ns;
+	uint64_t	p99Ns;
+	uint64_t	p999Ns;
+	uint64_t	maxNs;
+};
+
+struct CapturyStats {
+	CapturyStageStats	receiveToParse;		// packet received until the pose is decoded
+	CapturyStageStats	parseToCallback;	// pose decoded until the new pose callback is called
+	CapturyStageStats	callbackToConsumed;	// new pose callback until Captury_poseConsumed()
+
+	uint64_t	numPoses;
+	uint64_t	numDroppedPoses;	// gaps in the pose timestamps of an actor
+	uint64_t	numReassemblyFailures;	// poses split over several packets that could not be put back together
+	uint64_t	numReassembledPoses;	// poses split over several packets that were put back together
+	uint64_t	numExpiredFragments;	// packets of poses that timed out or arrived after a newer pose
+	uint64_t	numDuplicateFragments;	// packets of poses that were already complete
+};
+
+// the poses of all actors for one frame, see Captury_getFrameSnapshot()
+struct CapturyFrameSnapshot {
+	uint64_t	version;	// increases with every published snapshot
+	uint64_t	timestamp;	// shared by all poses in the snapshot
+	int32_t		numPoses;
+	CapturyPose*	poses;		// sorted by actor id
+	int32_t*	trackingQualities;	// one per pose
+};
+
+// the poses of all actors for one frame as structure of arrays, see Captury_getFrameArrays()
+// the joints of actor i are firstJoint[i] to firstJoint[i+1]-1 in all joint arrays
+// the float arrays are 64 byte aligned and padded with zeros to a multiple of 16 entries
+struct CapturyFrameArrays {
+	uint64_t	version;	// increases with every published frame
+	uint64_t	timestamp;	// shared by all poses in the frame
+	int32_t		numActors;
+	int32_t		numJoints;	// of all actors
+	int32_t		numBlendShapes;	// of all actors
+	int32_t*	actorIds;	// sorted
+	int32_t*	trackingQualities;	// one per actor
+	int32_t*	firstJoint;	// numActors+1 entries
+	int32_t*	firstBlendShape;	// numActors+1 entries
+	float*		translation[3];	// x, y and z of every joint
+	float*		rotation[3];	// euler angles of every joint
+	float*		blendShapeActivations;
+};
+
+// one entry of the actor change feed, see Captury_getActorChanges()
+struct CapturyActorChange {
+	uint64_t	sequence;	// increases by one with every change
+	int32_t		actorId;
+	int32_t		type;		// CapturyActorChangeType
+	int32_t		status;		// CapturyActorStatus after the change
+};
+
+// see Captury_getTimeSyncStats()
+struct CapturyTimeSyncStats {
+	int64_t		offset;		// remote time - local time in microseconds
+	double		drift;		// how much faster the remote clock runs in parts per million
+	uint32_t	errorBound;	// the remote time is off by no more than this many microseconds unless the remote clock jumps
+	uint32_t	minRoundTrip;	// shortest round trip of a recent time request in microseconds
+	int32_t		numSamples;	// recent time requests that the estimate is based on
+	int32_t		numRejectedSamples; // time requests whose round trip was too long to be used
+};
+
+struct CapturyActorStats {
+	uint64_t	numPoses;
+	uint64_t	numDroppedPoses;
+	uint64_t	numReassemblyFailures;
+};
+
 #pragma pack(pop)
 
 #endif
@@ -10,9 +10,12 @@
 #include "LiveLinkFrameTranslator.h"
 #include "Containers/CircularQueue.h"
 
+#include <atomic>
+
 struct CapturyActor;
 struct CapturyPose;
 struct CapturyARTag;
+struct CapturyActorChange;
 struct CapturyCamera;
 struct RemoteCaptury;
 
@@ -22,7 +25,7 @@ struct RemoteCaptury;
 class CAPTURYLIVELINK_API CapturyLiveLinkSource : public ILiveLinkSource
 {
 public:
-	CapturyLiveLinkSource(const FText & ip, bool useTCP, bool streamARTags, bool streamCompressed);
+	CapturyLiveLinkSource(const FText & ip, bool useTCP, bool streamARTags, bool streamCompressed, bool convertOnWorkerThread = false, bool sharedIOThread = false, bool useCaptureTime = false);
 	~CapturyLiveLinkSource();
 
 	//	void setSource(TSharedPtr<ILiveLinkSource> src) { source = src; }
@@ -49,16 +52,46 @@ public:
 	virtual TSubclassOf< ULiveLinkSourceSettings > GetSettingsClass() const override { return nullptr; }
 	static FLiveLinkStaticDataStruct setupPropStaticData();
 	static FLiveLinkStaticDataStruct setupSkeletonDefinition(const CapturyActor* actor);
+
+	// everything newPose() needs that depends only on the skeleton and not on the pose
+	struct RetargetPlan {
+		bool isValid = true;
+		bool isSkeleton = true;		// more than one joint, pushed as animation instead of transform
+		bool addRootJoint = false;
+		TArray<int32> parents;
+		TArray<FQuat> bindPoses;		// global bind pose orientation of each joint
+		TArray<FQuat> bindPoseInverses;
+		TArray<FQuat> relativeBindPoses;	// bind pose relative to the parent's bind pose
+		TArray<FVector> offsets;		// offset to the parent in unreal coordinates
+		TArray<FVector> scales;
+		TArray<TPair<FName, FString>> metaData;	// actor meta data interned once
+
+		// scratch space reused by every frame of this subject. only touched by the thread converting its pose.
+		mutable TArray<FQuat> globalPoseRotations;
+		mutable TArray<float> quats;
+	};
+	static TSharedPtr<const RetargetPlan> setupRetargetPlan(const CapturyActor* actor);
 	void addSubjects();
 	virtual void Update() override;
 	virtual void OnSettingsChanged(ULiveLinkSourceSettings* Settings, const FPropertyChangedEvent& PropertyChangedEvent) override {}
 
 	// public because they need to be called by static callbacks
-	void actorChanged(int actorId, int mode);
 	void newPose(CapturyActor* actor, CapturyPose* pose, int trackingQuality);
 	void arTagDetected(int num, CapturyARTag* tags);
+	void framerateChanged(int numerator, int denominator);
 protected:
 	void addSubject(const CapturyActor* actor);
+	void removeSubject(int actorId);
+	void applyActorChange(const CapturyActorChange& change);
+	// actor may be null if the pose was queued, it is only looked up if needed
+	void convertAndPushPose(int actorId, const CapturyActor* actor, const CapturyPose* pose);
+	// returns the client to push the frame to (read under mutx) or nullptr if the pose cannot be pushed (yet).
+	// can be called for different actors in parallel.
+	ILiveLinkClient* convertPose(int actorId, const CapturyActor* actor, const CapturyPose* pose, FLiveLinkSubjectKey& subjectKey, FLiveLinkFrameDataStruct& frameData);
+
+	// converts and pushes poses on its own thread so that a slow push does not delay reading the next packet
+	class IngestWorker;
+	TUniquePtr<IngestWorker> ingestWorker;
 
 	FText ipAddress;
 
@@ -68,6 +101,11 @@ protected:
 
 	RemoteCaptury* remoteCaptury = nullptr;
 
+	// stamp frames with the local time at which they were captured instead of when they arrived.
+	// only done once the clock is synchronized with Captury Live, checked on every Update().
+	bool useCaptureTime = false;
+	std::atomic<bool> captureTimeSynchronized {false};
+
 	ILiveLinkClient* liveLinkClient = nullptr;
 
 	mutable int lockedAt;
@@ -76,10 +114,11 @@ protected:
 	FGuid sourceGuid;
 
 	TMap<int, FLiveLinkSubjectKey> haveActors;
-	mutable TCircularQueue<int> queuedActorIds;
-	TCircularQueue<int> queuedActorIdsToRemove;
+	TMap<int, TSharedPtr<const RetargetPlan>> retargetPlans; // actor id -> cached skeleton dependent data
+	uint64 lastActorChange = 0; // sequence number of the last change from Captury_getActorChanges() that was applied
 	TCircularQueue<int> queuedARTags;
-	FFrameRate framerate;
+	FFrameRate framerate = FFrameRate(-1, -1); // locked by mutx. set by framerateChanged() as soon as it is received.
+	TSharedPtr<const FString> framerateString; // formatted once for the frame meta data. replaced as a whole so that it can be copied outside of mutx.
 
 	// when there are multiple sources, add a prefix to the subject names
 	FString prefix;
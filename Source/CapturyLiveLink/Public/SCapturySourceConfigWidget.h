@@ -30,6 +30,9 @@ protected:
 	void useTCPChanged(ECheckBoxState newState);
 	void streamARTagsChanged(ECheckBoxState newState);
 	void streamCompressedChanged(ECheckBoxState newState);
+	void convertOnWorkerThreadChanged(ECheckBoxState newState);
+	void sharedIOThreadChanged(ECheckBoxState newState);
+	void useCaptureTimeChanged(ECheckBoxState newState);
 	void openSource(const FText & InText, ETextCommit::Type type);
 	FReply okClicked();
 
@@ -41,4 +44,7 @@ protected:
 	static bool useTCP;
 	static bool streamARTags;
 	static bool streamCompressed;
+	static bool convertOnWorkerThread;
+	static bool sharedIOThread;
+	static bool useCaptureTime;
 };
@@ -0,0 +1,160 @@
+//
+// Micro benchmark of the actor lookup on the pose path
+//
+// compares ActorTable::find() against the unordered_maps it replaced. RemoteCaptury.cpp is included
+// instead of linked because ActorTable is internal to it. two things are measured for every id pattern:
+//   - a single lookup: ActorTable::find() against std::unordered_map::find()
+//   - the lookups of one pose packet: one ActorTable::find() against the sequence of the old
+//     receivedPosePacket() / receivedPose(): actorsById.count(), actorsById[], actorsById.count(),
+//     actorData.find(), actorsById.count() and actorsById[] (copying the shared_ptr)
+//
+// build (Linux / macOS):
+//   g++ -std=c++17 -O2 -pthread -D_GNU_SOURCE -I../../Source/CapturyLiveLink/Private -o CapturyActorLookupBenchmark
+//       CapturyActorLookupBenchmark.cpp
+//
+// usage:
+//   CapturyActorLookupBenchmark [--actors 100] [--lookups 20000000] [--output results.json]
+//
+// the actors are looked up in a shuffled order like the poses of a frame arrive. results are written
+// as JSON to stdout or to the --output file, progress goes to stderr.
+//
+
+#include "../../Source/CapturyLiveLink/Private/RemoteCaptury.cpp"
+#include "../MockCapturyServer/CommandLine.h"
+
+#include <random>
+#include <unordered_map>
+
+struct Result {
+	const char*	ids;
+	double		tableNs;	// per lookup
+	double		mapNs;
+	double		tablePoseNs;	// per pose packet
+	double		mapPoseNs;
+};
+
+template<typename F>
+static double measure(int numLookups, F lookup)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int i = 0; i < numLookups; ++i)
+		lookup(i);
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / numLookups;
+}
+
+static Result run(const char* name, const std::vector<int>& ids, int numLookups, std::mt19937& rng)
+{
+	ActorTable table;
+	std::unordered_map<int, CapturyActor_p> actorsById;
+	std::unordered_map<int, ActorData> actorData;
+	for (int id : ids) {
+		CapturyActor_p actor(new CapturyActor());
+		actor->id = id;
+		table.findOrAdd(id).actor = actor;
+		actorsById[id] = actor;
+		actorData[id];
+	}
+
+	// the order in which the poses of a frame arrive, repeated with a new order every frame
+	std::vector<int> order;
+	for (int frame = 0; frame < 64; ++frame) {
+		std::vector<int> frameIds = ids;
+		std::shuffle(frameIds.begin(), frameIds.end(), rng);
+		order.insert(order.end(), frameIds.begin(), frameIds.end());
+	}
+	const int numOrdered = (int)order.size();
+
+	Result result;
+	result.ids = name;
+	int64_t checksum = 0;
+	result.tableNs = result.mapNs = result.tablePoseNs = result.mapPoseNs = 1e30;
+	for (int round = 0; round < 3; ++round) {
+		result.tableNs = std::min(result.tableNs, measure(numLookups, [&](int i) {
+			checksum += table.find(order[i % numOrdered])->actor->id;
+		}));
+		result.mapNs = std::min(result.mapNs, measure(numLookups, [&](int i) {
+			checksum += actorsById.find(order[i % numOrdered])->second->id;
+		}));
+
+		result.tablePoseNs = std::min(result.tablePoseNs, measure(numLookups / 4, [&](int i) {
+			ActorSlot* slot = table.find(order[i % numOrdered]);
+			checksum += slot->actor->id + slot->data.flags;
+		}));
+		result.mapPoseNs = std::min(result.mapPoseNs, measure(numLookups / 4, [&](int i) {
+			const int id = order[i % numOrdered];
+			if (actorsById.count(id) == 0)
+				return;
+			CapturyActor* actor = actorsById[id].get();
+			if (actorsById.count(id) != 0)
+				checksum += actor->numJoints;
+			std::unordered_map<int, ActorData>::iterator it = actorData.find(id);
+			checksum += it->second.flags;
+			if (actorsById.count(id)) {
+				CapturyActor_p a = actorsById[id];
+				checksum += a->id;
+			}
+		}));
+	}
+	if (checksum == 1234) // keep the lookups
+		fprintf(stderr, " ");
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	int numActors = 100;
+	int numLookups = 20000000;
+	const char* output = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--actors") == 0)
+			numActors = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--lookups") == 0)
+			numLookups = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (numActors < 1 || numLookups < 4) {
+		fprintf(stderr, "actors and lookups must be positive\n");
+		return 1;
+	}
+
+	FILE* out = (output != nullptr) ? fopen(output, "w") : stdout;
+	if (out == nullptr) {
+		perror(output);
+		return 1;
+	}
+
+	std::mt19937 rng(42);
+	std::vector<int> sequential(numActors);
+	std::vector<int> scattered(numActors);
+	for (int i = 0; i < numActors; ++i)
+		sequential[i] = 1000 + i;
+	std::uniform_int_distribution<int> anyId(1, 0x7FFFFFFF);
+	for (int i = 0; i < numActors; ++i) {
+		do {
+			scattered[i] = anyId(rng);
+		} while (std::find(scattered.begin(), scattered.begin() + i, scattered[i]) != scattered.begin() + i);
+	}
+
+	std::vector<Result> results;
+	results.push_back(run("sequential", sequential, numLookups, rng));
+	results.push_back(run("scattered", scattered, numLookups, rng));
+
+	fprintf(out, "{\n\t\"actors\": %d,\n\t\"lookups\": %d,\n\t\"idPatterns\": [\n", numActors, numLookups);
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& r = results[i];
+		fprintf(stderr, "%d actors, %s ids: find %.2f ns (unordered_map %.2f ns), per pose packet %.2f ns (old lookups %.2f ns)\n",
+			numActors, r.ids, r.tableNs, r.mapNs, r.tablePoseNs, r.mapPoseNs);
+		fprintf(out, "\t\t{\"ids\": \"%s\", \"actorTableFindNs\": %.2f, \"unorderedMapFindNs\": %.2f, \"actorTablePerPoseNs\": %.2f, \"unorderedMapsPerPoseNs\": %.2f}%s\n",
+			r.ids, r.tableNs, r.mapNs, r.tablePoseNs, r.mapPoseNs, (i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(out, "\t]\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
@@ -0,0 +1,231 @@
+//
+// Headless RemoteCaptury benchmark
+//
+// links RemoteCaptury.cpp without Unreal, runs the mock Captury Live server in a thread and streams
+// synthetic poses to it over loopback. for every scenario it measures how many packets and poses per
+// second make it through receive / streamLoop / receivedPosePacket and how long it takes from the
+// server stamping a pose until the new pose callback fires.
+//
+// build (Linux / macOS):
+//   g++ -std=c++17 -O2 -pthread -D_GNU_SOURCE -I../../Source/CapturyLiveLink/Private -o CapturyBenchmark
+//       CapturyBenchmark.cpp ../../Source/CapturyLiveLink/Private/RemoteCaptury.cpp
+//
+// usage:
+//   CapturyBenchmark [--actors 100] [--rate 240] [--seconds 5] [--port 21010] [--reactor 0] [--output results.json]
+//
+// --reactor N serves the client's sockets from a shared reactor with N event loop threads instead of
+// the dedicated receive and stream threads.
+//
+// results are written as JSON to stdout or to the --output file so that runs of different plugin
+// versions can be compared. progress goes to stderr.
+//
+
+#include "RemoteCaptury.h"
+#include "../MockCapturyServer/MockCapturyServer.h"
+
+#include <thread>
+
+struct Scenario {
+	const char*	name;
+	int		numJoints;
+	bool		compressed;
+	int		mtu;
+};
+
+static const Scenario scenarios[] = {
+	{"uncompressed", 30, false, 1400},
+	{"compressed", 30, true, 1400},
+	{"continuation", 120, false, 1400},	// 2880 bytes of pose data split over 3 datagrams
+	{"compressedContinuation", 240, true, 1400},	// 2403 bytes of pose data split over 2 datagrams
+};
+
+struct Result {
+	uint64_t	numPackets = 0;
+	uint64_t	numPoses = 0;
+	double		seconds = 0.0;
+	std::vector<uint32_t> latencies; // in us
+	CapturyStats	stats;		// as seen by the library over the measurement period
+};
+
+// only touched by the stream thread while the client is connected
+struct Collector {
+	std::atomic<bool>	measuring {false};
+	std::vector<uint32_t>	latencies;
+};
+
+static void newPose(RemoteCaptury* rc, CapturyActor* actor, CapturyPose* pose, int trackingQuality, void* userArg)
+{
+	Collector* collector = (Collector*)userArg;
+	if (!collector->measuring)
+		return;
+
+	// server and client run on the same machine so the pose timestamp is directly comparable
+	const uint64_t now = getTime();
+	collector->latencies.push_back((now > pose->timestamp) ? (uint32_t)(now - pose->timestamp) : 0);
+	Captury_poseConsumed(rc, pose);
+}
+
+static bool runScenario(const Scenario& scenario, int numActors, int rate, double seconds, int port, int reactorThreads, Result& result)
+{
+	std::atomic<bool> stopServer {false};
+	Options opts;
+	opts.port = port;
+	opts.numActors = numActors;
+	opts.numJoints = scenario.numJoints;
+	opts.rate = rate;
+	opts.compressed = scenario.compressed;
+	opts.mtu = scenario.mtu;
+	opts.verbose = false;
+	opts.stop = &stopServer;
+	std::thread server(runMockServer, std::cref(opts));
+
+	Collector collector;
+	collector.latencies.reserve((size_t)(numActors * rate * seconds * 1.5));
+
+	RemoteCaptury* rc = Captury_create();
+	Captury_enablePrintf(rc, 0);
+	if (reactorThreads > 0)
+		Captury_useSharedReactor(rc, reactorThreads);
+
+	// the server needs a moment to start listening
+	bool connected = false;
+	for (int i = 0; i < 50 && !connected; ++i) {
+		connected = Captury_connect(rc, "127.0.0.1", (unsigned short)port) != 0;
+		if (!connected)
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	if (!connected) {
+		fprintf(stderr, "%s: cannot connect to mock server on port %d\n", scenario.name, port);
+		stopServer = true;
+		server.join();
+		Captury_destroy(rc);
+		return false;
+	}
+
+	Captury_registerNewPoseCallback(rc, newPose, &collector);
+	Captury_startStreaming(rc, CAPTURY_STREAM_POSES);
+
+	// warm up: let the actors arrive and the socket buffers settle
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+	uint64_t packetsBefore;
+	Captury_getStreamBatchStatistics(rc, nullptr, &packetsBefore, nullptr, nullptr);
+	Captury_resetStats(rc);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	collector.measuring = true;
+
+	std::this_thread::sleep_for(std::chrono::milliseconds((int64_t)(seconds * 1000)));
+
+	collector.measuring = false;
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uint64_t packetsAfter;
+	Captury_getStreamBatchStatistics(rc, nullptr, &packetsAfter, nullptr, nullptr);
+	result.numPackets = packetsAfter - packetsBefore;
+	Captury_getStats(rc, &result.stats);
+
+	// stops the stream thread (or leaves the reactor) so the latencies can be read safely afterwards
+	Captury_disconnect(rc);
+	Captury_destroy(rc);
+	stopServer = true;
+	server.join();
+
+	result.latencies.swap(collector.latencies);
+	result.numPoses = result.latencies.size();
+	return true;
+}
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+	size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, char** argv)
+{
+	int numActors = 100;
+	int rate = 240;
+	double seconds = 5.0;
+	int port = 21010;
+	int reactorThreads = 0;
+	const char* output = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--actors") == 0)
+			numActors = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--rate") == 0)
+			rate = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--seconds") == 0)
+			seconds = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--port") == 0)
+			port = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--reactor") == 0)
+			reactorThreads = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (numActors < 1 || rate < 1 || seconds <= 0.0) {
+		fprintf(stderr, "actors, rate and seconds must be positive\n");
+		return 1;
+	}
+
+	FILE* out = (output != nullptr) ? fopen(output, "w") : stdout;
+	if (out == nullptr) {
+		perror(output);
+		return 1;
+	}
+
+	fprintf(out, "{\n\t\"actors\": %d,\n\t\"rate\": %d,\n\t\"seconds\": %g,\n\t\"reactorThreads\": %d,\n\t\"scenarios\": [", numActors, rate, seconds, reactorThreads);
+	int ret = 0;
+	const int numScenarios = (int)(sizeof(scenarios) / sizeof(scenarios[0]));
+	for (int s = 0; s < numScenarios; ++s) {
+		const Scenario& scenario = scenarios[s];
+		fprintf(stderr, "running %s: %d actors with %d joints at %d Hz for %gs\n", scenario.name, numActors, scenario.numJoints, rate, seconds);
+
+		// a fresh port for every scenario so that late packets of the previous one cannot interfere
+		Result result;
+		if (!runScenario(scenario, numActors, rate, seconds, port + s, reactorThreads, result)) {
+			ret = 1;
+			continue;
+		}
+
+		std::vector<uint32_t>& sorted = result.latencies;
+		std::sort(sorted.begin(), sorted.end());
+		const double posesPerSecond = result.numPoses / result.seconds;
+		fprintf(stderr, "  %.0f packets/s, %.0f poses/s (%d expected), latency p50 %u us, p99 %u us, p99.9 %u us\n",
+			result.numPackets / result.seconds, posesPerSecond, numActors * rate,
+			percentile(sorted, 0.5), percentile(sorted, 0.99), percentile(sorted, 0.999));
+
+		fprintf(out, "%s\n\t\t{\n", (s == 0) ? "" : ",");
+		fprintf(out, "\t\t\t\"name\": \"%s\",\n", scenario.name);
+		fprintf(out, "\t\t\t\"joints\": %d,\n", scenario.numJoints);
+		fprintf(out, "\t\t\t\"compressed\": %s,\n", scenario.compressed ? "true" : "false");
+		fprintf(out, "\t\t\t\"packetsPerSecond\": %.1f,\n", result.numPackets / result.seconds);
+		fprintf(out, "\t\t\t\"posesPerSecond\": %.1f,\n", posesPerSecond);
+		fprintf(out, "\t\t\t\"expectedPosesPerSecond\": %d,\n", numActors * rate);
+		fprintf(out, "\t\t\t\"latencyUs\": {\"p50\": %u, \"p99\": %u, \"p999\": %u, \"max\": %u},\n",
+			percentile(sorted, 0.5), percentile(sorted, 0.99), percentile(sorted, 0.999), sorted.empty() ? 0 : sorted.back());
+		const CapturyStats& stats = result.stats;
+		const CapturyStageStats* stages[3] = {&stats.receiveToParse, &stats.parseToCallback, &stats.callbackToConsumed};
+		const char* stageNames[3] = {"receiveToParseNs", "parseToCallbackNs", "callbackToConsumedNs"};
+		for (int i = 0; i < 3; ++i)
+			fprintf(out, "\t\t\t\"%s\": {\"mean\": %llu, \"p50\": %llu, \"p99\": %llu, \"p999\": %llu, \"max\": %llu},\n", stageNames[i],
+				(unsigned long long)stages[i]->meanNs, (unsigned long long)stages[i]->p50Ns, (unsigned long long)stages[i]->p99Ns,
+				(unsigned long long)stages[i]->p999Ns, (unsigned long long)stages[i]->maxNs);
+		fprintf(out, "\t\t\t\"droppedPoses\": %llu,\n", (unsigned long long)stats.numDroppedPoses);
+		fprintf(out, "\t\t\t\"reassemblyFailures\": %llu,\n", (unsigned long long)stats.numReassemblyFailures);
+		fprintf(out, "\t\t\t\"reassembledPoses\": %llu,\n", (unsigned long long)stats.numReassembledPoses);
+		fprintf(out, "\t\t\t\"expiredFragments\": %llu,\n", (unsigned long long)stats.numExpiredFragments);
+		fprintf(out, "\t\t\t\"duplicateFragments\": %llu\n", (unsigned long long)stats.numDuplicateFragments);
+		fprintf(out, "\t\t}");
+	}
+	fprintf(out, "\n\t]\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+	return ret;
+}
@@ -0,0 +1,181 @@
+//
+// Golden test of the compressed pose decoder
+//
+// decodes random compressed payloads for random skeletons with decompressPose() and with the scalar
+// decoder it replaced and checks that both produce exactly the same bits. RemoteCaptury.cpp is
+// included instead of linked because decompressPose() is static.
+//
+// build once per SIMD width that RemoteCaptury.cpp supports (Linux / macOS):
+//   g++ -std=c++17 -O2 -pthread -D_GNU_SOURCE -I../../Source/CapturyLiveLink/Private -o CapturyDecompressCheck CapturyDecompressCheck.cpp
+//   g++ -std=c++17 -O2 -mavx2 -pthread -D_GNU_SOURCE -I../../Source/CapturyLiveLink/Private -o CapturyDecompressCheckAVX2 CapturyDecompressCheck.cpp
+// add -fsanitize=address to catch reads beyond the end of the payload.
+//
+// usage:
+//   CapturyDecompressCheck [--poses 100000] [--seed 1]
+//
+// results are written as JSON to stdout, the first mismatch goes to stderr. the exit code is 1 if any
+// pose was decoded differently.
+//
+
+#include "../../Source/CapturyLiveLink/Private/RemoteCaptury.cpp"
+#include "../MockCapturyServer/CommandLine.h"
+
+#include <random>
+
+// the decoder before it was vectorized, kept as the reference
+static void decompressPoseScalar(CapturyPose* pose, uint8_t* v, CapturyActor* actor)
+{
+	float* copyTo = (float*)pose->transforms;
+	float* values = (float*)pose->transforms;
+	int numJoints = (actor->numJoints < pose->numTransforms) ? actor->numJoints : pose->numTransforms;
+	for (int i = 0; i < numJoints; ++i) {
+		if (i == 0) {
+			int32_t t = v[0] | (v[1] << 8) | (v[2] << 16);
+			if ((t & 0x800000) != 0)
+				t |= 0xFF000000;
+			copyTo[0] = t * 0.0625f;
+			v += 3;
+			t = v[0] | (v[1] << 8) | (v[2] << 16);
+			if ((t & 0x800000) != 0)
+				t |= 0xFF000000;
+			copyTo[1] = t * 0.0625f;
+			v += 3;
+			t = v[0] | (v[1] << 8) | (v[2] << 16);
+			if ((t & 0x800000) != 0)
+				t |= 0xFF000000;
+			copyTo[2] = t * 0.0625f;
+			v += 3;
+		} else {
+			int32_t t = v[0] | (v[1] << 8);
+			if ((t & 0x8000) != 0)
+				t |= 0xFFFF0000;
+			copyTo[0] = t * 0.0625f + values[actor->joints[i].parent*6];
+			v += 2;
+			t = v[0] | (v[1] << 8);
+			if ((t & 0x8000) != 0)
+				t |= 0xFFFF0000;
+			copyTo[1] = t * 0.0625f + values[actor->joints[i].parent*6+1];
+			v += 2;
+			t = v[0] | (v[1] << 8);
+			if ((t & 0x8000) != 0)
+				t |= 0xFFFF0000;
+			copyTo[2] = t * 0.0625f + values[actor->joints[i].parent*6+2];
+			v += 2;
+		}
+
+		// decompress rotation
+		uint32_t rall;
+		memcpy(&rall, v, sizeof(rall));
+		v += 4;
+		copyTo[3] = ((rall & 0x000007FF))       * (360.0f / 2047) - 180.0f;
+		copyTo[4] = ((rall & 0x003FF800) >> 11) * (360.0f / 2047) - 180.0f;
+		copyTo[5] = ((rall & 0xFFC00000) >> 22) * (180.0f / 1023);
+		copyTo += 6;
+	}
+
+	for (int i = 0; i < pose->numBlendShapes; ++i, v += 2) {
+		uint16_t activation;
+		memcpy(&activation, v, sizeof(activation));
+		pose->blendShapeActivations[i] = activation / 32768.0f;
+	}
+}
+
+struct Decoded {
+	std::vector<CapturyTransform> transforms;
+	std::vector<float> blendShapes;
+	CapturyPose pose;
+
+	Decoded(int numTransforms, int numBlendShapes) : transforms(numTransforms), blendShapes(numBlendShapes)
+	{
+		// anything the decoder does not write must be the same for both
+		memset(transforms.data(), 0xCD, transforms.size() * sizeof(CapturyTransform));
+		memset(blendShapes.data(), 0xCD, blendShapes.size() * sizeof(float));
+		memset(&pose, 0, sizeof(pose));
+		pose.numTransforms = numTransforms;
+		pose.transforms = transforms.data();
+		pose.numBlendShapes = numBlendShapes;
+		pose.blendShapeActivations = blendShapes.data();
+	}
+};
+
+// returns the index of the first float that differs or -1
+static int compare(const Decoded& a, const Decoded& b)
+{
+	const float* fa = (const float*)a.transforms.data();
+	const float* fb = (const float*)b.transforms.data();
+	const int numTransformValues = (int)a.transforms.size() * 6;
+	for (int i = 0; i < numTransformValues; ++i)
+		if (memcmp(&fa[i], &fb[i], sizeof(float)) != 0)
+			return i;
+	for (size_t i = 0; i < a.blendShapes.size(); ++i)
+		if (memcmp(&a.blendShapes[i], &b.blendShapes[i], sizeof(float)) != 0)
+			return numTransformValues + (int)i;
+	return -1;
+}
+
+int main(int argc, char** argv)
+{
+	int numPoses = 100000;
+	int seed = 1;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--poses") == 0)
+			numPoses = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--seed") == 0)
+			seed = parseInt(i, argc, argv);
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+#ifdef CAPTURY_SIMD_WIDTH
+	const int simdWidth = CAPTURY_SIMD_WIDTH;
+#else
+	const int simdWidth = 1;
+#endif
+
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> byte(0, 255);
+	int numMismatches = 0;
+	uint64_t numJointsDecoded = 0;
+	for (int p = 0; p < numPoses; ++p) {
+		// sizes around multiples of the SIMD width are the interesting ones
+		const int numJoints = std::uniform_int_distribution<int>(0, 3 * 8 + 2)(rng) + ((p % 4 == 0) ? 100 : 0);
+		const int numBlendShapes = std::uniform_int_distribution<int>(0, 5)(rng);
+		std::vector<CapturyJoint> joints(numJoints);
+		for (int j = 0; j < numJoints; ++j)
+			joints[j].parent = (j == 0) ? -1 : std::uniform_int_distribution<int>(0, j - 1)(rng);
+
+		CapturyActor actor;
+		memset(&actor, 0, sizeof(actor));
+		actor.numJoints = numJoints;
+		actor.joints = joints.data();
+		actor.numBlendShapes = numBlendShapes;
+
+		// sometimes fewer transforms than joints as when the pose packet was cut short
+		const int numTransforms = (p % 8 == 1 && numJoints > 0) ? std::uniform_int_distribution<int>(0, numJoints)(rng) : numJoints;
+		const int numDecoded = std::min(numJoints, numTransforms);
+
+		// sized exactly so that the address sanitizer catches reads beyond the end
+		std::vector<uint8_t> payload(((numDecoded > 0) ? 13 + (numDecoded - 1) * 10 : 0) + numBlendShapes * 2);
+		for (uint8_t& b : payload)
+			b = (uint8_t)byte(rng);
+
+		Decoded reference(numTransforms, numBlendShapes);
+		Decoded decoded(numTransforms, numBlendShapes);
+		decompressPoseScalar(&reference.pose, payload.data(), &actor);
+		decompressPose(&decoded.pose, payload.data(), &actor);
+		numJointsDecoded += numDecoded;
+
+		const int at = compare(reference, decoded);
+		if (at >= 0) {
+			if (numMismatches == 0)
+				fprintf(stderr, "pose %d with %d joints and %d blend shapes differs at value %d\n", p, numJoints, numBlendShapes, at);
+			++numMismatches;
+		}
+	}
+
+	printf("{\n\t\"simdWidth\": %d,\n\t\"seed\": %d,\n\t\"poses\": %d,\n\t\"joints\": %" PRIu64 ",\n\t\"mismatches\": %d\n}\n",
+		simdWidth, seed, numPoses, numJointsDecoded, numMismatches);
+	return (numMismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+//
+// Micro benchmark of Captury_eulerToQuaternions()
+//
+// compares the batch conversion of a whole pose against converting one joint at a time the way the
+// plugin used to: three axis angle quaternions per joint, multiplied as qz * qy * qx. FQuat is not
+// available without Unreal so the per joint path is reproduced with the same math in double precision
+// like FQuat in UE5. the largest difference between both paths is reported as well.
+//
+// build (Linux / macOS):
+//   g++ -std=c++17 -O2 -pthread -D_GNU_SOURCE -I../../Source/CapturyLiveLink/Private -o CapturyEulerBenchmark
+//       CapturyEulerBenchmark.cpp ../../Source/CapturyLiveLink/Private/RemoteCaptury.cpp
+//
+// usage:
+//   CapturyEulerBenchmark [--poses 200000] [--output results.json]
+//
+// every skeleton size converts --poses poses with random angles. results are written as JSON to stdout
+// or to the --output file, progress goes to stderr. the exit code is 1 if both paths disagree by more
+// than 1e-5.
+//
+
+#include "RemoteCaptury.h"
+#include "../MockCapturyServer/CommandLine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define DEG2RADf 0.0174532925199432958f
+
+static const int skeletonSizes[] = {25, 70, 150};
+
+// the parts of FQuat that the per joint path used
+struct Quat {
+	double x, y, z, w;
+
+	Quat(double x, double y, double z, double w) : x(x), y(y), z(z), w(w) {}
+
+	// like FQuat(FVector axis, float angle)
+	Quat(double ax, double ay, double az, float angle)
+	{
+		const double s = std::sin(angle * 0.5);
+		x = ax * s;
+		y = ay * s;
+		z = az * s;
+		w = std::cos(angle * 0.5);
+	}
+
+	Quat operator*(const Quat& q) const
+	{
+		return Quat(w * q.x + x * q.w + y * q.z - z * q.y,
+			    w * q.y - x * q.z + y * q.w + z * q.x,
+			    w * q.z + x * q.y - y * q.x + z * q.w,
+			    w * q.w - x * q.x - y * q.y - z * q.z);
+	}
+};
+
+static void perJoint(const CapturyTransform* transforms, int numTransforms, float* qx, float* qy, float* qz, float* qw)
+{
+	for (int i = 0; i < numTransforms; ++i) {
+		float rx = transforms[i].rotation[0] * DEG2RADf;
+		float ry = transforms[i].rotation[1] * DEG2RADf;
+		float rz = transforms[i].rotation[2] * DEG2RADf;
+		Quat q = Quat(0, 0, 1, rz) * Quat(0, 1, 0, ry) * Quat(1, 0, 0, rx);
+		qx[i] = (float)q.x;
+		qy[i] = (float)q.y;
+		qz[i] = (float)q.z;
+		qw[i] = (float)q.w;
+	}
+}
+
+struct Result {
+	int	numJoints;
+	double	perJointNs;	// per pose
+	double	batchNs;	// per pose
+	double	maxDifference;
+};
+
+typedef void (*Convert)(const CapturyTransform*, int, float*, float*, float*, float*);
+
+// returns ns per pose. poses are cycled through so that the input is not always in the cache.
+static double measure(Convert convert, const std::vector<CapturyTransform>& poses, int numJoints, int numPoses, std::vector<float>& quats, double& checksum)
+{
+	const int numDistinct = (int)(poses.size() / numJoints);
+	float* qx = quats.data();
+	float* qy = qx + numJoints;
+	float* qz = qy + numJoints;
+	float* qw = qz + numJoints;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int p = 0; p < numPoses; ++p) {
+		convert(&poses[(p % numDistinct) * numJoints], numJoints, qx, qy, qz, qw);
+		checksum += qw[p % numJoints];
+	}
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / numPoses;
+}
+
+static Result run(int numJoints, int numPoses, std::mt19937& rng)
+{
+	std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+	std::vector<CapturyTransform> poses(64 * numJoints);
+	for (CapturyTransform& t : poses) {
+		memset(t.translation, 0, sizeof(t.translation));
+		for (int k = 0; k < 3; ++k)
+			t.rotation[k] = angle(rng);
+	}
+
+	Result result;
+	result.numJoints = numJoints;
+
+	// both paths must agree before their speed means anything
+	std::vector<float> reference(4 * poses.size());
+	std::vector<float> batch(4 * poses.size());
+	const int n = (int)poses.size();
+	perJoint(poses.data(), n, &reference[0], &reference[n], &reference[2 * n], &reference[3 * n]);
+	Captury_eulerToQuaternions(poses.data(), n, &batch[0], &batch[n], &batch[2 * n], &batch[3 * n]);
+	result.maxDifference = 0.0;
+	for (size_t i = 0; i < batch.size(); ++i)
+		result.maxDifference = std::max(result.maxDifference, (double)std::abs(batch[i] - reference[i]));
+
+	// warm up, then alternate so that both see the same clock speed
+	std::vector<float> quats(4 * numJoints);
+	double checksum = 0.0;
+	measure(perJoint, poses, numJoints, numPoses / 10, quats, checksum);
+	measure(Captury_eulerToQuaternions, poses, numJoints, numPoses / 10, quats, checksum);
+	result.perJointNs = result.batchNs = 1e30;
+	for (int round = 0; round < 3; ++round) {
+		result.perJointNs = std::min(result.perJointNs, measure(perJoint, poses, numJoints, numPoses, quats, checksum));
+		result.batchNs = std::min(result.batchNs, measure(Captury_eulerToQuaternions, poses, numJoints, numPoses, quats, checksum));
+	}
+	if (checksum == 1234.5) // keep the results
+		fprintf(stderr, " ");
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	int numPoses = 200000;
+	const char* output = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--poses") == 0)
+			numPoses = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (numPoses < 10) {
+		fprintf(stderr, "poses must be at least 10\n");
+		return 1;
+	}
+
+	FILE* out = (output != nullptr) ? fopen(output, "w") : stdout;
+	if (out == nullptr) {
+		perror(output);
+		return 1;
+	}
+
+	std::mt19937 rng(42);
+	std::vector<Result> results;
+	for (int numJoints : skeletonSizes) {
+		results.push_back(run(numJoints, numPoses, rng));
+		const Result& r = results.back();
+		fprintf(stderr, "%3d joints: per joint %8.1f ns, batch %8.1f ns per pose, %.2fx, max difference %.2g\n",
+			r.numJoints, r.perJointNs, r.batchNs, r.perJointNs / r.batchNs, r.maxDifference);
+	}
+
+	bool agree = true;
+	fprintf(out, "{\n\t\"poses\": %d,\n\t\"skeletons\": [\n", numPoses);
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result& r = results[i];
+		fprintf(out, "\t\t{\"joints\": %d, \"perJointNsPerPose\": %.1f, \"batchNsPerPose\": %.1f, \"speedup\": %.2f, \"maxDifference\": %.3g}%s\n",
+			r.numJoints, r.perJointNs, r.batchNs, r.perJointNs / r.batchNs, r.maxDifference, (i + 1 < results.size()) ? "," : "");
+		agree = agree && r.maxDifference <= 1e-5;
+	}
+	fprintf(out, "\t]\n}\n");
+
+	if (out != stdout)
+		fclose(out);
+	return agree ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+//
+// Headless stress test of the frame mailboxes
+//
+// runs the mock Captury Live server in a thread and lets it stream poses for one more actor every few
+// milliseconds so that every frame needs a little more memory than the one before. meanwhile several
+// threads poll Captury_getFrameSnapshot() and Captury_getFrameArrays() in a tight loop, hold on to the
+// previous frame while getting the next one and check that every frame they get is consistent.
+//
+// build with the address sanitizer so that reads of freed frames are caught (Linux / macOS):
+//   g++ -std=c++17 -O1 -g -fsanitize=address -pthread -D_GNU_SOURCE -I../../Source/CapturyLiveLink/Private -o CapturyFrameStress
+//       CapturyFrameStress.cpp ../../Source/CapturyLiveLink/Private/RemoteCaptury.cpp
+//
+// usage:
+//   CapturyFrameStress [--actors 100] [--joints 30] [--ramp 5] [--rounds 5] [--readers 4] [--port 21210] [--reactor 0]
+//
+// every round connects a new client while the server ramps up from one to --actors actors, one more
+// every --ramp ms. results are written as JSON to stdout, progress goes to stderr. the exit code is 1
+// if any frame was inconsistent.
+//
+
+#include "RemoteCaptury.h"
+#include "../MockCapturyServer/MockCapturyServer.h"
+
+#include <thread>
+
+struct ReaderStats {
+	uint64_t	numSnapshots = 0;
+	uint64_t	numArrays = 0;
+	int		maxActors = 0;
+	int		numErrors = 0;
+};
+
+static bool checkSnapshot(const CapturyFrameSnapshot* snapshot, int numJoints, uint64_t& lastVersion, double& sum)
+{
+	if (snapshot->version < lastVersion || snapshot->numPoses < 1)
+		return false;
+	lastVersion = snapshot->version;
+	for (int i = 0; i < snapshot->numPoses; ++i) {
+		const CapturyPose& pose = snapshot->poses[i];
+		if (pose.numTransforms != numJoints || pose.timestamp != snapshot->timestamp)
+			return false;
+		if (i != 0 && pose.actor <= snapshot->poses[i-1].actor)
+			return false;
+		for (int j = 0; j < pose.numTransforms; ++j)
+			sum += pose.transforms[j].translation[1];
+	}
+	return true;
+}
+
+static bool checkArrays(const CapturyFrameArrays* arrays, int numJoints, uint64_t& lastVersion, double& sum)
+{
+	if (arrays->version < lastVersion || arrays->numActors < 1 || arrays->numJoints != arrays->numActors * numJoints)
+		return false;
+	lastVersion = arrays->version;
+	if (arrays->firstJoint[0] != 0 || arrays->firstJoint[arrays->numActors] != arrays->numJoints)
+		return false;
+	for (int i = 1; i < arrays->numActors; ++i)
+		if (arrays->actorIds[i] <= arrays->actorIds[i-1] || arrays->firstJoint[i] != i * numJoints)
+			return false;
+	for (int j = 0; j < arrays->numJoints; ++j)
+		sum += arrays->translation[1][j];
+	return true;
+}
+
+// polls both kinds of frames as fast as possible. the previous frame is released only after the next
+// one was taken so that the writer regularly finds its buffers still in use.
+static void readFrames(RemoteCaptury* rc, int numJoints, const std::atomic<bool>& stop, ReaderStats& stats)
+{
+	const CapturyFrameSnapshot* previousSnapshot = nullptr;
+	const CapturyFrameArrays* previousArrays = nullptr;
+	uint64_t snapshotVersion = 0;
+	uint64_t arraysVersion = 0;
+	double sum = 0.0;
+	while (!stop) {
+		const CapturyFrameSnapshot* snapshot = Captury_getFrameSnapshot(rc);
+		if (snapshot != nullptr) {
+			++stats.numSnapshots;
+			stats.maxActors = std::max(stats.maxActors, snapshot->numPoses);
+			if (!checkSnapshot(snapshot, numJoints, snapshotVersion, sum))
+				++stats.numErrors;
+		}
+		Captury_releaseFrameSnapshot(rc, previousSnapshot);
+		previousSnapshot = snapshot;
+
+		const CapturyFrameArrays* arrays = Captury_getFrameArrays(rc);
+		if (arrays != nullptr) {
+			++stats.numArrays;
+			if (!checkArrays(arrays, numJoints, arraysVersion, sum))
+				++stats.numErrors;
+		}
+		Captury_releaseFrameArrays(rc, previousArrays);
+		previousArrays = arrays;
+	}
+	Captury_releaseFrameSnapshot(rc, previousSnapshot);
+	Captury_releaseFrameArrays(rc, previousArrays);
+	if (sum == 1234.5) // keep the reads
+		fprintf(stderr, " ");
+}
+
+static bool runRound(const Options& opts, int numReaders, int reactorThreads, ReaderStats& total)
+{
+	RemoteCaptury* rc = Captury_create();
+	Captury_enablePrintf(rc, 0);
+	if (reactorThreads > 0)
+		Captury_useSharedReactor(rc, reactorThreads);
+
+	// the server needs a moment to start listening or to finish with the previous client
+	bool connected = false;
+	for (int i = 0; i < 100 && !connected; ++i) {
+		connected = Captury_connect(rc, "127.0.0.1", (unsigned short)opts.port) != 0;
+		if (!connected)
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	if (!connected) {
+		fprintf(stderr, "cannot connect to mock server on port %d\n", opts.port);
+		Captury_destroy(rc);
+		return false;
+	}
+
+	// frames are only assembled once they have been asked for
+	Captury_releaseFrameSnapshot(rc, Captury_getFrameSnapshot(rc));
+	Captury_releaseFrameArrays(rc, Captury_getFrameArrays(rc));
+	Captury_startStreaming(rc, CAPTURY_STREAM_POSES);
+
+	std::atomic<bool> stopReaders {false};
+	std::vector<ReaderStats> stats(numReaders);
+	std::vector<std::thread> readers;
+	for (int i = 0; i < numReaders; ++i)
+		readers.emplace_back(readFrames, rc, opts.numJoints, std::cref(stopReaders), std::ref(stats[i]));
+
+	// ramp up and then a little longer at full size
+	std::this_thread::sleep_for(std::chrono::milliseconds(opts.actorRamp * opts.numActors + 500));
+
+	stopReaders = true;
+	for (std::thread& reader : readers)
+		reader.join();
+	Captury_disconnect(rc);
+	Captury_destroy(rc);
+
+	for (const ReaderStats& s : stats) {
+		total.numSnapshots += s.numSnapshots;
+		total.numArrays += s.numArrays;
+		total.maxActors = std::max(total.maxActors, s.maxActors);
+		total.numErrors += s.numErrors;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	std::atomic<bool> stopServer {false};
+	Options opts;
+	opts.port = 21210;
+	opts.numActors = 100;
+	opts.numJoints = 30;
+	opts.rate = 240;
+	opts.actorRamp = 5;
+	opts.verbose = false;
+	opts.stop = &stopServer;
+	int numRounds = 5;
+	int numReaders = 4;
+	int reactorThreads = 0;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--actors") == 0)
+			opts.numActors = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--joints") == 0)
+			opts.numJoints = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--ramp") == 0)
+			opts.actorRamp = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--rounds") == 0)
+			numRounds = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--readers") == 0)
+			numReaders = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--port") == 0)
+			opts.port = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--reactor") == 0)
+			reactorThreads = parseInt(i, argc, argv);
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (opts.numActors < 1 || opts.numJoints < 1 || opts.actorRamp < 1 || numRounds < 1 || numReaders < 1) {
+		fprintf(stderr, "actors, joints, ramp, rounds and readers must be positive\n");
+		return 1;
+	}
+
+	std::thread server(runMockServer, std::cref(opts));
+
+	ReaderStats total;
+	int ret = 0;
+	for (int round = 0; round < numRounds; ++round) {
+		fprintf(stderr, "round %d: ramping up to %d actors with %d joints, one every %d ms, %d readers\n",
+			round + 1, opts.numActors, opts.numJoints, opts.actorRamp, numReaders);
+		if (!runRound(opts, numReaders, reactorThreads, total))
+			ret = 1;
+	}
+
+	stopServer = true;
+	server.join();
+
+	fprintf(stderr, "  %" PRIu64 " snapshots, %" PRIu64 " frame arrays, up to %d actors, %d inconsistent\n",
+		total.numSnapshots, total.numArrays, total.maxActors, total.numErrors);
+	printf("{\n\t\"actors\": %d,\n\t\"joints\": %d,\n\t\"rampMs\": %d,\n\t\"rounds\": %d,\n\t\"readers\": %d,\n\t\"reactorThreads\": %d,\n",
+		opts.numActors, opts.numJoints, opts.actorRamp, numRounds, numReaders, reactorThreads);
+	printf("\t\"snapshots\": %" PRIu64 ",\n\t\"frameArrays\": %" PRIu64 ",\n\t\"maxActorsSeen\": %d,\n\t\"inconsistentFrames\": %d\n}\n",
+		total.numSnapshots, total.numArrays, total.maxActors, total.numErrors);
+
+	if (total.numErrors != 0)
+		ret = 1;
+	return ret;
+}
@@ -0,0 +1,186 @@
+//
+// Headless check of RemoteCaptury's clock synchronization
+//
+// runs the mock Captury Live server in a thread with a clock that is offset from and drifts against
+// the local clock and holds up time replies by random delays. the client runs the time
+// synchronization loop and the remote time it reports is compared against the mock server's clock
+// several times per second. since the mock server clock is a known function of the local clock the
+// error can be measured exactly.
+//
+// build (Linux / macOS):
+//   g++ -std=c++17 -O2 -pthread -D_GNU_SOURCE -I../../Source/CapturyLiveLink/Private -o CapturySyncCheck
+//       CapturySyncCheck.cpp ../../Source/CapturyLiveLink/Private/RemoteCaptury.cpp
+//
+// usage:
+//   CapturySyncCheck [--offset 250000] [--drift 50] [--jitter 2000] [--seconds 120] [--settle 15]
+//                    [--rate 60] [--port 21110] [--reactor 0] [--output results.json]
+//
+// --offset and --drift set the mock server clock in us and ppm. --jitter holds up time replies by up
+// to that many us. errors are only recorded after the first --settle seconds. the remote time is
+// frame accurate if it is never off by more than half a frame at --rate. the exit code is 1 unless it
+// is frame accurate and always within the error bound that Captury_getTimeSyncStats() reports.
+//
+// results are written as JSON to stdout or to the --output file. progress goes to stderr.
+//
+
+#include "RemoteCaptury.h"
+#include "../MockCapturyServer/MockCapturyServer.h"
+
+#include <thread>
+
+static int64_t percentile(const std::vector<int64_t>& sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+	size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, char** argv)
+{
+	std::atomic<bool> stopServer {false};
+	Options opts;
+	opts.port = 21110;
+	opts.numActors = 1;
+	opts.clockOffset = 250000;
+	opts.clockDrift = 50.0;
+	opts.timeJitter = 2000;
+	opts.verbose = false;
+	opts.stop = &stopServer;
+	double seconds = 120.0;
+	double settle = 15.0;
+	int reactorThreads = 0;
+	const char* output = nullptr;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--offset") == 0)
+			opts.clockOffset = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--drift") == 0)
+			opts.clockDrift = parseDouble(i, argc, argv);
+		else if (strcmp(argv[i], "--jitter") == 0)
+			opts.timeJitter = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--seconds") == 0)
+			seconds = parseDouble(i, argc, argv);
+		else if (strcmp(argv[i], "--settle") == 0)
+			settle = parseDouble(i, argc, argv);
+		else if (strcmp(argv[i], "--rate") == 0)
+			opts.rate = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--port") == 0)
+			opts.port = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--reactor") == 0)
+			reactorThreads = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			output = argv[++i];
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (seconds <= settle || settle < 0.0 || opts.rate < 1 || opts.timeJitter < 0) {
+		fprintf(stderr, "seconds must be larger than settle and rate must be positive\n");
+		return 1;
+	}
+
+	FILE* out = (output != nullptr) ? fopen(output, "w") : stdout;
+	if (out == nullptr) {
+		perror(output);
+		return 1;
+	}
+
+	std::thread server(runMockServer, std::cref(opts));
+
+	RemoteCaptury* rc = Captury_create();
+	Captury_enablePrintf(rc, 0);
+	if (reactorThreads > 0)
+		Captury_useSharedReactor(rc, reactorThreads);
+
+	// the server needs a moment to start listening
+	bool connected = false;
+	for (int i = 0; i < 50 && !connected; ++i) {
+		connected = Captury_connect(rc, "127.0.0.1", (unsigned short)opts.port) != 0;
+		if (!connected)
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	if (!connected) {
+		fprintf(stderr, "cannot connect to mock server on port %d\n", opts.port);
+		stopServer = true;
+		server.join();
+		Captury_destroy(rc);
+		return 1;
+	}
+
+	fprintf(stderr, "synchronizing with a clock %" PRId64 " us ahead that drifts %g ppm, time replies jittered by up to %d us, for %gs\n",
+		opts.clockOffset, opts.clockDrift, opts.timeJitter, seconds);
+	Captury_startTimeSynchronizationLoop(rc);
+
+	std::vector<int64_t> errors; // remote time as seen by the client - mock server clock in us
+	int64_t maxStep = 0;	// largest difference between the errors of consecutive checks after settling
+	int outsideErrorBound = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int lastReport = 0;
+	while (true) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (elapsed >= seconds)
+			break;
+
+		// the mock server clock is a function of the local clock so reading both around Captury_getTime() brackets it
+		const uint64_t before = getTime();
+		const uint64_t remoteT = Captury_getTime(rc);
+		const uint64_t after = getTime();
+		const int64_t error = (int64_t)(remoteT - serverTime(opts, before + (after - before) / 2));
+		const int64_t measurementError = (int64_t)(after - before) / 2 + 1;
+
+		CapturyTimeSyncStats stats;
+		const bool synchronized = Captury_getTimeSyncStats(rc, &stats) != 0;
+		if ((int)elapsed / 10 != lastReport) {
+			lastReport = (int)elapsed / 10;
+			fprintf(stderr, "  %3ds: error %6" PRId64 " us, estimated drift %7.2f ppm, error bound %u us, %d samples, %d rejected\n",
+				(int)elapsed, error, stats.drift, stats.errorBound, stats.numSamples, stats.numRejectedSamples);
+		}
+		if (elapsed < settle || !synchronized)
+			continue;
+
+		if (!errors.empty())
+			maxStep = std::max(maxStep, std::abs(error - errors.back()));
+		errors.push_back(error);
+		if (std::abs(error) > (int64_t)stats.errorBound + measurementError)
+			++outsideErrorBound;
+	}
+
+	CapturyTimeSyncStats stats;
+	Captury_getTimeSyncStats(rc, &stats);
+	Captury_disconnect(rc);
+	Captury_destroy(rc);
+	stopServer = true;
+	server.join();
+
+	std::vector<int64_t> absErrors(errors.size());
+	for (size_t i = 0; i < errors.size(); ++i)
+		absErrors[i] = std::abs(errors[i]);
+	std::sort(absErrors.begin(), absErrors.end());
+	const int64_t maxError = absErrors.empty() ? 0 : absErrors.back();
+	const int64_t halfFrame = 500000 / opts.rate;
+	const bool frameAccurate = !errors.empty() && maxError <= halfFrame;
+	fprintf(stderr, "  |error| p50 %" PRId64 " us, p99 %" PRId64 " us, max %" PRId64 " us, drift %.2f ppm (actual %g ppm), %s, %d of %d checks outside the error bound\n",
+		percentile(absErrors, 0.5), percentile(absErrors, 0.99), maxError, stats.drift, opts.clockDrift,
+		frameAccurate ? "frame accurate" : "NOT frame accurate", outsideErrorBound, (int)errors.size());
+
+	fprintf(out, "{\n\t\"clockOffsetUs\": %" PRId64 ",\n\t\"clockDriftPpm\": %g,\n\t\"timeJitterUs\": %d,\n", opts.clockOffset, opts.clockDrift, opts.timeJitter);
+	fprintf(out, "\t\"seconds\": %g,\n\t\"settleSeconds\": %g,\n\t\"reactorThreads\": %d,\n", seconds, settle, reactorThreads);
+	fprintf(out, "\t\"checks\": %d,\n", (int)errors.size());
+	fprintf(out, "\t\"absErrorUs\": {\"p50\": %" PRId64 ", \"p99\": %" PRId64 ", \"max\": %" PRId64 "},\n",
+		percentile(absErrors, 0.5), percentile(absErrors, 0.99), maxError);
+	fprintf(out, "\t\"maxStepUs\": %" PRId64 ",\n", maxStep);
+	fprintf(out, "\t\"outsideErrorBound\": %d,\n", outsideErrorBound);
+	fprintf(out, "\t\"estimatedDriftPpm\": %.3f,\n", stats.drift);
+	fprintf(out, "\t\"errorBoundUs\": %u,\n", stats.errorBound);
+	fprintf(out, "\t\"minRoundTripUs\": %u,\n", stats.minRoundTrip);
+	fprintf(out, "\t\"samples\": %d,\n", stats.numSamples);
+	fprintf(out, "\t\"rejectedSamples\": %d,\n", stats.numRejectedSamples);
+	fprintf(out, "\t\"halfFrameUs\": %" PRId64 ",\n", halfFrame);
+	fprintf(out, "\t\"frameAccurate\": %s\n}\n", frameAccurate ? "true" : "false");
+
+	if (out != stdout)
+		fclose(out);
+	return (frameAccurate && outsideErrorBound == 0) ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+//
+// command line helpers shared by the tools
+//
+// both read the argument of the option at argv[i], advance i past it and exit if it is missing.
+//
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static inline int parseInt(int& i, int argc, char** argv)
+{
+	if (i + 1 >= argc) {
+		fprintf(stderr, "%s needs an argument\n", argv[i]);
+		exit(1);
+	}
+	return atoi(argv[++i]);
+}
+
+static inline double parseDouble(int& i, int argc, char** argv)
+{
+	if (i + 1 >= argc) {
+		fprintf(stderr, "%s needs an argument\n", argv[i]);
+		exit(1);
+	}
+	return atof(argv[++i]);
+}
@@ -0,0 +1,71 @@
+//
+// Mock Captury Live server
+//
+// speaks enough of the Captury Live protocol to drive RemoteCaptury without any capture hardware:
+// it performs the TCP handshake (actors, frame rate, hello), answers time and frame rate requests
+// and streams synthetic poses for any number of actors at a fixed rate over UDP or TCP.
+//
+// build (Linux / macOS):
+//   g++ -std=c++17 -O2 -pthread -o MockCapturyServer MockCapturyServer.cpp
+//
+// usage:
+//   MockCapturyServer [--port 2101] [--actors 1] [--joints 30] [--blendshapes 0] [--rate 60]
+//                     [--compressed] [--tcp] [--mtu 1400] [--duration 0]
+//                     [--clock-offset 0] [--clock-drift 0] [--time-jitter 0] [--actor-ramp 0]
+//
+// --compressed   stream capturyCompressedPose2 instead of capturyPose2
+// --tcp          send poses on the TCP connection instead of to the client's UDP stream socket
+// --mtu          UDP poses larger than this are split into capturyPose2 + capturyPoseCont packets
+// --duration     stop after this many seconds (0 = run until killed)
+// --clock-offset the server clock is this many microseconds ahead of the local clock
+// --clock-drift  the server clock runs this many parts per million faster than the local clock
+// --time-jitter  replies to time requests are held up by random delays of up to this many microseconds
+// --actor-ramp   stream poses for one actor at first and one more every this many milliseconds
+//
+// see MockCapturyServer.h for what the server does
+//
+
+#include "MockCapturyServer.h"
+
+int main(int argc, char** argv)
+{
+	Options opts;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--port") == 0)
+			opts.port = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--actors") == 0)
+			opts.numActors = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--joints") == 0)
+			opts.numJoints = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--blendshapes") == 0)
+			opts.numBlendShapes = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--rate") == 0)
+			opts.rate = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--mtu") == 0)
+			opts.mtu = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--duration") == 0)
+			opts.duration = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--clock-offset") == 0)
+			opts.clockOffset = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--clock-drift") == 0)
+			opts.clockDrift = parseDouble(i, argc, argv);
+		else if (strcmp(argv[i], "--time-jitter") == 0)
+			opts.timeJitter = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--actor-ramp") == 0)
+			opts.actorRamp = parseInt(i, argc, argv);
+		else if (strcmp(argv[i], "--compressed") == 0)
+			opts.compressed = true;
+		else if (strcmp(argv[i], "--tcp") == 0)
+			opts.streamOverTcp = true;
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (opts.numActors < 1 || opts.numJoints < 1 || opts.rate < 1 || opts.numBlendShapes < 0 || opts.timeJitter < 0 || opts.actorRamp < 0) {
+		fprintf(stderr, "actors, joints and rate must be positive\n");
+		return 1;
+	}
+
+	return runMockServer(opts);
+}
@@ -0,0 +1,518 @@
+//
+// Mock Captury Live server
+//
+// speaks enough of the Captury Live protocol to drive RemoteCaptury without any capture hardware:
+// it performs the TCP handshake (actors, frame rate, hello), answers time and frame rate requests
+// and streams synthetic poses for any number of actors at a fixed rate over UDP or TCP.
+//
+// only one client is served at a time. the streamed poses are deterministic functions of the frame
+// number so that runs are reproducible.
+//
+// the server clock can be given an offset and a drift relative to the local clock and time replies can
+// be held up by random delays to check how well RemoteCaptury synchronizes its clock.
+//
+// MockCapturyServer.cpp wraps this into a command line tool. other tools can include this file
+// and run the server in a thread.
+//
+
+#pragma once
+
+#include "../../Source/CapturyLiveLink/Private/RemoteCaptury.h"
+#include "CommandLine.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <vector>
+
+struct Options {
+	int	port = 2101;
+	int	numActors = 1;
+	int	numJoints = 30;
+	int	numBlendShapes = 0;
+	int	rate = 60;
+	bool	compressed = false;
+	bool	streamOverTcp = false;
+	int	mtu = 1400;
+	double	duration = 0.0;
+	int64_t	clockOffset = 0;	// in us. how far the server clock is ahead of the local clock
+	double	clockDrift = 0.0;	// in ppm. how much faster the server clock runs than the local clock
+	int	timeJitter = 0;		// in us. time replies are held up by random delays of up to this much
+	int	actorRamp = 0;		// in ms. if set poses are streamed for one actor at first and one more every actorRamp ms
+	bool	verbose = true;
+	const std::atomic<bool>* stop = nullptr; // optional. the server returns once this becomes true
+};
+
+static void mockLog(const Options& opts, const char* format, ...)
+{
+	if (!opts.verbose)
+		return;
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+}
+
+static bool keepRunning(const Options& opts, std::chrono::steady_clock::time_point endTime)
+{
+	if (opts.stop != nullptr && *opts.stop)
+		return false;
+	return opts.duration <= 0.0 || std::chrono::steady_clock::now() < endTime;
+}
+
+struct Joint {
+	int	parent;
+	float	offset[3];
+};
+
+struct Stats {
+	uint64_t	frames = 0;
+	uint64_t	packets = 0;
+	uint64_t	bytes = 0;
+};
+
+// returns current time in us. same clock as RemoteCaptury uses
+static uint64_t getTime()
+{
+	timespec t;
+	clock_gettime(CLOCK_REALTIME, &t);
+	return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+// the local time when the process started. the server clock drifts away from the local clock from here on.
+static const uint64_t mockClockEpoch = getTime();
+
+// returns the time of the simulated Captury Live clock at local time localT
+static uint64_t serverTime(const Options& opts, uint64_t localT)
+{
+	const double drift = ((double)localT - (double)mockClockEpoch) * opts.clockDrift * 1e-6;
+	return (uint64_t)((int64_t)localT + opts.clockOffset + (int64_t)drift);
+}
+
+static bool sendAll(int sock, const void* data, int size)
+{
+	const char* at = (const char*)data;
+	while (size > 0) {
+		ssize_t sent = send(sock, at, size, MSG_NOSIGNAL);
+		if (sent <= 0)
+			return false;
+		at += sent;
+		size -= (int)sent;
+	}
+	return true;
+}
+
+// a simple tree: every joint hangs off the one three indices before it so that
+// there are a few chains of different depth, like limbs
+static std::vector<Joint> makeSkeleton(int numJoints)
+{
+	std::vector<Joint> joints(numJoints);
+	for (int i = 0; i < numJoints; ++i) {
+		joints[i].parent = (i == 0) ? -1 : (i <= 3) ? 0 : i - 3;
+		joints[i].offset[0] = (i == 0) ? 0.0f : 20.0f * ((i % 3) - 1);
+		joints[i].offset[1] = (i == 0) ? 1000.0f : 100.0f;
+		joints[i].offset[2] = 0.0f;
+	}
+	return joints;
+}
+
+static bool sendActors(int sock, const Options& opts, const std::vector<Joint>& joints)
+{
+	CapturyActorsPacket cap = {capturyActors, sizeof(CapturyActorsPacket), opts.numActors};
+	if (!sendAll(sock, &cap, sizeof(cap)))
+		return false;
+
+	std::vector<char> buffer;
+	for (int a = 0; a < opts.numActors; ++a) {
+		buffer.assign(sizeof(CapturyActorPacket), 0);
+		CapturyActorPacket* actor = (CapturyActorPacket*)buffer.data();
+		actor->type = capturyActor3;
+		snprintf(actor->name, sizeof(actor->name), "mock%d", a);
+		actor->id = a + 1;
+		actor->numJoints = opts.numJoints;
+
+		for (int i = 0; i < opts.numJoints; ++i) {
+			char name[32];
+			int nameLen = snprintf(name, sizeof(name), "joint%d", i) + 1;
+			size_t at = buffer.size();
+			buffer.resize(at + sizeof(CapturyJointPacket3) + nameLen);
+			CapturyJointPacket3* jp = (CapturyJointPacket3*)&buffer[at];
+			jp->parent = joints[i].parent;
+			for (int x = 0; x < 3; ++x) {
+				jp->offset[x] = joints[i].offset[x];
+				jp->orientation[x] = 0.0f;
+				jp->scale[x] = 1.0f;
+			}
+			memcpy(jp->name, name, nameLen);
+		}
+		actor = (CapturyActorPacket*)buffer.data();
+		actor->size = (int32_t)buffer.size();
+		if (!sendAll(sock, buffer.data(), (int)buffer.size()))
+			return false;
+
+		if (opts.numBlendShapes != 0) {
+			buffer.assign(sizeof(CapturyActorBlendShapesPacket), 0);
+			for (int i = 0; i < opts.numBlendShapes; ++i) {
+				char name[32];
+				int nameLen = snprintf(name, sizeof(name), "blendShape%d", i) + 1;
+				buffer.insert(buffer.end(), name, name + nameLen);
+			}
+			CapturyActorBlendShapesPacket* bs = (CapturyActorBlendShapesPacket*)buffer.data();
+			bs->type = capturyActorBlendShapes;
+			bs->size = (int32_t)buffer.size();
+			bs->actorId = a + 1;
+			bs->numBlendShapes = opts.numBlendShapes;
+			if (!sendAll(sock, buffer.data(), (int)buffer.size()))
+				return false;
+		}
+	}
+	return true;
+}
+
+static bool sendFramerate(int sock, const Options& opts)
+{
+	CapturyFrameratePacket fp = {capturyFramerate, sizeof(CapturyFrameratePacket), opts.rate, 1};
+	return sendAll(sock, &fp, sizeof(fp));
+}
+
+// global translations (mm) and XYZ Euler angles (degrees) for one actor in one frame.
+// x and y rotations are in [-180, 180], z in [0, 180] so that they survive compression.
+static void synthesizePose(const std::vector<Joint>& joints, int actor, uint64_t frame, const Options& opts, float* values)
+{
+	const float t = frame / (float)opts.rate;
+	for (int i = 0; i < (int)joints.size(); ++i) {
+		float* v = values + i*6;
+		if (i == 0) {
+			const float angle = 0.5f * t + actor * 0.7f;
+			v[0] = 1500.0f * cosf(angle) + 300.0f * (actor % 10);
+			v[1] = joints[0].offset[1] + 20.0f * sinf(4.0f * t);
+			v[2] = 1500.0f * sinf(angle) + 300.0f * (actor / 10);
+		} else {
+			const float* p = values + joints[i].parent*6;
+			for (int x = 0; x < 3; ++x)
+				v[x] = p[x] + joints[i].offset[x];
+		}
+		v[3] = 90.0f * sinf(t + 0.1f * i);
+		v[4] = 180.0f * sinf(0.3f * t + actor);
+		v[5] = 90.0f + 60.0f * sinf(2.0f * t + 0.2f * i);
+	}
+	for (int i = 0; i < opts.numBlendShapes; ++i)
+		values[joints.size()*6 + i] = 0.5f + 0.5f * sinf(t + i);
+}
+
+static void put16(std::vector<uint8_t>& out, int32_t v)
+{
+	out.push_back(v & 0xFF);
+	out.push_back((v >> 8) & 0xFF);
+}
+
+static void put24(std::vector<uint8_t>& out, int32_t v)
+{
+	out.push_back(v & 0xFF);
+	out.push_back((v >> 8) & 0xFF);
+	out.push_back((v >> 16) & 0xFF);
+}
+
+static int32_t quantize(float f, float scale, int32_t minValue, int32_t maxValue)
+{
+	int32_t v = (int32_t)lrintf(f * scale);
+	return (v < minValue) ? minValue : (v > maxValue) ? maxValue : v;
+}
+
+// inverse of decompressPose() in RemoteCaptury.cpp
+// children are encoded relative to their parent's decoded position so that quantization errors do not accumulate
+static void compressPose(const std::vector<Joint>& joints, const float* values, int numBlendShapes, std::vector<uint8_t>& out)
+{
+	out.clear();
+	std::vector<float> decoded(joints.size() * 3);
+	for (int i = 0; i < (int)joints.size(); ++i) {
+		const float* v = values + i*6;
+		if (i == 0) {
+			for (int x = 0; x < 3; ++x) {
+				int32_t q = quantize(v[x], 16.0f, -0x800000, 0x7FFFFF);
+				put24(out, q);
+				decoded[x] = q * 0.0625f;
+			}
+		} else {
+			const float* p = &decoded[joints[i].parent*3];
+			for (int x = 0; x < 3; ++x) {
+				int32_t q = quantize(v[x] - p[x], 16.0f, -0x8000, 0x7FFF);
+				put16(out, q);
+				decoded[i*3+x] = p[x] + q * 0.0625f;
+			}
+		}
+
+		uint32_t rx = (uint32_t)quantize(v[3] + 180.0f, 2047 / 360.0f, 0, 2047);
+		uint32_t ry = (uint32_t)quantize(v[4] + 180.0f, 2047 / 360.0f, 0, 2047);
+		uint32_t rz = (uint32_t)quantize(v[5], 1023 / 180.0f, 0, 1023);
+		uint32_t rall = rx | (ry << 11) | (rz << 22);
+		out.insert(out.end(), (uint8_t*)&rall, (uint8_t*)&rall + 4);
+	}
+	for (int i = 0; i < numBlendShapes; ++i)
+		put16(out, quantize(values[joints.size()*6 + i], 32768.0f, 0, 0xFFFF));
+}
+
+struct Streamer {
+	int		tcpSock;
+	int		udpSock;
+	sockaddr_in	udpTarget;
+	bool		streaming = false;
+	std::mt19937	random;		// fixed seed so that the jitter is the same in every run
+
+	bool sendPacket(const std::vector<uint8_t>& packet, bool overTcp, Stats& stats)
+	{
+		stats.packets += 1;
+		stats.bytes += packet.size();
+		if (overTcp)
+			return sendAll(tcpSock, packet.data(), (int)packet.size());
+		sendto(udpSock, (const char*)packet.data(), packet.size(), 0, (sockaddr*)&udpTarget, sizeof(udpTarget));
+		return true; // dropped datagrams are not an error
+	}
+};
+
+static bool streamFrame(Streamer& streamer, const Options& opts, const std::vector<Joint>& joints, uint64_t frame, int numActors, Stats& stats)
+{
+	const int numValues = opts.numJoints * 6 + opts.numBlendShapes;
+	std::vector<float> values(numValues);
+	std::vector<uint8_t> compressed;
+	std::vector<uint8_t> packet;
+	const uint64_t timestamp = serverTime(opts, getTime());
+
+	for (int a = 0; a < numActors; ++a) {
+		synthesizePose(joints, a, frame, opts, values.data());
+
+		const uint8_t* payload = (const uint8_t*)values.data();
+		int payloadSize = numValues * (int)sizeof(float);
+		if (opts.compressed) {
+			compressPose(joints, values.data(), opts.numBlendShapes, compressed);
+			payload = compressed.data();
+			payloadSize = (int)compressed.size();
+		}
+
+		// the first packet carries the header. over UDP anything that doesn't fit goes into continuation packets.
+		const int maxPayload = opts.streamOverTcp ? payloadSize : std::max<int>(opts.mtu - (int)sizeof(CapturyPosePacket2), 16);
+		int chunk = std::min(payloadSize, maxPayload);
+		packet.assign(sizeof(CapturyPosePacket2) + chunk, 0);
+		CapturyPosePacket2* cpp = (CapturyPosePacket2*)packet.data();
+		cpp->type = opts.compressed ? capturyCompressedPose2 : capturyPose2;
+		cpp->size = (int32_t)packet.size();
+		cpp->actor = a + 1;
+		cpp->timestamp = timestamp;
+		cpp->trackingQuality = 100;
+		cpp->scalingProgress = 100;
+		cpp->flags = (frame & 1) ? CAPTURY_LEFT_FOOT_ON_GROUND : CAPTURY_RIGHT_FOOT_ON_GROUND;
+		cpp->numValues = numValues;
+		memcpy(cpp->values, payload, chunk);
+		if (!streamer.sendPacket(packet, opts.streamOverTcp, stats))
+			return false;
+
+		for (int at = chunk; at < payloadSize; at += chunk) {
+			chunk = std::min(payloadSize - at, std::max<int>(opts.mtu - (int)sizeof(CapturyPoseCont), 16));
+			packet.assign(sizeof(CapturyPoseCont) + chunk, 0);
+			CapturyPoseCont* cpc = (CapturyPoseCont*)packet.data();
+			cpc->type = opts.compressed ? capturyCompressedPoseCont : capturyPoseCont;
+			cpc->size = (int32_t)packet.size();
+			cpc->actor = a + 1;
+			cpc->timestamp = timestamp;
+			memcpy(cpc->values, payload + at, chunk);
+			if (!streamer.sendPacket(packet, false, stats))
+				return false;
+		}
+	}
+	stats.frames += 1;
+	return true;
+}
+
+// the timestamp of a time reply. with jitter some replies are held up before the timestamp is taken and
+// some after so that the client sees timestamps that are too early as well as too late.
+static uint64_t timeReplyTimestamp(Streamer& streamer, const Options& opts)
+{
+	if (opts.timeJitter <= 0)
+		return serverTime(opts, getTime());
+
+	std::uniform_int_distribution<int> delay(0, opts.timeJitter);
+	if (streamer.random() & 1)
+		usleep(delay(streamer.random));
+	const uint64_t timestamp = serverTime(opts, getTime());
+	if (streamer.random() & 1)
+		usleep(delay(streamer.random));
+	return timestamp;
+}
+
+// reads and answers all requests that are waiting on the TCP socket
+// returns false if the client went away
+static bool handleRequests(Streamer& streamer, const Options& opts, const std::vector<Joint>& joints, std::vector<char>& buffer)
+{
+	CapturyRequestPacket header;
+	ssize_t got = recv(streamer.tcpSock, (char*)&header, sizeof(header), MSG_WAITALL);
+	if (got != sizeof(header) || header.size < (int)sizeof(header) || header.size > 1000000)
+		return false;
+
+	buffer.resize(header.size);
+	memcpy(buffer.data(), &header, sizeof(header));
+	if (header.size > (int)sizeof(header)) {
+		got = recv(streamer.tcpSock, buffer.data() + sizeof(header), header.size - sizeof(header), MSG_WAITALL);
+		if (got != header.size - (int)sizeof(header))
+			return false;
+	}
+
+	switch (header.type) {
+	case capturyActors:
+		return sendActors(streamer.tcpSock, opts, joints);
+	case capturyGetFramerate:
+		return sendFramerate(streamer.tcpSock, opts);
+	case capturyGetTime: {
+		CapturyTimePacket tp = {capturyTime, sizeof(CapturyTimePacket), timeReplyTimestamp(streamer, opts)};
+		return sendAll(streamer.tcpSock, &tp, sizeof(tp)); }
+	case capturyGetTime2: {
+		CapturyTimePacket2* req = (CapturyTimePacket2*)buffer.data();
+		CapturyTimePacket2 tp = {capturyTime2, sizeof(CapturyTimePacket2), timeReplyTimestamp(streamer, opts), req->timeId};
+		return sendAll(streamer.tcpSock, &tp, sizeof(tp)); }
+	case capturyStream: {
+		CapturyStreamPacketTcp* sp = (CapturyStreamPacketTcp*)buffer.data();
+		streamer.streaming = (sp->what & CAPTURY_STREAM_POSES) != 0;
+		if (header.size >= (int)sizeof(CapturyStreamPacketTcp)) {
+			streamer.udpTarget.sin_family = AF_INET;
+			streamer.udpTarget.sin_port = sp->port;
+			// the client reports the address it bound to which is usually INADDR_ANY. use the peer address instead.
+			sockaddr_in peer;
+			socklen_t len = sizeof(peer);
+			getpeername(streamer.tcpSock, (sockaddr*)&peer, &len);
+			streamer.udpTarget.sin_addr = (sp->ip != 0) ? *(in_addr*)&sp->ip : peer.sin_addr;
+		}
+		char buf[100];
+		mockLog(opts, "client requested stream %x to %s:%d\n", sp->what, inet_ntop(AF_INET, &streamer.udpTarget.sin_addr, buf, 100), ntohs(streamer.udpTarget.sin_port));
+		CapturyRequestPacket ack = {capturyStreamAck, sizeof(CapturyRequestPacket)};
+		return sendAll(streamer.tcpSock, &ack, sizeof(ack)); }
+	default:
+		mockLog(opts, "ignoring request type %d\n", header.type);
+		return true;
+	}
+}
+
+// handshake, then stream until the client disconnects or the duration is over
+static void serveClient(int tcpSock, int udpSock, const Options& opts, const std::vector<Joint>& joints, std::chrono::steady_clock::time_point endTime)
+{
+	Streamer streamer;
+	streamer.tcpSock = tcpSock;
+	streamer.udpSock = udpSock;
+	memset(&streamer.udpTarget, 0, sizeof(streamer.udpTarget));
+
+	CapturyRequestPacket hello = {capturyHello, sizeof(CapturyRequestPacket)};
+	if (!sendActors(tcpSock, opts, joints) || !sendFramerate(tcpSock, opts) || !sendAll(tcpSock, &hello, sizeof(hello)))
+		return;
+
+	const std::chrono::nanoseconds framePeriod(1000000000LL / opts.rate);
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point nextFrame = start;
+	std::chrono::steady_clock::time_point nextReport = nextFrame + std::chrono::seconds(1);
+	std::vector<char> buffer;
+	uint64_t frame = 0;
+	Stats stats;
+	Stats reported;
+
+	while (keepRunning(opts, endTime)) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now >= nextFrame) {
+			int numActors = opts.numActors;
+			if (opts.actorRamp > 0)
+				numActors = std::min(numActors, 1 + (int)(std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() / opts.actorRamp));
+			if (streamer.streaming && !streamFrame(streamer, opts, joints, frame, numActors, stats))
+				break;
+			++frame;
+			nextFrame += framePeriod;
+			if (nextFrame < now) // fell behind. don't try to catch up with a burst.
+				nextFrame = now + framePeriod;
+		}
+
+		if (now >= nextReport) {
+			mockLog(opts, "%" PRIu64 " frames/s, %" PRIu64 " packets/s, %.2f MB/s\n", stats.frames - reported.frames, stats.packets - reported.packets, (stats.bytes - reported.bytes) / 1e6);
+			reported = stats;
+			nextReport += std::chrono::seconds(1);
+		}
+
+		// drain the firewall-opening datagrams the client sends to our UDP port
+		char dummy[64];
+		while (recv(udpSock, dummy, sizeof(dummy), MSG_DONTWAIT) > 0)
+			;
+
+		const int timeoutMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(nextFrame - std::chrono::steady_clock::now()).count();
+		pollfd pfd = {tcpSock, POLLIN, 0};
+		int ret = poll(&pfd, 1, std::max(timeoutMs, 0));
+		if (ret < 0)
+			break;
+		if (ret > 0 && !handleRequests(streamer, opts, joints, buffer))
+			break;
+	}
+}
+
+// listens on opts.port and serves one client after the other until opts.duration is over or opts.stop is set
+// returns 0 on success
+static int runMockServer(const Options& opts)
+{
+	signal(SIGPIPE, SIG_IGN);
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	addr.sin_port = htons(opts.port);
+
+	int listenSock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	int one = 1;
+	setsockopt(listenSock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	if (bind(listenSock, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenSock, 1) != 0) {
+		perror("cannot listen");
+		return 1;
+	}
+
+	// RemoteCaptury connects its stream socket to the server's TCP port so poses have to come from the same port
+	int udpSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	setsockopt(udpSock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	int sendBufSize = 4 * 1024 * 1024;
+	setsockopt(udpSock, SOL_SOCKET, SO_SNDBUF, &sendBufSize, sizeof(sendBufSize));
+	if (bind(udpSock, (sockaddr*)&addr, sizeof(addr)) != 0) {
+		perror("cannot bind stream socket");
+		return 1;
+	}
+
+	const std::vector<Joint> joints = makeSkeleton(opts.numJoints);
+	const std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now() + std::chrono::milliseconds((int64_t)(opts.duration * 1000));
+
+	mockLog(opts, "mock Captury Live on port %d: %d actors, %d joints, %d blend shapes, %d Hz, %s over %s\n", opts.port, opts.numActors, opts.numJoints, opts.numBlendShapes, opts.rate, opts.compressed ? "compressed" : "uncompressed", opts.streamOverTcp ? "TCP" : "UDP");
+
+	while (keepRunning(opts, endTime)) {
+		pollfd pfd = {listenSock, POLLIN, 0};
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+
+		int tcpSock = accept(listenSock, nullptr, nullptr);
+		if (tcpSock < 0)
+			continue;
+		setsockopt(tcpSock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+		mockLog(opts, "client connected\n");
+		serveClient(tcpSock, udpSock, opts, joints, endTime);
+		close(tcpSock);
+		mockLog(opts, "client disconnected\n");
+	}
+
+	close(udpSock);
+	close(listenSock);
+	return 0;
+}